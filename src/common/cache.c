@@ -0,0 +1,384 @@
+#include "common/cache.h"
+#include "common/io/io.h"
+#include "common/printing.h"
+#include "common/time.h"
+#include "detection/uptime/uptime.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+    #include <process.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+#define FF_CACHE_MAGIC "FFCACHE " FASTFETCH_PROJECT_VERSION "\n"
+#define FF_CACHE_BASELINE_MAX_AGE 60000 // msec. Rates over longer periods don't describe the current load
+
+static uint32_t lookupCount;
+static uint32_t hitCount;
+
+static void (*resetFuncs[32])(void);
+static uint32_t resetFuncCount;
+
+bool ffCacheKeyAddFile(FFCacheEntry* entry, const char* path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+    {
+        ffStrbufAppendS(&entry->key, "- ");
+        return false;
+    }
+
+    #ifdef __APPLE__
+    int64_t mtimeNs = (int64_t) st.st_mtimespec.tv_nsec;
+    #elif defined(_WIN32)
+    int64_t mtimeNs = 0;
+    #else
+    int64_t mtimeNs = (int64_t) st.st_mtim.tv_nsec;
+    #endif
+
+    ffStrbufAppendF(&entry->key, "%llx:%llx:%llx:%llx.%llx ",
+        (unsigned long long) st.st_dev,
+        (unsigned long long) st.st_ino,
+        (unsigned long long) st.st_size,
+        (unsigned long long) st.st_mtime,
+        (unsigned long long) mtimeNs);
+    return true;
+}
+
+void ffCacheKeyAddBootId(FFCacheEntry* entry)
+{
+    #ifdef __linux__
+    char bootId[64];
+    ssize_t len = ffReadFileData("/proc/sys/kernel/random/boot_id", sizeof(bootId), bootId);
+    if (len > 0)
+    {
+        ffStrbufAppendNS(&entry->key, (uint32_t) len, bootId);
+        ffStrbufTrimRightSpace(&entry->key);
+        ffStrbufAppendC(&entry->key, ' ');
+        return;
+    }
+    #endif
+
+    FFUptimeResult uptime;
+    if (ffDetectUptime(&uptime) == NULL)
+        ffStrbufAppendF(&entry->key, "%llu ", (unsigned long long) (uptime.bootTime / 60000)); // boot time is calculated; allow some jitter
+    else
+        ffStrbufAppendS(&entry->key, "- ");
+}
+
+void ffCacheKeyAddTtl(FFCacheEntry* entry, uint32_t seconds)
+{
+    ffStrbufAppendF(&entry->key, "%llu ", (unsigned long long) (ffTimeGetNow() / 1000 / seconds));
+}
+
+void ffCacheKeyAddUInt(FFCacheEntry* entry, uint64_t value)
+{
+    ffStrbufAppendF(&entry->key, "%llx ", (unsigned long long) value);
+}
+
+static void getCachePath(const FFCacheEntry* entry, FFstrbuf* path)
+{
+    ffStrbufSet(path, &instance.state.platform.cacheDir);
+    ffStrbufAppendS(path, "fastfetch/cache/");
+    ffStrbufAppendS(path, entry->name);
+}
+
+static bool checkHeader(FFCacheEntry* entry)
+{
+    // Format: <magic><key>\n<data>
+    uint32_t magicLength = (uint32_t) strlen(FF_CACHE_MAGIC);
+    if (
+        entry->data.length < magicLength + entry->key.length + 1 ||
+        memcmp(entry->data.chars, FF_CACHE_MAGIC, magicLength) != 0 ||
+        memcmp(entry->data.chars + magicLength, entry->key.chars, entry->key.length) != 0 ||
+        entry->data.chars[magicLength + entry->key.length] != '\n'
+    )
+        return false;
+
+    entry->offset = magicLength + entry->key.length + 1;
+    __atomic_add_fetch(&hitCount, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static bool shouldLoad(void)
+{
+    FFCacheMode mode = instance.config.general.cacheMode;
+    if (mode == FF_CACHE_MODE_NONE)
+        return false;
+
+    __atomic_add_fetch(&lookupCount, 1, __ATOMIC_RELAXED);
+
+    return mode != FF_CACHE_MODE_REFRESH;
+}
+
+bool ffCacheLoad(FFCacheEntry* entry)
+{
+    if (!shouldLoad())
+        return false;
+
+    FF_STRBUF_AUTO_DESTROY path = ffStrbufCreate();
+    getCachePath(entry, &path);
+
+    if (!ffReadFileBuffer(path.chars, &entry->data))
+        return false;
+
+    if (!checkHeader(entry))
+    {
+        ffStrbufClear(&entry->data);
+        return false;
+    }
+    return true;
+}
+
+bool ffCacheLoadMapped(FFCacheEntry* entry)
+{
+    #ifdef _WIN32
+    return ffCacheLoad(entry);
+    #else
+    if (!shouldLoad())
+        return false;
+
+    FF_STRBUF_AUTO_DESTROY path = ffStrbufCreate();
+    getCachePath(entry, &path);
+
+    size_t size;
+    char* data = ffMapFile(path.chars, &size);
+    if (!data)
+        return false;
+    if (size > UINT32_MAX)
+    {
+        munmap(data, size);
+        return false;
+    }
+
+    ffStrbufDestroy(&entry->data);
+    entry->data.allocated = 0; // Never written or freed by FFstrbuf functions
+    entry->data.length = (uint32_t) size;
+    entry->data.chars = data;
+    entry->mapped = true;
+
+    if (!checkHeader(entry))
+    {
+        ffCacheEntryUnmap(entry);
+        return false;
+    }
+    return true;
+    #endif
+}
+
+void ffCacheEntryUnmap(FFCacheEntry* entry)
+{
+    #ifndef _WIN32
+    munmap(entry->data.chars, entry->data.length);
+    #endif
+    entry->mapped = false;
+    ffStrbufInit(&entry->data);
+    entry->offset = 0;
+}
+
+#ifndef _WIN32
+// May contain data that only privileged users can read. The file must never be accessible by others, not even until it's complete
+static bool writeTempFile(const FFstrbuf* tmpPath, const FFstrbuf* content)
+{
+    int fd = open(tmpPath->chars, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0 && errno == EEXIST)
+    {
+        // Left behind by a crashed process with the same pid
+        remove(tmpPath->chars);
+        fd = open(tmpPath->chars, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    }
+    else if (fd < 0 && errno == ENOENT)
+    {
+        // Creates `fastfetch/cache/` and the subdirectories of names like `process/<hash>`
+        FF_STRBUF_AUTO_DESTROY dir = ffStrbufCreateCopy(tmpPath);
+        for (uint32_t i = instance.state.platform.cacheDir.length; i < dir.length; ++i)
+        {
+            if (dir.chars[i] != '/')
+                continue;
+            dir.chars[i] = '\0';
+            mkdir(dir.chars, S_IRWXU);
+            dir.chars[i] = '/';
+        }
+        fd = open(tmpPath->chars, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    }
+    if (fd < 0)
+        return false;
+
+    bool ok = true;
+    for (uint32_t written = 0; ok && written < content->length;)
+    {
+        ssize_t ret = write(fd, content->chars + written, content->length - written);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        ok = ret > 0;
+        if (ok)
+            written += (uint32_t) ret;
+    }
+    ok = close(fd) == 0 && ok;
+    if (!ok)
+        remove(tmpPath->chars);
+    return ok;
+}
+#endif
+
+void ffCacheStore(FFCacheEntry* entry)
+{
+    FFCacheMode mode = instance.config.general.cacheMode;
+    if (mode != FF_CACHE_MODE_READWRITE && mode != FF_CACHE_MODE_REFRESH)
+        return;
+
+    FF_STRBUF_AUTO_DESTROY content = ffStrbufCreateA(entry->key.length + entry->data.length + 64);
+    ffStrbufAppendS(&content, FF_CACHE_MAGIC);
+    ffStrbufAppend(&content, &entry->key);
+    ffStrbufAppendC(&content, '\n');
+    ffStrbufAppend(&content, &entry->data);
+
+    FF_STRBUF_AUTO_DESTROY path = ffStrbufCreate();
+    getCachePath(entry, &path);
+
+    // Other fastfetch instances may read the entry at the same time. Write a temp file and rename it
+    FF_STRBUF_AUTO_DESTROY tmpPath = ffStrbufCreateCopy(&path);
+    ffStrbufAppendF(&tmpPath, ".%u.tmp", (unsigned) getpid());
+
+    #ifdef _WIN32
+    if (!ffWriteFileBuffer(tmpPath.chars, &content))
+        return;
+    remove(path.chars);
+    #else
+    if (!writeTempFile(&tmpPath, &content))
+        return;
+    #endif
+    if (rename(tmpPath.chars, path.chars) != 0)
+        remove(tmpPath.chars);
+}
+
+void ffCachePutData(FFCacheEntry* entry, uint32_t size, const void* data)
+{
+    ffStrbufAppendNS(&entry->data, sizeof(size), (const char*) &size);
+    ffStrbufAppendNS(&entry->data, size, data);
+}
+
+static bool getField(FFCacheEntry* entry, uint32_t* size, const char** data)
+{
+    if (entry->offset + sizeof(*size) > entry->data.length)
+        return false;
+    memcpy(size, entry->data.chars + entry->offset, sizeof(*size));
+    if (*size > entry->data.length - entry->offset - sizeof(*size))
+        return false;
+    *data = entry->data.chars + entry->offset + sizeof(*size);
+    entry->offset += (uint32_t) sizeof(*size) + *size;
+    return true;
+}
+
+bool ffCacheGetData(FFCacheEntry* entry, uint32_t size, void* data)
+{
+    uint32_t fieldSize;
+    const char* fieldData;
+    if (!getField(entry, &fieldSize, &fieldData) || fieldSize != size)
+        return false;
+    memcpy(data, fieldData, size);
+    return true;
+}
+
+bool ffCacheGetDataRef(FFCacheEntry* entry, uint32_t* size, const void** data)
+{
+    return getField(entry, size, (const char**) data);
+}
+
+void ffCachePutStrbuf(FFCacheEntry* entry, const FFstrbuf* value)
+{
+    ffCachePutData(entry, value->length, value->chars);
+}
+
+bool ffCacheGetStrbuf(FFCacheEntry* entry, FFstrbuf* value)
+{
+    uint32_t fieldSize;
+    const char* fieldData;
+    if (!getField(entry, &fieldSize, &fieldData))
+        return false;
+    ffStrbufSetNS(value, fieldSize, fieldData);
+    return true;
+}
+
+bool ffCacheLoadStrbufs(FFCacheEntry* entry, uint32_t count, FFstrbuf* values)
+{
+    if (!ffCacheLoad(entry))
+        return false;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (!ffCacheGetStrbuf(entry, &values[i]))
+        {
+            for (uint32_t j = 0; j < i; ++j)
+                ffStrbufClear(&values[j]);
+            return false;
+        }
+    }
+    return true;
+}
+
+void ffCacheStoreStrbufs(FFCacheEntry* entry, uint32_t count, const FFstrbuf* values)
+{
+    ffStrbufClear(&entry->data);
+    for (uint32_t i = 0; i < count; ++i)
+        ffCachePutStrbuf(entry, &values[i]);
+    ffCacheStore(entry);
+}
+
+uint64_t ffCacheLoadBaseline(FFCacheEntry* entry)
+{
+    uint64_t time;
+    if (!ffCacheLoad(entry) || !ffCacheGetData(entry, sizeof(time), &time))
+        return UINT64_MAX;
+
+    uint64_t now = (uint64_t) ffTimeGetTick();
+    if (time > now || now - time > FF_CACHE_BASELINE_MAX_AGE)
+        return UINT64_MAX;
+    return now - time;
+}
+
+void ffCacheStartBaseline(FFCacheEntry* entry)
+{
+    uint64_t time = (uint64_t) ffTimeGetTick();
+    ffStrbufClear(&entry->data);
+    ffCachePutData(entry, sizeof(time), &time);
+}
+
+void ffCachePrintStat(yyjson_mut_doc* jsonDoc)
+{
+    if (lookupCount == 0)
+        return;
+
+    if (jsonDoc)
+    {
+        yyjson_mut_val* obj = yyjson_mut_arr_add_obj(jsonDoc, jsonDoc->root);
+        yyjson_mut_obj_add_str(jsonDoc, obj, "type", "Cache");
+        yyjson_mut_val* stat = yyjson_mut_obj_add_obj(jsonDoc, obj, "stat");
+        yyjson_mut_obj_add_uint(jsonDoc, stat, "hits", hitCount);
+        yyjson_mut_obj_add_uint(jsonDoc, stat, "lookups", lookupCount);
+    }
+    else
+    {
+        ffPrintLogoAndKey("Cache", 0, NULL, FF_PRINT_TYPE_NO_CUSTOM_KEY);
+        printf("%u / %u hits (%.1f%%)\n", hitCount, lookupCount, hitCount * 100.0 / lookupCount);
+    }
+}
+
+void ffCacheRegisterReset(void (*reset)(void))
+{
+    uint32_t index = __atomic_fetch_add(&resetFuncCount, 1, __ATOMIC_RELAXED);
+    assert(index < sizeof(resetFuncs) / sizeof(resetFuncs[0]));
+    resetFuncs[index] = reset;
+}
+
+void ffCacheResetMemoized(void)
+{
+    // Detectors register again when they refill their result
+    for (uint32_t i = 0; i < resetFuncCount; ++i)
+        resetFuncs[i]();
+    resetFuncCount = 0;
+}
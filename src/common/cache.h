@@ -0,0 +1,74 @@
+#pragma once
+
+#include "fastfetch.h"
+
+// A persistent detection result, stored in `<cacheDir>/fastfetch/cache/<name>`.
+// The entry is only used if its invalidation key matches the one computed in this run
+typedef struct FFCacheEntry
+{
+    const char* name;
+    FFstrbuf key;
+    FFstrbuf data;
+    uint32_t offset; // read position in `data`
+    bool mapped; // `data` is a read-only mapping of the cache file, see ffCacheLoadMapped
+} FFCacheEntry;
+
+void ffCacheEntryUnmap(FFCacheEntry* entry);
+
+static inline void ffCacheEntryInit(FFCacheEntry* entry, const char* name)
+{
+    entry->name = name;
+    ffStrbufInit(&entry->key);
+    ffStrbufInit(&entry->data);
+    entry->offset = 0;
+    entry->mapped = false;
+}
+
+static inline void ffCacheEntryDestroy(FFCacheEntry* entry)
+{
+    if (entry->mapped)
+        ffCacheEntryUnmap(entry);
+    ffStrbufDestroy(&entry->key);
+    ffStrbufDestroy(&entry->data);
+}
+
+#define FF_CACHE_ENTRY_AUTO_DESTROY FFCacheEntry __attribute__((__cleanup__(ffCacheEntryDestroy)))
+
+// Invalidation keys
+bool ffCacheKeyAddFile(FFCacheEntry* entry, const char* path); // device, inode, size and mtime of `path`. Returns false if it doesn't exist
+void ffCacheKeyAddBootId(FFCacheEntry* entry); // changes on every reboot
+void ffCacheKeyAddTtl(FFCacheEntry* entry, uint32_t seconds); // expires after at most `seconds`
+void ffCacheKeyAddUInt(FFCacheEntry* entry, uint64_t value); // e.g. options that affect the result
+
+// Returns true on cache hit. Use ffCacheGet* to read the stored values in order
+bool ffCacheLoad(FFCacheEntry* entry);
+// Like ffCacheLoad, but maps the file instead of reading it, for large entries of which only a few bytes are used.
+// The entry must not be modified; pointers returned by ffCacheGetDataRef stay valid until it is destroyed
+bool ffCacheLoadMapped(FFCacheEntry* entry);
+// Writes the values added with ffCachePut*
+void ffCacheStore(FFCacheEntry* entry);
+
+void ffCachePutData(FFCacheEntry* entry, uint32_t size, const void* data);
+bool ffCacheGetData(FFCacheEntry* entry, uint32_t size, void* data);
+// For fields of variable size. `data` points into the entry and is valid until the entry is destroyed
+bool ffCacheGetDataRef(FFCacheEntry* entry, uint32_t* size, const void** data);
+void ffCachePutStrbuf(FFCacheEntry* entry, const FFstrbuf* value);
+bool ffCacheGetStrbuf(FFCacheEntry* entry, FFstrbuf* value);
+
+// Counter samples of rate modules (CPUUsage, DiskIO, NetIO), so that the next run can compute rates against them instead of sleeping.
+// The data starts with the monotonic time the sample was taken. Add the boot id to the key, the clock restarts with the system.
+// Returns the age of the sample in msec, or UINT64_MAX if there is none or it's too old. Read the sample with ffCacheGet* afterwards
+uint64_t ffCacheLoadBaseline(FFCacheEntry* entry);
+// Starts a new sample, taken now. Add it with ffCachePut* and write it with ffCacheStore
+void ffCacheStartBaseline(FFCacheEntry* entry);
+
+// For detection results that consist of FFstrbuf fields only
+bool ffCacheLoadStrbufs(FFCacheEntry* entry, uint32_t count, FFstrbuf* values);
+void ffCacheStoreStrbufs(FFCacheEntry* entry, uint32_t count, const FFstrbuf* values);
+
+void ffCachePrintStat(yyjson_mut_doc* jsonDoc);
+
+// In-process memoization. Detectors that keep their result in static storage register a function that drops it
+// when they fill it, so that the next call detects again. Used by long running processes (--watch, --daemon)
+void ffCacheRegisterReset(void (*reset)(void));
+void ffCacheResetMemoized(void);
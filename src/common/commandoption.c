@@ -1,8 +1,13 @@
 #include "commandoption.h"
-#include "common/color.h"
+#include "common/cache.h"
+#include "common/daemon.h"
 #include "common/printing.h"
-#include "common/time.h"
+#include "common/stat.h"
+#include "common/trace.h"
 #include "common/jsonconfig.h"
+#include "common/watch.h"
+#include "detection/terminalshell/terminalshell.h"
+#include "detection/vulkan/vulkan.h"
 #include "fastfetch_datatext.h"
 #include "modules/modules.h"
 #include "util/stringUtils.h"
@@ -24,6 +29,7 @@ bool ffParseModuleOptions(const char* key, const char* value)
 
 void ffPrepareCommandOption(FFdata* data)
 {
+    FF_TRACE_SPAN(span, "prepare", "ffPrepareCommandOption", NULL);
     FFOptionsModules* const options = &instance.config.modules;
     //If we don't have a custom structure, use the default one
     if(data->structure.length == 0)
@@ -38,13 +44,32 @@ void ffPrepareCommandOption(FFdata* data)
     if(ffStrbufContainIgnCaseS(&data->structure, FF_NETIO_MODULE_NAME))
         ffPrepareNetIO(&options->netIo);
 
-    if(instance.config.general.multithreading)
+    // The daemon renders other modules one at a time. Its request handlers only detect the few modules that depend on the client
+    if(instance.config.general.multithreading && !instance.state.daemonMode)
     {
+        if(ffStrbufContainIgnCaseS(&data->structure, FF_COMMAND_MODULE_NAME))
+            ffPrepareCommand(&options->command);
+
         if(ffStrbufContainIgnCaseS(&data->structure, FF_PUBLICIP_MODULE_NAME))
             ffPreparePublicIp(&options->publicIP);
 
         if(ffStrbufContainIgnCaseS(&data->structure, FF_WEATHER_MODULE_NAME))
             ffPrepareWeather(&options->weather);
+
+        if(ffStrbufContainIgnCaseS(&data->structure, FF_PACKAGES_MODULE_NAME))
+            ffPreparePackages(&options->packages);
+
+        if(ffStrbufContainIgnCaseS(&data->structure, FF_GPU_MODULE_NAME))
+            ffPrepareGPU(&options->gpu);
+
+        if(ffStrbufContainIgnCaseS(&data->structure, FF_SHELL_MODULE_NAME) || ffStrbufContainIgnCaseS(&data->structure, FF_TERMINAL_MODULE_NAME))
+            ffPrepareTerminalShell();
+
+        if(ffStrbufContainIgnCaseS(&data->structure, FF_VULKAN_MODULE_NAME))
+            ffPrepareVulkan();
+
+        if(ffStrbufContainIgnCaseS(&data->structure, FF_SOUND_MODULE_NAME))
+            ffPrepareSound(&options->sound);
     }
 }
 
@@ -91,10 +116,13 @@ static void parseStructureCommand(
             FFModuleBaseInfo* baseInfo = *modules;
             if (ffStrEqualsIgnCase(line, baseInfo->name))
             {
+                if (!ffDaemonBeginModule(baseInfo, jsonDoc))
+                    return;
                 if (__builtin_expect(jsonDoc != NULL, false))
                     fn(baseInfo, jsonDoc);
                 else
                     baseInfo->printModule(baseInfo);
+                ffDaemonEndModule(jsonDoc);
                 return;
             }
         }
@@ -113,37 +141,31 @@ void ffPrintCommandOption(FFdata* data, yyjson_mut_doc* jsonDoc)
         uint32_t colonIndex = ffStrbufNextIndexC(&data->structure, startIndex, ':');
         data->structure.chars[colonIndex] = '\0';
 
-        double ms = 0;
+        FFModuleStat stat;
         if(thres >= 0)
-            ms = ffTimeGetTick();
+            ffModuleStatBegin(&stat);
 
+        FF_TRACE_SPAN(span, "module", data->structure.chars + startIndex, NULL);
+        uint32_t row = instance.state.keysHeight;
         parseStructureCommand(data->structure.chars + startIndex, genJsonResult, jsonDoc);
+        if (!jsonDoc)
+            ffWatchRecordModule(data->structure.chars + startIndex, NULL, row);
+        ffTraceEnd(&span); // The module name is only terminated until the end of this iteration
 
         if(thres >= 0)
-        {
-            ms = ffTimeGetTick() - ms;
-
-            if (jsonDoc)
-            {
-                yyjson_mut_val* moduleJson = yyjson_mut_arr_get_last(jsonDoc->root);
-                yyjson_mut_obj_add_real(jsonDoc, moduleJson, "stat", ms);
-            }
-            else
-            {
-                char str[64];
-                int len = snprintf(str, sizeof str, "%.3fms", ms);
-                if (thres > 0)
-                    snprintf(str, sizeof str, "\e[%sm%.3fms\e[m", (ms <= thres ? FF_COLOR_FG_GREEN : ms <= 2 * thres ? FF_COLOR_FG_YELLOW : FF_COLOR_FG_RED), ms);
-                printf("\e[s\e[1A\e[9999999C\e[%dD%s\e[u", len, str); // Save; Up 1; Right 9999999; Left <len>; Print <str>; Load
-            }
-        }
+            ffModuleStatEnd(&stat, jsonDoc);
 
         #if defined(_WIN32)
             if (!jsonDoc && !instance.config.display.noBuffer) fflush(stdout);
         #endif
 
+        if (colonIndex < data->structure.length)
+            data->structure.chars[colonIndex] = ':'; // The structure may be printed again in watch mode
         startIndex = colonIndex + 1;
     }
+
+    if(thres >= 0)
+        ffCachePrintStat(jsonDoc);
 }
 
 void ffMigrateCommandOptionToJsonc(FFdata* data, yyjson_mut_doc* jsonDoc)
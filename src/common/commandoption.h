@@ -7,6 +7,9 @@ typedef struct FFdata
 {
     FFstrbuf structure;
     bool configLoaded;
+    bool daemon;
+    uint32_t watch; // Refresh interval of --watch in ms; 0 to print once
+    bool moduleOptions; // Module options were given on the command line
 } FFdata;
 
 bool ffParseModuleOptions(const char* key, const char* value);
@@ -0,0 +1,461 @@
+#include "fastfetch.h"
+#include "common/cache.h"
+#include "common/configsnapshot.h"
+#include "common/printing.h"
+#include "common/trace.h"
+#include "util/mallocHelper.h"
+#include "util/stringUtils.h"
+
+#include <ctype.h>
+#include <stddef.h>
+
+typedef struct FFStrbufRange
+{
+    uint16_t offset;
+    uint16_t count;
+} FFStrbufRange;
+
+// Options are stored as their raw bytes, followed by the content of their FFstrbuf fields
+typedef struct FFOptionsLayout
+{
+    uint32_t offset; // in FFconfig
+    uint32_t size;
+    uint32_t rawBegin; // bytes before it are not stored (FFModuleBaseInfo)
+    FFStrbufRange strbufs[4]; // sorted by offset
+} FFOptionsLayout;
+
+#define FF_LAYOUT_FOR_EACH_RANGE(layout, range) \
+    for (const FFStrbufRange* range = (layout)->strbufs; range < (layout)->strbufs + sizeof((layout)->strbufs) / sizeof(*(layout)->strbufs) && range->count; ++range)
+
+#define FF_OPTIONS_LAYOUT(member, ...) { offsetof(FFconfig, member), sizeof(((FFconfig*) 0)->member), 0, { __VA_ARGS__ } }
+#define FF_OPTIONS_STRBUFS(type, field, count) { offsetof(type, field), (count) }
+
+static const FFOptionsLayout logoLayout = FF_OPTIONS_LAYOUT(logo,
+    FF_OPTIONS_STRBUFS(FFOptionsLogo, source, 1),
+    FF_OPTIONS_STRBUFS(FFOptionsLogo, colors, FASTFETCH_LOGO_MAX_COLORS),
+    FF_OPTIONS_STRBUFS(FFOptionsLogo, chafaSymbols, 1),
+);
+static const FFOptionsLayout displayLayout = FF_OPTIONS_LAYOUT(display, // `constants` is stored separately
+    FF_OPTIONS_STRBUFS(FFOptionsDisplay, colorKeys, 4),
+    FF_OPTIONS_STRBUFS(FFOptionsDisplay, keyValueSeparator, 1),
+    FF_OPTIONS_STRBUFS(FFOptionsDisplay, tempColorGreen, 7),
+    FF_OPTIONS_STRBUFS(FFOptionsDisplay, percentColorGreen, 3),
+);
+static const FFOptionsLayout generalLayout = FF_OPTIONS_LAYOUT(general,
+    #if defined(__linux__) || defined(__FreeBSD__) || defined(__sun)
+    FF_OPTIONS_STRBUFS(FFOptionsGeneral, playerName, 1),
+    #endif
+);
+static const FFOptionsLayout libraryLayout = FF_OPTIONS_LAYOUT(library,
+    { 0, sizeof(FFOptionsLibrary) / sizeof(FFstrbuf) },
+);
+
+#define FF_MODULE_TYPE(member) __typeof__(((FFOptionsModules*) 0)->member)
+#define FF_MODULE_STRBUFS(member, field, count) FF_OPTIONS_STRBUFS(FF_MODULE_TYPE(member), field, count)
+#define FF_MODULE_LAYOUT(member, ...) { offsetof(FFconfig, modules.member), sizeof(FF_MODULE_TYPE(member)), sizeof(FFModuleBaseInfo), { __VA_ARGS__ } }
+#define FF_MODULE(member) FF_MODULE_LAYOUT(member, FF_MODULE_STRBUFS(member, moduleArgs.key, 5))
+#define FF_MODULE_EX(member, field, count) FF_MODULE_LAYOUT(member, FF_MODULE_STRBUFS(member, moduleArgs.key, 5), FF_MODULE_STRBUFS(member, field, count))
+
+static const FFOptionsLayout moduleLayouts[] = {
+    FF_MODULE(battery),
+    FF_MODULE(bios),
+    FF_MODULE(bluetooth),
+    FF_MODULE(bluetoothRadio),
+    FF_MODULE(board),
+    FF_MODULE(bootmgr),
+    FF_MODULE_LAYOUT(break_),
+    FF_MODULE(brightness),
+    FF_MODULE(cpu),
+    FF_MODULE(cpuCache),
+    FF_MODULE(cpuUsage),
+    FF_MODULE(camera),
+    FF_MODULE(chassis),
+    FF_MODULE(colors),
+    FF_MODULE_EX(command, shell, 2),
+    FF_MODULE(cursor),
+    FF_MODULE(custom),
+    FF_MODULE(de),
+    FF_MODULE(dateTime),
+    FF_MODULE_EX(disk, folders, 1),
+    FF_MODULE_EX(diskIo, namePrefix, 1),
+    FF_MODULE(display),
+    FF_MODULE(dns),
+    FF_MODULE(editor),
+    FF_MODULE(font),
+    FF_MODULE(gpu),
+    FF_MODULE(gamepad),
+    FF_MODULE(host),
+    FF_MODULE(icons),
+    FF_MODULE(initSystem),
+    FF_MODULE(kernel),
+    FF_MODULE(lm),
+    FF_MODULE(loadavg),
+    FF_MODULE_EX(localIP, namePrefix, 1),
+    FF_MODULE(locale),
+    FF_MODULE(media),
+    FF_MODULE(memory),
+    FF_MODULE(monitor),
+    FF_MODULE_EX(netIo, namePrefix, 1),
+    FF_MODULE(os),
+    FF_MODULE(openCL),
+    FF_MODULE(openGL),
+    FF_MODULE(packages),
+    FF_MODULE_EX(physicalDisk, namePrefix, 1),
+    FF_MODULE(physicalMemory),
+    FF_MODULE(player),
+    FF_MODULE(powerAdapter),
+    FF_MODULE(processes),
+    FF_MODULE_EX(publicIP, url, 1),
+    FF_MODULE_LAYOUT(separator, FF_MODULE_STRBUFS(separator, string, 2)),
+    FF_MODULE(shell),
+    FF_MODULE(sound),
+    FF_MODULE(swap),
+    FF_MODULE(terminal),
+    FF_MODULE(terminalFont),
+    FF_MODULE(terminalSize),
+    FF_MODULE(terminalTheme),
+    FF_MODULE(theme),
+    FF_MODULE_EX(title, colorUser, 3),
+    FF_MODULE(uptime),
+    FF_MODULE(users),
+    FF_MODULE(version),
+    FF_MODULE(vulkan),
+    FF_MODULE(wm),
+    FF_MODULE(wmTheme),
+    FF_MODULE(wallpaper),
+    FF_MODULE_EX(weather, location, 2),
+    FF_MODULE(wifi),
+};
+
+static struct
+{
+    FFCacheEntry entry; // mapped; module options are read from it until the snapshot is destroyed
+    char name[32];
+    FFstrbuf path;
+    FFlist modules; // list of FFConfigSnapshotModule
+    bool loaded;
+} snapshot;
+
+static const FFOptionsLayout* findModuleLayout(const FFModuleBaseInfo* baseInfo)
+{
+    uint32_t offset = (uint32_t) ((const char*) baseInfo - (const char*) &instance.config);
+    for (uint32_t i = 0; i < sizeof(moduleLayouts) / sizeof(*moduleLayouts); ++i)
+    {
+        if (moduleLayouts[i].offset == offset)
+            return &moduleLayouts[i];
+    }
+    return NULL;
+}
+
+static FFModuleBaseInfo* findModule(const char* type)
+{
+    if (!ffCharIsEnglishAlphabet(type[0])) return NULL;
+
+    for (FFModuleBaseInfo** modules = ffModuleInfos[toupper(type[0]) - 'A']; *modules; ++modules)
+    {
+        if (ffStrEqualsIgnCase(type, (*modules)->name))
+            return *modules;
+    }
+    return NULL;
+}
+
+static bool initEntry(FFCacheEntry* entry, char name[32], const char* path)
+{
+    // The path may be relative or contain `..`. Don't use it as file name directly
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a
+    for (const char* p = path; *p; ++p)
+        hash = (hash ^ (uint8_t) *p) * 1099511628211ULL;
+    snprintf(name, 32, "config-%016llx", (unsigned long long) hash);
+
+    ffCacheEntryInit(entry, name);
+    if (!ffCacheKeyAddFile(entry, path))
+        return false;
+    ffStrbufAppendS(&entry->key, path);
+    ffStrbufAppendC(&entry->key, ' ');
+    ffCacheKeyAddUInt(entry, YYJSON_VERSION_HEX);
+    ffCacheKeyAddUInt(entry, sizeof(FFconfig));
+
+    // The snapshot starts from the default options. Some display defaults depend on the terminal
+    FFOptionsDisplay display;
+    ffOptionsInitDisplay(&display);
+    ffCacheKeyAddUInt(entry, (uint64_t) display.pipe | (uint64_t) display.brightColor << 1);
+    ffOptionsDestroyDisplay(&display);
+    return true;
+}
+
+static void putOptions(FFCacheEntry* entry, const FFOptionsLayout* layout, const void* options)
+{
+    ffCachePutData(entry, layout->size - layout->rawBegin, (const char*) options + layout->rawBegin);
+    FF_LAYOUT_FOR_EACH_RANGE(layout, range)
+    {
+        for (uint32_t i = 0; i < range->count; ++i)
+            ffCachePutStrbuf(entry, (const FFstrbuf*) ((const char*) options + range->offset) + i);
+    }
+}
+
+static bool skipOptions(FFCacheEntry* entry, const FFOptionsLayout* layout)
+{
+    uint32_t size;
+    const void* data;
+    if (!ffCacheGetDataRef(entry, &size, &data) || size != layout->size - layout->rawBegin)
+        return false;
+    FF_LAYOUT_FOR_EACH_RANGE(layout, range)
+    {
+        for (uint32_t i = 0; i < range->count; ++i)
+        {
+            if (!ffCacheGetDataRef(entry, &size, &data))
+                return false;
+        }
+    }
+    return true;
+}
+
+// The entry must have been checked with skipOptions
+static void applyOptions(FFCacheEntry* entry, const FFOptionsLayout* layout, void* options)
+{
+    uint32_t size;
+    const char* data;
+    ffCacheGetDataRef(entry, &size, (const void**) &data);
+
+    // The stored FFstrbuf fields hold stale pointers. Copy the bytes around them and keep the buffers of `options`
+    uint32_t pos = layout->rawBegin;
+    FF_LAYOUT_FOR_EACH_RANGE(layout, range)
+    {
+        memcpy((char*) options + pos, data + pos - layout->rawBegin, range->offset - pos);
+        pos = range->offset + range->count * (uint32_t) sizeof(FFstrbuf);
+    }
+    memcpy((char*) options + pos, data + pos - layout->rawBegin, layout->size - pos);
+
+    FF_LAYOUT_FOR_EACH_RANGE(layout, range)
+    {
+        for (uint32_t i = 0; i < range->count; ++i)
+        {
+            const void* chars;
+            ffCacheGetDataRef(entry, &size, &chars);
+            ffStrbufSetNS((FFstrbuf*) ((char*) options + range->offset) + i, size, chars);
+        }
+    }
+}
+
+static void* getOptions(FFconfig* config, const FFOptionsLayout* layout)
+{
+    return (char*) config + layout->offset;
+}
+
+// Returns the offset of the module list, or 0 if the entry is invalid
+static uint32_t skipGlobalOptions(FFCacheEntry* entry)
+{
+    uint32_t count;
+    if (!skipOptions(entry, &logoLayout) || !skipOptions(entry, &displayLayout) || !ffCacheGetData(entry, sizeof(count), &count))
+        return 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t size;
+        const void* data;
+        if (!ffCacheGetDataRef(entry, &size, &data))
+            return 0;
+    }
+    if (!skipOptions(entry, &generalLayout) || !skipOptions(entry, &libraryLayout))
+        return 0;
+    return entry->offset;
+}
+
+static void applyGlobalOptions(FFCacheEntry* entry, FFconfig* config)
+{
+    applyOptions(entry, &logoLayout, getOptions(config, &logoLayout));
+
+    FFlist constants = config->display.constants;
+    applyOptions(entry, &displayLayout, getOptions(config, &displayLayout));
+    config->display.constants = constants;
+    FF_LIST_FOR_EACH(FFstrbuf, item, config->display.constants)
+        ffStrbufDestroy(item);
+    ffListClear(&config->display.constants);
+    uint32_t count;
+    ffCacheGetData(entry, sizeof(count), &count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t size;
+        const void* data;
+        ffCacheGetDataRef(entry, &size, &data);
+        ffStrbufInitNS(ffListAdd(&config->display.constants), size, data);
+    }
+
+    applyOptions(entry, &generalLayout, getOptions(config, &generalLayout));
+    applyOptions(entry, &libraryLayout, getOptions(config, &libraryLayout));
+}
+
+bool ffConfigSnapshotLoad(const char* path)
+{
+    FF_TRACE_SPAN(span, "config", "ffConfigSnapshotLoad", path);
+
+    if (!initEntry(&snapshot.entry, snapshot.name, path) || !ffCacheLoadMapped(&snapshot.entry))
+    {
+        ffCacheEntryDestroy(&snapshot.entry);
+        return false;
+    }
+
+    // Check everything before applying anything
+    uint32_t globalOffset = snapshot.entry.offset;
+    uint32_t moduleCount;
+    ffListInit(&snapshot.modules, sizeof(FFConfigSnapshotModule));
+    bool valid = skipGlobalOptions(&snapshot.entry) && ffCacheGetData(&snapshot.entry, sizeof(moduleCount), &moduleCount);
+    for (uint32_t i = 0; valid && i < moduleCount; ++i)
+    {
+        uint32_t header[2]; // offset of the options in FFconfig, whether they are stored
+        const FFOptionsLayout* layout = NULL;
+        valid = ffCacheGetData(&snapshot.entry, sizeof(header), header);
+        for (uint32_t j = 0; valid && j < sizeof(moduleLayouts) / sizeof(*moduleLayouts) && !layout; ++j)
+        {
+            if (moduleLayouts[j].offset == header[0])
+                layout = &moduleLayouts[j];
+        }
+        if (!layout)
+            break;
+
+        FFConfigSnapshotModule* module = ffListAdd(&snapshot.modules);
+        module->baseInfo = getOptions(&instance.config, layout);
+        module->offset = header[1] ? snapshot.entry.offset : 0;
+        valid = !header[1] || skipOptions(&snapshot.entry, layout);
+    }
+
+    if (!valid || snapshot.modules.length != moduleCount)
+    {
+        ffListDestroy(&snapshot.modules);
+        ffCacheEntryDestroy(&snapshot.entry);
+        return false;
+    }
+
+    snapshot.entry.offset = globalOffset;
+    applyGlobalOptions(&snapshot.entry, &instance.config);
+    ffStrbufInitS(&snapshot.path, path);
+    snapshot.loaded = true;
+    return true;
+}
+
+void ffConfigSnapshotStore(const char* path, yyjson_doc* doc)
+{
+    FFCacheMode mode = instance.config.general.cacheMode;
+    if (mode != FF_CACHE_MODE_READWRITE && mode != FF_CACHE_MODE_REFRESH)
+        return;
+
+    yyjson_val* root = yyjson_doc_get_root(doc);
+    yyjson_val* modules = yyjson_obj_get(root, "modules");
+    if (
+        !yyjson_is_obj(root) ||
+        yyjson_obj_get(yyjson_obj_get(root, "general"), "preRun") || // must run every time
+        (modules && !yyjson_is_arr(modules))
+    ) return;
+
+    FF_TRACE_SPAN(span, "config", "ffConfigSnapshotStore", path);
+
+    char name[32];
+    FF_CACHE_ENTRY_AUTO_DESTROY entry;
+    if (!initEntry(&entry, name, path))
+        return;
+
+    // Resolve the options like the config file is loaded and printed, but starting from the defaults
+    FF_AUTO_FREE FFconfig* config = malloc(sizeof(*config));
+    ffOptionsInitLogo(&config->logo);
+    ffOptionsInitDisplay(&config->display);
+    ffOptionsInitGeneral(&config->general);
+    ffOptionsInitModules(&config->modules);
+    ffOptionsInitLibrary(&config->library);
+
+    // Errors must be printed where the module is, so options that have any are not stored
+    uint32_t errors = 0;
+    ffPrintErrorRedirect(&errors);
+
+    bool valid =
+        !ffOptionsParseLogoJsonConfig(&config->logo, root) &&
+        !ffOptionsParseGeneralJsonConfig(&config->general, root) &&
+        !ffOptionsParseDisplayJsonConfig(&config->display, root) &&
+        !ffOptionsParseLibraryJsonConfig(&config->library, root);
+
+    if (valid)
+    {
+        putOptions(&entry, &logoLayout, &config->logo);
+        putOptions(&entry, &displayLayout, &config->display);
+        ffCachePutData(&entry, sizeof(config->display.constants.length), &config->display.constants.length);
+        FF_LIST_FOR_EACH(FFstrbuf, item, config->display.constants)
+            ffCachePutStrbuf(&entry, item);
+        putOptions(&entry, &generalLayout, &config->general);
+        putOptions(&entry, &libraryLayout, &config->library);
+
+        uint32_t count = (uint32_t) yyjson_arr_size(modules);
+        ffCachePutData(&entry, sizeof(count), &count);
+
+        yyjson_val* item;
+        size_t idx, max;
+        yyjson_arr_foreach(modules, idx, max, item)
+        {
+            yyjson_val* module = item;
+            const char* type = yyjson_get_str(module);
+            if (type)
+                module = NULL;
+            else if (yyjson_is_obj(module))
+            {
+                type = yyjson_get_str(yyjson_obj_get(module, "type"));
+                if (yyjson_obj_size(module) == 1)
+                    module = NULL;
+            }
+
+            FFModuleBaseInfo* baseInfo = type ? findModule(type) : NULL;
+            const FFOptionsLayout* layout = baseInfo ? findModuleLayout(baseInfo) : NULL;
+            if (!layout)
+            {
+                valid = false;
+                break;
+            }
+
+            uint32_t header[2] = { layout->offset, module != NULL };
+            ffCachePutData(&entry, sizeof(header), header);
+            if (module)
+            {
+                // Options carry over to the next module of the same type
+                FFModuleBaseInfo* options = getOptions(config, layout);
+                options->parseJsonObject(options, module);
+                putOptions(&entry, layout, options);
+            }
+        }
+    }
+
+    ffPrintErrorRedirect(NULL);
+    if (valid && errors == 0)
+        ffCacheStore(&entry);
+
+    ffOptionsDestroyLogo(&config->logo);
+    ffOptionsDestroyDisplay(&config->display);
+    ffOptionsDestroyGeneral(&config->general);
+    ffOptionsDestroyModules(&config->modules);
+    ffOptionsDestroyLibrary(&config->library);
+}
+
+const FFlist* ffConfigSnapshotGetModules(void)
+{
+    return snapshot.loaded ? &snapshot.modules : NULL;
+}
+
+const char* ffConfigSnapshotGetPath(void)
+{
+    return snapshot.path.chars;
+}
+
+void ffConfigSnapshotApplyModule(const FFConfigSnapshotModule* module, void* options)
+{
+    if (!module->offset)
+        return;
+
+    FFCacheEntry entry = snapshot.entry; // read only; not destroyed
+    entry.offset = module->offset;
+    applyOptions(&entry, findModuleLayout(module->baseInfo), options);
+}
+
+void ffConfigSnapshotDestroy(void)
+{
+    if (!snapshot.loaded)
+        return;
+    snapshot.loaded = false;
+    ffListDestroy(&snapshot.modules);
+    ffCacheEntryDestroy(&snapshot.entry);
+    ffStrbufDestroy(&snapshot.path);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "fastfetch.h"
+
+// The resolved options of a config file, stored in the persistent cache, so that loading it doesn't need to parse JSON.
+// Keyed by the file's path, size and mtime, the fastfetch and yyjson versions and the defaults that depend on the terminal
+
+// An entry of the `modules` array of the config file
+typedef struct FFConfigSnapshotModule
+{
+    FFModuleBaseInfo* baseInfo;
+    uint32_t offset; // position of the module options in the snapshot; 0 if the entry sets no options
+} FFConfigSnapshotModule;
+
+// Applies the global options and keeps the module list. Returns false if there is no valid snapshot of `path`
+bool ffConfigSnapshotLoad(const char* path);
+// Resolves the options of the parsed config file `doc` and stores them. Does nothing if they depend on more than the file
+void ffConfigSnapshotStore(const char* path, yyjson_doc* doc);
+// The module list of the loaded snapshot, or NULL if none is loaded
+const FFlist* ffConfigSnapshotGetModules(void);
+// The path of the config file the loaded snapshot belongs to
+const char* ffConfigSnapshotGetPath(void);
+// Sets `options` to the options of `module`, as resolved when the config file was parsed
+void ffConfigSnapshotApplyModule(const FFConfigSnapshotModule* module, void* options);
+void ffConfigSnapshotDestroy(void);
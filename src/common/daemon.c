@@ -0,0 +1,762 @@
+#include "common/daemon.h"
+#include "common/cache.h"
+#include "common/io/io.h"
+#include "common/jsonconfig.h"
+#include "common/time.h"
+#include "detection/terminaltheme/terminaltheme.h"
+#include "modules/modules.h"
+#include "util/stringUtils.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define FF_DAEMON_MAGIC "fastfetch-daemon " FASTFETCH_PROJECT_VERSION
+#define FF_DAEMON_SAMPLE_INTERVAL 1000
+#define FF_DAEMON_INVALIDATION_INTERVAL (5 * 60 * 1000) // Expensive modules are rendered again at least this often, or on SIGHUP
+#define FF_DAEMON_MAX_REQUEST_SIZE (1 << 20)
+
+#ifdef MSG_NOSIGNAL
+    #define FF_DAEMON_SEND_FLAGS MSG_NOSIGNAL
+#else
+    #define FF_DAEMON_SEND_FLAGS 0
+#endif
+
+extern char** environ;
+
+// Request format: <uint32 length> (with stdin, stdout and stderr attached) followed by
+// NUL terminated strings: <magic> <format> <ppid> <cwd> <environment variables...>
+// The daemon answers with one byte once it has taken over the request, then closes the connection when done
+
+static bool getSocketAddress(struct sockaddr_un* addr)
+{
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if (!ffStrSet(runtimeDir))
+        return false;
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    int len = snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/fastfetch.sock", runtimeDir);
+    return len > 0 && (size_t) len < sizeof(addr->sun_path);
+}
+
+static int connectDaemon(const struct sockaddr_un* addr)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    if (connect(fd, (const struct sockaddr*) addr, sizeof(*addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static inline void appendField(FFstrbuf* request, const char* value)
+{
+    ffStrbufAppendNS(request, (uint32_t) strlen(value) + 1, value);
+}
+
+bool ffDaemonRunClient(int argc, char** argv)
+{
+    // Only forward plain invocations. Other flags may not match the config loaded by the daemon
+    const char* format = "default";
+    if (argc == 3 && ffStrEqualsIgnCase(argv[1], "--format") && (ffStrEqualsIgnCase(argv[2], "json") || ffStrEqualsIgnCase(argv[2], "default")))
+        format = argv[2];
+    else if (argc != 1 || getenv("NO_CONFIG"))
+        return false;
+
+    struct sockaddr_un addr;
+    if (!getSocketAddress(&addr))
+        return false;
+
+    int FF_AUTO_CLOSE_FD fd = connectDaemon(&addr);
+    if (fd < 0)
+        return false;
+
+    FF_STRBUF_AUTO_DESTROY request = ffStrbufCreateA(4096);
+    appendField(&request, FF_DAEMON_MAGIC);
+    appendField(&request, format);
+    ffStrbufAppendF(&request, "%d", (int) getppid());
+    ffStrbufAppendC(&request, '\0');
+    char cwd[PATH_MAX];
+    appendField(&request, getcwd(cwd, sizeof(cwd)) ? cwd : "/");
+    for (char** env = environ; *env; ++env)
+        appendField(&request, *env);
+
+    uint32_t length = request.length;
+    int fds[] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(fds))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = { .iov_base = &length, .iov_len = sizeof(length) };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer),
+    };
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    if (sendmsg(fd, &msg, FF_DAEMON_SEND_FLAGS) != (ssize_t) sizeof(length))
+        return false;
+
+    for (uint32_t sent = 0; sent < request.length;)
+    {
+        ssize_t ret = send(fd, request.chars + sent, request.length - sent, FF_DAEMON_SEND_FLAGS);
+        if (ret <= 0)
+        {
+            if (ret < 0 && errno == EINTR) continue;
+            return false;
+        }
+        sent += (uint32_t) ret;
+    }
+
+    // Nothing has been printed before the acknowledgement. Fall back to in-process detection if we don't get it
+    char ack;
+    ssize_t ret;
+    while ((ret = read(fd, &ack, 1)) < 0 && errno == EINTR);
+    if (ret != 1)
+        return false;
+
+    // Wait until the daemon has finished printing
+    while ((ret = read(fd, &ack, 1)) > 0 || (ret < 0 && errno == EINTR));
+    return true;
+}
+
+static bool checkPeer(int conn)
+{
+    #if defined(__linux__)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    return getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == getuid();
+    #elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+    uid_t uid;
+    gid_t gid;
+    return getpeereid(conn, &uid, &gid) == 0 && uid == getuid();
+    #else
+    // The socket lives in the private XDG_RUNTIME_DIR and is only accessible by the owner
+    FF_UNUSED(conn);
+    return true;
+    #endif
+}
+
+static bool readAll(int fd, void* buffer, uint32_t length)
+{
+    for (uint32_t done = 0; done < length;)
+    {
+        ssize_t ret = read(fd, (char*) buffer + done, length - done);
+        if (ret <= 0)
+        {
+            if (ret < 0 && errno == EINTR) continue;
+            return false;
+        }
+        done += (uint32_t) ret;
+    }
+    return true;
+}
+
+typedef struct FFDaemonRequest
+{
+    int fds[3]; // stdin, stdout and stderr of the client
+    char* data;
+    const char* format;
+    const char* ppid;
+    const char* cwd;
+    char** env;
+} FFDaemonRequest;
+
+static void closeRequest(FFDaemonRequest* request)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        if (request->fds[i] >= 0)
+            close(request->fds[i]);
+    }
+    free(request->data);
+    free(request->env);
+}
+
+static bool receiveRequest(int conn, FFDaemonRequest* request)
+{
+    uint32_t length = 0;
+    int fds[3];
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(fds))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = { .iov_base = &length, .iov_len = sizeof(length) };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buffer,
+        .msg_controllen = sizeof(control.buffer),
+    };
+    if (recvmsg(conn, &msg, 0) != (ssize_t) sizeof(length))
+        return false;
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+        return false;
+    memcpy(request->fds, CMSG_DATA(cmsg), sizeof(fds));
+
+    if (length == 0 || length > FF_DAEMON_MAX_REQUEST_SIZE)
+        return false;
+
+    request->data = malloc(length + 1);
+    if (!readAll(conn, request->data, length))
+        return false;
+    request->data[length] = '\0';
+
+    const char* end = request->data + length;
+    const char* fields[4];
+    char* p = request->data;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        if (p >= end)
+            return false;
+        fields[i] = p;
+        p += strlen(p) + 1;
+    }
+    if (!ffStrEquals(fields[0], FF_DAEMON_MAGIC))
+        return false;
+    request->format = fields[1];
+    request->ppid = fields[2];
+    request->cwd = fields[3];
+
+    uint32_t envCount = 0;
+    for (char* q = p; q < end; q += strlen(q) + 1)
+        ++envCount;
+    request->env = malloc(sizeof(*request->env) * (envCount + 1));
+    envCount = 0;
+    for (; p < end; p += strlen(p) + 1)
+        request->env[envCount++] = p;
+    request->env[envCount] = NULL;
+
+    return true;
+}
+
+// Called in the request handler. Makes this process look like the client
+static bool applyRequest(FFDaemonRequest* request, bool pipe)
+{
+    if (chdir(request->cwd) != 0)
+        return false;
+
+    environ = request->env; // Intentionally leaked
+
+    for (int i = 0; i < 3; ++i)
+    {
+        dup2(request->fds[i], i);
+        if (request->fds[i] > STDERR_FILENO)
+            close(request->fds[i]);
+        request->fds[i] = -1;
+    }
+
+    instance.state.parentPid = (uint32_t) strtoul(request->ppid, NULL, 10);
+    instance.config.display.pipe = pipe;
+
+    FFTerminalThemeResult theme;
+    instance.state.terminalLightTheme = ffDetectTerminalTheme(&theme, true) && !theme.bg.dark;
+
+    if (ffStrEqualsIgnCase(request->format, "json"))
+    {
+        if (!instance.state.resultDoc)
+        {
+            instance.state.resultDoc = yyjson_mut_doc_new(NULL);
+            yyjson_mut_doc_set_root(instance.state.resultDoc, yyjson_mut_arr(instance.state.resultDoc));
+        }
+    }
+    else if (instance.state.resultDoc)
+    {
+        yyjson_mut_doc_free(instance.state.resultDoc);
+        instance.state.resultDoc = NULL;
+    }
+
+    return true;
+}
+
+// Results of the modules are rendered in the daemon and only printed by the request handlers.
+// A module's output differs with the format and with whether colors are used; each combination is rendered on first use
+typedef enum FFDaemonVariant
+{
+    FF_DAEMON_VARIANT_COLOR,
+    FF_DAEMON_VARIANT_PIPE,
+    FF_DAEMON_VARIANT_JSON,
+    FF_DAEMON_VARIANT_COUNT,
+} FFDaemonVariant;
+
+typedef enum FFDaemonModuleKind
+{
+    FF_DAEMON_MODULE_EXPENSIVE, // Rendered again when invalidated
+    FF_DAEMON_MODULE_CHEAP, // Rendered again every sample interval
+    FF_DAEMON_MODULE_PER_REQUEST, // Detected and printed by the request handler
+} FFDaemonModuleKind;
+
+typedef struct FFDaemonResult
+{
+    FFstrbuf text; // Printed without the logo. Every line takes one key line
+    yyjson_mut_doc* json; // The root is the result object of the module
+    bool valid;
+} FFDaemonResult;
+
+typedef struct FFDaemonModule
+{
+    FFDaemonModuleKind kind;
+    FFDaemonResult results[FF_DAEMON_VARIANT_COUNT];
+} FFDaemonModule;
+
+static enum {
+    FF_DAEMON_PHASE_NONE,
+    FF_DAEMON_PHASE_RENDER, // In the daemon
+    FF_DAEMON_PHASE_SERVE, // In a request handler
+} phase;
+static FFDaemonVariant variant;
+static FFlist modules; // FFDaemonModule, in the order of the structure
+static uint32_t moduleIndex;
+static uint32_t moduleRow;
+static bool variantUsed[FF_DAEMON_VARIANT_COUNT];
+static volatile sig_atomic_t invalidated;
+
+static const char* cheapModules[] = {
+    FF_BATTERY_MODULE_NAME,
+    FF_CPUUSAGE_MODULE_NAME,
+    FF_DISKIO_MODULE_NAME,
+    FF_LOADAVG_MODULE_NAME,
+    FF_LOCALIP_MODULE_NAME,
+    FF_MEMORY_MODULE_NAME,
+    FF_NETIO_MODULE_NAME,
+    FF_POWERADAPTER_MODULE_NAME,
+    FF_PROCESSES_MODULE_NAME,
+    FF_SWAP_MODULE_NAME,
+    FF_UPTIME_MODULE_NAME,
+    FF_USERS_MODULE_NAME,
+};
+
+// Modules that depend on the environment or the terminal of the client, or must be current to the request
+static const char* perRequestModules[] = {
+    FF_COMMAND_MODULE_NAME,
+    FF_CURSOR_MODULE_NAME,
+    FF_DATETIME_MODULE_NAME,
+    FF_DE_MODULE_NAME,
+    FF_DISPLAY_MODULE_NAME,
+    FF_EDITOR_MODULE_NAME,
+    FF_FONT_MODULE_NAME,
+    FF_ICONS_MODULE_NAME,
+    FF_LOCALE_MODULE_NAME,
+    FF_MEDIA_MODULE_NAME,
+    FF_PLAYER_MODULE_NAME,
+    FF_SHELL_MODULE_NAME,
+    FF_TERMINAL_MODULE_NAME,
+    FF_TERMINALFONT_MODULE_NAME,
+    FF_TERMINALSIZE_MODULE_NAME,
+    FF_TERMINALTHEME_MODULE_NAME,
+    FF_THEME_MODULE_NAME,
+    FF_WALLPAPER_MODULE_NAME,
+    FF_WM_MODULE_NAME,
+    FF_WMTHEME_MODULE_NAME,
+};
+
+static FFDaemonModuleKind getModuleKind(const char* name)
+{
+    for (uint32_t i = 0; i < sizeof(cheapModules) / sizeof(cheapModules[0]); ++i)
+    {
+        if (ffStrEqualsIgnCase(name, cheapModules[i]))
+            return FF_DAEMON_MODULE_CHEAP;
+    }
+    for (uint32_t i = 0; i < sizeof(perRequestModules) / sizeof(perRequestModules[0]); ++i)
+    {
+        if (ffStrEqualsIgnCase(name, perRequestModules[i]))
+            return FF_DAEMON_MODULE_PER_REQUEST;
+    }
+    return FF_DAEMON_MODULE_EXPENSIVE;
+}
+
+bool ffDaemonBeginModule(FFModuleBaseInfo* baseInfo, yyjson_mut_doc* jsonDoc)
+{
+    if (__builtin_expect(phase == FF_DAEMON_PHASE_NONE, true))
+        return true;
+
+    uint32_t index = moduleIndex++;
+    if (phase == FF_DAEMON_PHASE_RENDER)
+    {
+        if (index == modules.length)
+        {
+            FFDaemonModule* module = (FFDaemonModule*) ffListAdd(&modules);
+            module->kind = getModuleKind(baseInfo->name);
+            for (uint32_t i = 0; i < FF_DAEMON_VARIANT_COUNT; ++i)
+            {
+                ffStrbufInit(&module->results[i].text);
+                module->results[i].json = NULL;
+                module->results[i].valid = false;
+            }
+        }
+
+        FFDaemonModule* module = FF_LIST_GET(FFDaemonModule, modules, index);
+        if (module->kind == FF_DAEMON_MODULE_PER_REQUEST || module->results[variant].valid)
+            return false;
+
+        if (!jsonDoc)
+        {
+            // stdout is redirected to a temporary file while rendering
+            fflush(stdout);
+            if (ftruncate(STDOUT_FILENO, 0) != 0 || lseek(STDOUT_FILENO, 0, SEEK_SET) != 0)
+            {
+                module->kind = FF_DAEMON_MODULE_PER_REQUEST;
+                return false;
+            }
+            moduleRow = instance.state.keysHeight;
+        }
+        return true;
+    }
+
+    if (index >= modules.length)
+        return true;
+
+    FFDaemonModule* module = FF_LIST_GET(FFDaemonModule, modules, index);
+    FFDaemonResult* result = &module->results[variant];
+    if (module->kind == FF_DAEMON_MODULE_PER_REQUEST || !result->valid)
+        return true;
+
+    if (jsonDoc)
+        yyjson_mut_arr_append(yyjson_mut_doc_get_root(jsonDoc), yyjson_mut_val_mut_copy(jsonDoc, yyjson_mut_doc_get_root(result->json)));
+    else
+    {
+        const char* line = result->text.chars;
+        const char* end = line + result->text.length;
+        while (line < end)
+        {
+            const char* next = memchr(line, '\n', (size_t) (end - line));
+            if (next)
+            {
+                ffLogoPrintLine();
+                ++next;
+            }
+            else
+                next = end;
+            fwrite(line, 1, (size_t) (next - line), stdout);
+            line = next;
+        }
+    }
+    return false;
+}
+
+void ffDaemonEndModule(yyjson_mut_doc* jsonDoc)
+{
+    if (__builtin_expect(phase != FF_DAEMON_PHASE_RENDER, true))
+        return;
+
+    FFDaemonModule* module = FF_LIST_GET(FFDaemonModule, modules, moduleIndex - 1);
+    FFDaemonResult* result = &module->results[variant];
+    if (jsonDoc)
+    {
+        // Also keeps the document of the pass small
+        yyjson_mut_val* value = yyjson_mut_arr_remove_last(yyjson_mut_doc_get_root(jsonDoc));
+        if (!value)
+            return;
+        if (result->json)
+            yyjson_mut_doc_free(result->json);
+        result->json = yyjson_mut_doc_new(NULL);
+        yyjson_mut_doc_set_root(result->json, yyjson_mut_val_mut_copy(result->json, value));
+    }
+    else
+    {
+        fflush(stdout);
+        off_t size = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+        ffStrbufClear(&result->text);
+        if (size > 0)
+        {
+            ffStrbufEnsureFree(&result->text, (uint32_t) size);
+            if (pread(STDOUT_FILENO, result->text.chars, (size_t) size, 0) != (ssize_t) size)
+            {
+                module->kind = FF_DAEMON_MODULE_PER_REQUEST;
+                return;
+            }
+            result->text.length = (uint32_t) size;
+            result->text.chars[size] = '\0';
+        }
+
+        // The request handler prints the logo in front of every line
+        if (ffStrbufCountC(&result->text, '\n') != instance.state.keysHeight - moduleRow)
+        {
+            module->kind = FF_DAEMON_MODULE_PER_REQUEST;
+            return;
+        }
+    }
+    result->valid = true;
+}
+
+static void invalidateModules(FFDaemonModuleKind kind)
+{
+    FF_LIST_FOR_EACH(FFDaemonModule, module, modules)
+    {
+        if (module->kind == kind)
+        {
+            for (uint32_t i = 0; i < FF_DAEMON_VARIANT_COUNT; ++i)
+                module->results[i].valid = false;
+        }
+    }
+}
+
+static void renderModules(FFdata* data, FFDaemonVariant target, int captureFd)
+{
+    int32_t stat = instance.config.display.stat;
+    bool pipe = instance.config.display.pipe;
+    instance.config.display.stat = -1;
+    instance.config.display.pipe = target == FF_DAEMON_VARIANT_PIPE;
+
+    yyjson_mut_doc* doc = NULL;
+    if (target == FF_DAEMON_VARIANT_JSON)
+    {
+        doc = yyjson_mut_doc_new(NULL);
+        yyjson_mut_doc_set_root(doc, yyjson_mut_arr(doc));
+    }
+
+    fflush(stdout);
+    int stdoutFd = dup(STDOUT_FILENO);
+    dup2(captureFd, STDOUT_FILENO);
+
+    phase = FF_DAEMON_PHASE_RENDER;
+    variant = target;
+    moduleIndex = 0;
+    instance.state.keysHeight = 0;
+    if (data->structure.length == 0 && instance.state.configDoc)
+        ffPrintJsonConfig(false, doc);
+    else
+        ffPrintCommandOption(data, doc);
+    phase = FF_DAEMON_PHASE_NONE;
+
+    fflush(stdout);
+    dup2(stdoutFd, STDOUT_FILENO);
+    close(stdoutFd);
+
+    if (doc)
+        yyjson_mut_doc_free(doc);
+    instance.config.display.stat = stat;
+    instance.config.display.pipe = pipe;
+}
+
+static void sampleVolatileModules(void)
+{
+    ffSampleCPUUsage();
+    ffSampleDiskIO();
+    ffSampleNetIO();
+}
+
+// Request handlers are reaped by pid. SIGCHLD stays at SIG_DFL, because the modules rendered by the daemon wait for their own child processes
+static void reapHandlers(FFlist* handlers)
+{
+    for (uint32_t i = 0; i < handlers->length;)
+    {
+        pid_t* pid = ffListGet(handlers, i);
+        if (waitpid(*pid, NULL, WNOHANG) == 0)
+        {
+            ++i;
+            continue;
+        }
+        *pid = *(pid_t*) ffListGet(handlers, handlers->length - 1);
+        --handlers->length;
+    }
+}
+
+static void handleSighup(FF_MAYBE_UNUSED int signal)
+{
+    invalidated = true;
+}
+
+void ffDaemonServe(FFdata* data, void (*run)(FFdata* data))
+{
+    struct sockaddr_un addr;
+    if (!getSocketAddress(&addr))
+    {
+        fputs("Error: $XDG_RUNTIME_DIR must be set to run as daemon\n", stderr);
+        exit(1);
+    }
+
+    int fd = connectDaemon(&addr);
+    if (fd >= 0)
+    {
+        close(fd);
+        fprintf(stderr, "Error: another daemon is listening on `%s`\n", addr.sun_path);
+        exit(1);
+    }
+    unlink(addr.sun_path); // Stale socket
+
+    FILE* capture = tmpfile();
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (!capture ||
+        listenFd < 0 ||
+        fcntl(listenFd, F_SETFD, FD_CLOEXEC) != 0 ||
+        bind(listenFd, (const struct sockaddr*) &addr, sizeof(addr)) != 0 ||
+        chmod(addr.sun_path, S_IRUSR | S_IWUSR) != 0 ||
+        listen(listenFd, 16) != 0)
+    {
+        fprintf(stderr, "Error: failed to listen on `%s`: %s\n", addr.sun_path, strerror(errno));
+        exit(1);
+    }
+    int captureFd = fileno(capture);
+    fcntl(captureFd, F_SETFD, FD_CLOEXEC);
+
+    // Take baseline samples of CPUUsage, DiskIO and NetIO. Other modules are detected serially when rendering
+    instance.state.daemonMode = true;
+    if (data->structure.length == 0 && instance.state.configDoc)
+        ffPrintJsonConfig(true /* prepare */, instance.state.resultDoc);
+    else
+        ffPrepareCommandOption(data);
+
+    bool configPipe = instance.config.display.pipe;
+    bool defaultPipe = !isatty(STDOUT_FILENO) || !!getenv("NO_COLOR");
+    FF_LIST_AUTO_DESTROY handlers = ffListCreate(sizeof(pid_t));
+    struct sigaction action = { .sa_handler = handleSighup };
+    sigaction(SIGHUP, &action, NULL);
+    ffListInit(&modules, sizeof(FFDaemonModule));
+
+    fprintf(stderr, "Listening on `%s`\n", addr.sun_path);
+
+    uint64_t lastSample = ffTimeGetNow();
+    uint64_t lastInvalidation = lastSample;
+    while (true)
+    {
+        uint64_t elapsed = ffTimeGetNow() - lastSample;
+        struct pollfd pfd = { .fd = listenFd, .events = POLLIN };
+        int ret = poll(&pfd, 1, elapsed >= FF_DAEMON_SAMPLE_INTERVAL || invalidated ? 0 : (int) (FF_DAEMON_SAMPLE_INTERVAL - elapsed));
+        if (ret < 0 && errno != EINTR)
+            break;
+
+        reapHandlers(&handlers);
+
+        uint64_t now = ffTimeGetNow();
+        if (now - lastSample >= FF_DAEMON_SAMPLE_INTERVAL || invalidated)
+        {
+            sampleVolatileModules();
+            lastSample = now;
+
+            invalidateModules(FF_DAEMON_MODULE_CHEAP);
+            if (invalidated || now - lastInvalidation >= FF_DAEMON_INVALIDATION_INTERVAL)
+            {
+                invalidateModules(FF_DAEMON_MODULE_EXPENSIVE);
+                invalidated = false;
+                lastInvalidation = now;
+            }
+
+            // Volatile results, e.g. the process table, must be detected again
+            ffCacheResetMemoized();
+            for (uint32_t i = 0; i < FF_DAEMON_VARIANT_COUNT; ++i)
+            {
+                if (variantUsed[i])
+                    renderModules(data, (FFDaemonVariant) i, captureFd);
+            }
+        }
+
+        if (ret <= 0)
+            continue;
+
+        int conn = accept(listenFd, NULL, NULL);
+        if (conn < 0)
+            continue;
+
+        // Don't let a stuck client block other requests
+        struct timeval timeout = { .tv_sec = 1 };
+        FFDaemonRequest request = { .fds = { -1, -1, -1 } };
+        if (!checkPeer(conn) ||
+            setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+            !receiveRequest(conn, &request))
+        {
+            closeRequest(&request);
+            close(conn);
+            continue;
+        }
+
+        // Settings detected from the environment of the daemon are detected for the client again
+        bool pipe = configPipe;
+        if (pipe == defaultPipe)
+        {
+            pipe = !isatty(request.fds[1]);
+            for (char** env = request.env; *env && !pipe; ++env)
+                pipe = ffStrStartsWith(*env, "NO_COLOR=");
+        }
+        FFDaemonVariant target = ffStrEqualsIgnCase(request.format, "json")
+            ? FF_DAEMON_VARIANT_JSON
+            : pipe ? FF_DAEMON_VARIANT_PIPE : FF_DAEMON_VARIANT_COLOR;
+        if (!variantUsed[target])
+        {
+            variantUsed[target] = true;
+            renderModules(data, target, captureFd);
+        }
+
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(listenFd);
+            fcntl(conn, F_SETFD, FD_CLOEXEC);
+
+            if (!applyRequest(&request, pipe))
+                _exit(1);
+
+            char ack = 0;
+            if (write(conn, &ack, 1) != 1)
+                _exit(1);
+
+            phase = FF_DAEMON_PHASE_SERVE;
+            variant = target;
+            moduleIndex = 0;
+            run(data);
+            exit(0);
+        }
+        if (pid > 0)
+            *(pid_t*) ffListAdd(&handlers) = pid;
+        closeRequest(&request);
+        close(conn);
+    }
+
+    fprintf(stderr, "Error: failed to wait for requests: %s\n", strerror(errno));
+    close(listenFd);
+    unlink(addr.sun_path);
+    exit(1);
+}
+
+#else // _WIN32
+
+bool ffDaemonRunClient(FF_MAYBE_UNUSED int argc, FF_MAYBE_UNUSED char** argv)
+{
+    return false;
+}
+
+bool ffDaemonBeginModule(FF_MAYBE_UNUSED FFModuleBaseInfo* baseInfo, FF_MAYBE_UNUSED yyjson_mut_doc* jsonDoc)
+{
+    return true;
+}
+
+void ffDaemonEndModule(FF_MAYBE_UNUSED yyjson_mut_doc* jsonDoc)
+{
+}
+
+void ffDaemonServe(FF_MAYBE_UNUSED FFdata* data, FF_MAYBE_UNUSED void (*run)(FFdata* data))
+{
+    fputs("Error: daemon mode is not supported on Windows\n", stderr);
+    exit(1);
+}
+
+#endif // _WIN32
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "fastfetch.h"
+#include "common/commandoption.h"
+
+// Let a running daemon print the result for this process. Returns false if no daemon is available
+bool ffDaemonRunClient(int argc, char** argv);
+// Serve requests on `$XDG_RUNTIME_DIR/fastfetch.sock` until killed. Module results are rendered in the daemon.
+// `run` is called in a forked process for every request, it prints them and detects the modules that depend on the client
+void ffDaemonServe(FFdata* data, void (*run)(FFdata* data));
+// Called by the print loops around printing a module. Returns false if the module must not be printed,
+// because its result is kept by the daemon. Call ffDaemonEndModule after printing it otherwise
+bool ffDaemonBeginModule(FFModuleBaseInfo* baseInfo, yyjson_mut_doc* jsonDoc);
+void ffDaemonEndModule(yyjson_mut_doc* jsonDoc);
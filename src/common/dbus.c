@@ -2,12 +2,14 @@
 
 #ifdef FF_HAVE_DBUS
 
+#include "common/stat.h"
 #include "common/thread.h"
 #include "util/stringUtils.h"
 
 static bool loadLibSymbols(FFDBusLibrary* lib)
 {
     FF_LIBRARY_LOAD(dbus, &instance.config.library.libDBus, false, "libdbus-1" FF_LIBRARY_EXTENSION, 4);
+    FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_threads_init_default, false)
     FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_bus_get, false)
     FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_message_new_method_call, false)
     FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_message_append_args, false)
@@ -18,11 +20,21 @@ static bool loadLibSymbols(FFDBusLibrary* lib)
     FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_message_iter_has_next, false)
     FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_message_iter_next, false)
     FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_message_unref, false)
+    FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_message_get_type, false)
     FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_connection_send_with_reply_and_block, false)
+    FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_connection_send_with_reply, false)
+    FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_connection_flush, false)
+    FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_pending_call_block, false)
+    FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_pending_call_steal_reply, false)
+    FF_LIBRARY_LOAD_SYMBOL_PTR(dbus, lib, dbus_pending_call_unref, false)
     dbus = NULL; // don't auto dlclose
     return true;
 }
 
+#ifdef FF_HAVE_THREADS
+static FFThreadMutex mutex = FF_THREAD_MUTEX_INITIALIZER;
+#endif
+
 static const FFDBusLibrary* loadLib(void)
 {
     static FFDBusLibrary lib;
@@ -33,6 +45,9 @@ static const FFDBusLibrary* loadLib(void)
     {
         loaded = true;
         loadSuccess = loadLibSymbols(&lib);
+        // The connections are shared between detection threads. Only needed for libdbus < 1.7, which doesn't do it itself
+        if(loadSuccess)
+            lib.ffdbus_threads_init_default();
     }
 
     return loadSuccess ? &lib : NULL;
@@ -40,15 +55,43 @@ static const FFDBusLibrary* loadLib(void)
 
 const char* ffDBusLoadData(DBusBusType busType, FFDBusData* data)
 {
+    // One connection per bus for the whole process, opened by the first module that needs it.
+    // A bus that can't be reached isn't tried again by the next module
+    static struct
+    {
+        bool initialized;
+        DBusConnection* connection;
+        const char* error;
+    } buses[2]; // DBUS_BUS_SESSION, DBUS_BUS_SYSTEM
+
+    assert(busType == DBUS_BUS_SESSION || busType == DBUS_BUS_SYSTEM);
+    __typeof__(&buses[0]) bus = &buses[busType == DBUS_BUS_SYSTEM];
+
+    #ifdef FF_HAVE_THREADS
+    ffThreadMutexLock(&mutex);
+    #endif
+
     data->lib = loadLib();
-    if(data->lib == NULL)
-        return "Failed to load DBus library";
+    if(!bus->initialized)
+    {
+        bus->initialized = true;
+        if(data->lib == NULL)
+            bus->error = "Failed to load DBus library";
+        else
+        {
+            // Shared connection, owned by libdbus
+            bus->connection = data->lib->ffdbus_bus_get(busType, NULL);
+            if(bus->connection == NULL)
+                bus->error = "Failed to connect to DBus";
+        }
+    }
+    data->connection = bus->connection;
 
-    data->connection = data->lib->ffdbus_bus_get(busType, NULL);
-    if(data->connection == NULL)
-        return "Failed to connect to DBus";
+    #ifdef FF_HAVE_THREADS
+    ffThreadMutexUnlock(&mutex);
+    #endif
 
-    return NULL;
+    return bus->error;
 }
 
 bool ffDBusGetString(FFDBusData* dbus, DBusMessageIter* iter, FFstrbuf* result)
@@ -171,6 +214,7 @@ DBusMessage* ffDBusGetMethodReply(FFDBusData* dbus, const char* busName, const c
     if (arg)
         dbus->lib->ffdbus_message_append_args(message, DBUS_TYPE_STRING, &arg, DBUS_TYPE_INVALID);
 
+    ++ffStatCounters.dbusCalls;
     DBusMessage* reply = dbus->lib->ffdbus_connection_send_with_reply_and_block(dbus->connection, message, FF_DBUS_TIMEOUT_MILLISECONDS, NULL);
 
     dbus->lib->ffdbus_message_unref(message);
@@ -189,6 +233,7 @@ DBusMessage* ffDBusGetProperty(FFDBusData* dbus, const char* busName, const char
         DBUS_TYPE_STRING, &property,
         DBUS_TYPE_INVALID);
 
+    ++ffStatCounters.dbusCalls;
     DBusMessage* reply = dbus->lib->ffdbus_connection_send_with_reply_and_block(dbus->connection, message, FF_DBUS_TIMEOUT_MILLISECONDS, NULL);
 
     dbus->lib->ffdbus_message_unref(message);
@@ -236,4 +281,128 @@ bool ffDBusGetPropertyUint(FFDBusData* dbus, const char* busName, const char* ob
     return ret;
 }
 
+DBusMessage* ffDBusGetAllProperties(FFDBusData* dbus, const char* busName, const char* objectPath, const char* interface)
+{
+    return ffDBusGetMethodReply(dbus, busName, objectPath, "org.freedesktop.DBus.Properties", "GetAll", interface);
+}
+
+bool ffDBusFindProperty(FFDBusData* dbus, DBusMessage* reply, const char* property, DBusMessageIter* iter)
+{
+    if(reply == NULL)
+        return false;
+
+    // a{sv}
+    DBusMessageIter rootIterator;
+    if(!dbus->lib->ffdbus_message_iter_init(reply, &rootIterator) || dbus->lib->ffdbus_message_iter_get_arg_type(&rootIterator) != DBUS_TYPE_ARRAY)
+        return false;
+
+    DBusMessageIter arrayIterator;
+    dbus->lib->ffdbus_message_iter_recurse(&rootIterator, &arrayIterator);
+
+    do
+    {
+        if(dbus->lib->ffdbus_message_iter_get_arg_type(&arrayIterator) != DBUS_TYPE_DICT_ENTRY)
+            continue;
+
+        DBusMessageIter dictIterator;
+        dbus->lib->ffdbus_message_iter_recurse(&arrayIterator, &dictIterator);
+        if(dbus->lib->ffdbus_message_iter_get_arg_type(&dictIterator) != DBUS_TYPE_STRING)
+            continue;
+
+        const char* key;
+        dbus->lib->ffdbus_message_iter_get_basic(&dictIterator, &key);
+        if(!ffStrEquals(key, property) || !dbus->lib->ffdbus_message_iter_next(&dictIterator))
+            continue;
+
+        *iter = dictIterator;
+        return true;
+    } while(dbus->lib->ffdbus_message_iter_next(&arrayIterator));
+
+    return false;
+}
+
+static uint32_t batchAdd(FFDBusBatch* batch, DBusMessage* message)
+{
+    assert(batch->count < FF_DBUS_BATCH_MAX_CALLS);
+    uint32_t index = batch->count++;
+    batch->calls[index] = NULL;
+    batch->replies[index] = NULL;
+
+    if(message == NULL)
+        return index;
+
+    ++ffStatCounters.dbusCalls;
+    // Only queued here, ffDBusBatchWait writes it. The timeout starts now
+    if(!batch->dbus->lib->ffdbus_connection_send_with_reply(batch->dbus->connection, message, &batch->calls[index], FF_DBUS_TIMEOUT_MILLISECONDS))
+        batch->calls[index] = NULL;
+
+    batch->dbus->lib->ffdbus_message_unref(message);
+    return index;
+}
+
+uint32_t ffDBusBatchAddMethodCall(FFDBusBatch* batch, const char* busName, const char* objectPath, const char* interface, const char* method, const char* arg)
+{
+    DBusMessage* message = batch->dbus->lib->ffdbus_message_new_method_call(busName, objectPath, interface, method);
+    if(message && arg)
+        batch->dbus->lib->ffdbus_message_append_args(message, DBUS_TYPE_STRING, &arg, DBUS_TYPE_INVALID);
+    return batchAdd(batch, message);
+}
+
+uint32_t ffDBusBatchAddGetProperty(FFDBusBatch* batch, const char* busName, const char* objectPath, const char* interface, const char* property)
+{
+    DBusMessage* message = batch->dbus->lib->ffdbus_message_new_method_call(busName, objectPath, "org.freedesktop.DBus.Properties", "Get");
+    if(message)
+    {
+        batch->dbus->lib->ffdbus_message_append_args(message,
+            DBUS_TYPE_STRING, &interface,
+            DBUS_TYPE_STRING, &property,
+            DBUS_TYPE_INVALID);
+    }
+    return batchAdd(batch, message);
+}
+
+uint32_t ffDBusBatchAddGetAllProperties(FFDBusBatch* batch, const char* busName, const char* objectPath, const char* interface)
+{
+    return ffDBusBatchAddMethodCall(batch, busName, objectPath, "org.freedesktop.DBus.Properties", "GetAll", interface);
+}
+
+void ffDBusBatchWait(FFDBusBatch* batch)
+{
+    // Write all queued calls before waiting for the first reply. Every call was queued at about the same time with the same timeout,
+    // so the waits below end together at the latest
+    batch->dbus->lib->ffdbus_connection_flush(batch->dbus->connection);
+
+    for(uint32_t i = 0; i < batch->count; ++i)
+    {
+        DBusPendingCall* call = batch->calls[i];
+        if(call == NULL)
+            continue;
+
+        batch->dbus->lib->ffdbus_pending_call_block(call);
+        DBusMessage* reply = batch->dbus->lib->ffdbus_pending_call_steal_reply(call);
+        batch->dbus->lib->ffdbus_pending_call_unref(call);
+        batch->calls[i] = NULL;
+
+        // Timeouts and errors are reported as error replies. Drop them like dbus_connection_send_with_reply_and_block does
+        if(reply && batch->dbus->lib->ffdbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR)
+        {
+            batch->dbus->lib->ffdbus_message_unref(reply);
+            reply = NULL;
+        }
+        batch->replies[i] = reply;
+    }
+}
+
+void ffDBusBatchDestroy(FFDBusBatch* batch)
+{
+    for(uint32_t i = 0; i < batch->count; ++i)
+    {
+        if(batch->calls[i])
+            batch->dbus->lib->ffdbus_pending_call_unref(batch->calls[i]);
+        if(batch->replies[i])
+            batch->dbus->lib->ffdbus_message_unref(batch->replies[i]);
+    }
+    batch->count = 0;
+}
+
 #endif //FF_HAVE_DBUS
@@ -10,6 +10,7 @@
 
 typedef struct FFDBusLibrary
 {
+    FF_LIBRARY_SYMBOL(dbus_threads_init_default)
     FF_LIBRARY_SYMBOL(dbus_bus_get)
     FF_LIBRARY_SYMBOL(dbus_message_new_method_call)
     FF_LIBRARY_SYMBOL(dbus_message_append_args)
@@ -20,7 +21,13 @@ typedef struct FFDBusLibrary
     FF_LIBRARY_SYMBOL(dbus_message_iter_has_next)
     FF_LIBRARY_SYMBOL(dbus_message_iter_next)
     FF_LIBRARY_SYMBOL(dbus_message_unref)
+    FF_LIBRARY_SYMBOL(dbus_message_get_type)
     FF_LIBRARY_SYMBOL(dbus_connection_send_with_reply_and_block)
+    FF_LIBRARY_SYMBOL(dbus_connection_send_with_reply)
+    FF_LIBRARY_SYMBOL(dbus_connection_flush)
+    FF_LIBRARY_SYMBOL(dbus_pending_call_block)
+    FF_LIBRARY_SYMBOL(dbus_pending_call_steal_reply)
+    FF_LIBRARY_SYMBOL(dbus_pending_call_unref)
 } FFDBusLibrary;
 
 typedef struct FFDBusData
@@ -29,7 +36,8 @@ typedef struct FFDBusData
     DBusConnection* connection;
 } FFDBusData;
 
-const char* ffDBusLoadData(DBusBusType busType, FFDBusData* data); //Returns an error message or NULL on success
+// Returns the connection to the session or system bus that all modules share. Returns an error message or NULL on success
+const char* ffDBusLoadData(DBusBusType busType, FFDBusData* data);
 bool ffDBusGetString(FFDBusData* dbus, DBusMessageIter* iter, FFstrbuf* result);
 bool ffDBusGetBool(FFDBusData* dbus, DBusMessageIter* iter, bool* result);
 bool ffDBusGetUint(FFDBusData* dbus, DBusMessageIter* iter, uint32_t* result);
@@ -37,5 +45,39 @@ DBusMessage* ffDBusGetMethodReply(FFDBusData* dbus, const char* busName, const c
 DBusMessage* ffDBusGetProperty(FFDBusData* dbus, const char* busName, const char* objectPath, const char* interface, const char* property);
 bool ffDBusGetPropertyString(FFDBusData* dbus, const char* busName, const char* objectPath, const char* interface, const char* property, FFstrbuf* result);
 bool ffDBusGetPropertyUint(FFDBusData* dbus, const char* busName, const char* objectPath, const char* interface, const char* property, uint32_t* result);
+DBusMessage* ffDBusGetAllProperties(FFDBusData* dbus, const char* busName, const char* objectPath, const char* interface);
+// Points `iter` to the value of `property` in a reply of GetAll. Returns false if the reply is NULL or doesn't contain it
+bool ffDBusFindProperty(FFDBusData* dbus, DBusMessage* reply, const char* property, DBusMessageIter* iter);
+
+#define FF_DBUS_BATCH_MAX_CALLS 8
+
+// Sends several calls at once and waits for all replies, so that they cost one round trip instead of one each.
+// The calls share one deadline of FF_DBUS_TIMEOUT_MILLISECONDS after they were added
+typedef struct FFDBusBatch
+{
+    FFDBusData* dbus;
+    uint32_t count;
+    DBusPendingCall* calls[FF_DBUS_BATCH_MAX_CALLS];
+    DBusMessage* replies[FF_DBUS_BATCH_MAX_CALLS];
+} FFDBusBatch;
+
+static inline void ffDBusBatchInit(FFDBusBatch* batch, FFDBusData* dbus)
+{
+    batch->dbus = dbus;
+    batch->count = 0;
+}
+
+// The add functions return the index of the call, to be passed to ffDBusBatchGetReply
+uint32_t ffDBusBatchAddMethodCall(FFDBusBatch* batch, const char* busName, const char* objectPath, const char* interface, const char* method, const char* arg);
+uint32_t ffDBusBatchAddGetProperty(FFDBusBatch* batch, const char* busName, const char* objectPath, const char* interface, const char* property);
+uint32_t ffDBusBatchAddGetAllProperties(FFDBusBatch* batch, const char* busName, const char* objectPath, const char* interface);
+void ffDBusBatchWait(FFDBusBatch* batch);
+// NULL if the call failed or timed out. The reply is owned by the batch
+static inline DBusMessage* ffDBusBatchGetReply(FFDBusBatch* batch, uint32_t index)
+{
+    return index < batch->count ? batch->replies[index] : NULL;
+}
+void ffDBusBatchDestroy(FFDBusBatch* batch);
+#define FF_DBUS_BATCH_AUTO_DESTROY FFDBusBatch __attribute__((__cleanup__(ffDBusBatchDestroy)))
 
 #endif // FF_HAVE_DBUS
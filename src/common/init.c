@@ -1,10 +1,15 @@
 #include "fastfetch.h"
+#include "common/configsnapshot.h"
+#include "common/jsonconfig.h"
 #include "common/parsing.h"
+#include "common/scheduler.h"
 #include "common/thread.h"
+#include "common/trace.h"
 #include "detection/displayserver/displayserver.h"
 #include "detection/terminaltheme/terminaltheme.h"
 #include "util/textModifier.h"
 #include "logo/logo.h"
+#include "modules/command/command.h"
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -25,12 +30,18 @@ static void initState(FFstate* state)
     state->keysHeight = 0;
     state->terminalLightTheme = false;
 
-    ffPlatformInit(&state->platform);
+    {
+        FF_TRACE_SPAN(span, "init", "ffPlatformInit", NULL);
+        ffPlatformInit(&state->platform);
+    }
     state->configDoc = NULL;
     state->resultDoc = NULL;
+    state->daemonMode = false;
+    state->parentPid = 0;
 
     {
         // don't enable bright color if the terminal is in light mode
+        FF_TRACE_SPAN(span, "init", "ffDetectTerminalTheme", NULL);
         FFTerminalThemeResult result;
         if (ffDetectTerminalTheme(&result, true /* forceEnv for performance */) && !result.bg.dark)
             state->terminalLightTheme = true;
@@ -98,11 +109,6 @@ static void exitSignalHandler(int signal)
 
 void ffStart(void)
 {
-    #ifdef FF_START_DETECTION_THREADS
-        if(instance.config.general.multithreading)
-            startDetectionThreads();
-    #endif
-
     ffDisableLinewrap = instance.config.display.disableLinewrap && !instance.config.display.pipe && !instance.state.resultDoc;
     ffHideCursor = instance.config.display.hideCursor && !instance.config.display.pipe && !instance.state.resultDoc;
 
@@ -159,12 +165,16 @@ static void destroyState(void)
 {
     ffPlatformDestroy(&instance.state.platform);
     yyjson_doc_free(instance.state.configDoc);
+    ffConfigSnapshotDestroy();
     yyjson_mut_doc_free(instance.state.resultDoc);
     ffStrbufDestroy(&instance.state.genConfigPath);
 }
 
 void ffDestroyInstance(void)
 {
+    ffSchedulerDestroy();
+    ffJsonConfigDestroy();
+    ffDestroyPreparedCommands();
     destroyConfig();
     destroyState();
 }
@@ -263,6 +273,9 @@ void ffListFeatures(void)
         #if FF_HAVE_LINUX_WIRELESS
             "linux/wireless\n"
         #endif
+        #if FF_HAVE_LINUX_IO_URING
+            "linux/io_uring\n"
+        #endif
         ""
     , stdout);
 }
@@ -2,6 +2,7 @@
 
 #include "util/FFstrbuf.h"
 #include "util/FFlist.h"
+#include "common/stat.h"
 
 #ifdef _WIN32
     #include <fileapi.h>
@@ -55,12 +56,16 @@ static inline bool ffWriteFileBuffer(const char* fileName, const FFstrbuf* buffe
 static inline ssize_t ffReadFDData(FFNativeFD fd, size_t dataSize, void* data)
 {
     #ifndef _WIN32
-        return read(fd, data, dataSize);
+        ssize_t bytesRead = read(fd, data, dataSize);
+        if (bytesRead > 0)
+            ffStatCounters.bytesRead += (uint64_t) bytesRead;
+        return bytesRead;
     #else
         DWORD bytesRead;
         if(!ReadFile(fd, data, (DWORD)dataSize, &bytesRead, NULL))
             return -1;
 
+        ffStatCounters.bytesRead += bytesRead;
         return (ssize_t)bytesRead;
     #endif
 }
@@ -76,6 +81,56 @@ static inline bool ffReadFileBuffer(const char* fileName, FFstrbuf* buffer)
     return ffAppendFileBuffer(fileName, buffer);
 }
 
+#ifndef _WIN32
+// readdir that is accounted in `--stat`
+static inline struct dirent* ffReadDir(DIR* dir)
+{
+    struct dirent* entry = readdir(dir);
+    if (entry)
+        ++ffStatCounters.dirEntries;
+    return entry;
+}
+
+// Maps `fileName` read-only, so that only the pages that are accessed get read. Release with munmap(result, *size).
+// Returns NULL if the file can't be opened or is empty
+void* ffMapFile(const char* fileName, size_t* size);
+
+// Reading many attributes of one sysfs device through absolute paths resolves the whole path every time.
+// Open the device directory once with ffOpenDirRelative and read its attributes relative to it instead.
+// `dfd` is ignored for absolute paths; the returned fd must be closed, see FF_AUTO_CLOSE_FD
+int ffOpenDirRelative(int dfd, const char* path);
+ssize_t ffReadFileDataRelative(int dfd, const char* fileName, size_t dataSize, void* data);
+bool ffAppendFileBufferRelative(int dfd, const char* fileName, FFstrbuf* buffer);
+
+static inline bool ffReadFileBufferRelative(int dfd, const char* fileName, FFstrbuf* buffer)
+{
+    ffStrbufClear(buffer);
+    return ffAppendFileBufferRelative(dfd, fileName, buffer);
+}
+
+// Reads a small text attribute into a NUL terminated (stack) buffer, with trailing white spaces trimmed.
+// Returns the length, or -1 if it can't be read
+ssize_t ffReadFileStrRelative(int dfd, const char* fileName, size_t bufSize, char* buf);
+// Reads an attribute that contains a single decimal number, e.g. `size` or `statistics/rx_bytes`
+bool ffReadFileUInt64Relative(int dfd, const char* fileName, uint64_t* value);
+bool ffReadFileInt64Relative(int dfd, const char* fileName, int64_t* value);
+// readlinkat that NUL terminates `buf`. Returns the length, or -1 on error or truncation
+ssize_t ffReadLinkRelative(int dfd, const char* fileName, size_t bufSize, char* buf);
+
+typedef struct FFReadFileRequest
+{
+    int dfd; // `path` is relative to it, see ffOpenDirRelative. Ignored for absolute paths
+    const char* path;
+    size_t size;
+    void* buf; // not NUL terminated
+    ssize_t result; // set to the number of bytes read, or -1
+} FFReadFileRequest;
+
+// Reads many small files, e.g. the same attribute of every device, at once.
+// On Linux this submits open + read + close of all of them to io_uring if available; reads them one by one otherwise
+void ffReadFilesBatch(uint32_t count, FFReadFileRequest requests[]);
+#endif
+
 //Bit flags, combine with |
 typedef enum FFPathType
 {
@@ -2,11 +2,14 @@
 #include "fastfetch.h"
 #include "util/stringUtils.h"
 
+#include <ctype.h>
 #include <fcntl.h>
+#include <stdlib.h>
 #include <termios.h>
 #include <poll.h>
 #include <dirent.h>
 #include <errno.h>
+#include <sys/mman.h>
 
 #if FF_HAVE_WORDEXP
     #include <wordexp.h>
@@ -78,6 +81,8 @@ static inline void readUntilEOF(int fd, FFstrbuf* buffer)
 
 bool ffAppendFDBuffer(int fd, FFstrbuf* buffer)
 {
+    uint32_t startLength = buffer->length;
+
     struct stat fileInfo;
     if(fstat(fd, &fileInfo) != 0)
         return false;
@@ -88,6 +93,7 @@ bool ffAppendFDBuffer(int fd, FFstrbuf* buffer)
         readUntilEOF(fd, buffer);
 
     buffer->chars[buffer->length] = '\0';
+    ffStatCounters.bytesRead += buffer->length - startLength;
 
     return buffer->length > 0;
 }
@@ -97,6 +103,7 @@ ssize_t ffReadFileData(const char* fileName, size_t dataSize, void* data)
     int FF_AUTO_CLOSE_FD fd = open(fileName, O_RDONLY | O_CLOEXEC);
     if(fd == -1)
         return -1;
+    ++ffStatCounters.filesOpened;
 
     return ffReadFDData(fd, dataSize, data);
 }
@@ -106,10 +113,123 @@ bool ffAppendFileBuffer(const char* fileName, FFstrbuf* buffer)
     int FF_AUTO_CLOSE_FD fd = open(fileName, O_RDONLY | O_CLOEXEC);
     if(fd == -1)
         return false;
+    ++ffStatCounters.filesOpened;
+
+    return ffAppendFDBuffer(fd, buffer);
+}
+
+void* ffMapFile(const char* fileName, size_t* size)
+{
+    int FF_AUTO_CLOSE_FD fd = open(fileName, O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        return NULL;
+    ++ffStatCounters.filesOpened;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0)
+        return NULL;
+
+    void* data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED)
+        return NULL;
+
+    *size = (size_t) st.st_size;
+    return data;
+}
+
+int ffOpenDirRelative(int dfd, const char* path)
+{
+    int fd = openat(dfd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd >= 0)
+        ++ffStatCounters.filesOpened;
+    return fd;
+}
+
+ssize_t ffReadFileDataRelative(int dfd, const char* fileName, size_t dataSize, void* data)
+{
+    int FF_AUTO_CLOSE_FD fd = openat(dfd, fileName, O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        return -1;
+    ++ffStatCounters.filesOpened;
+
+    return ffReadFDData(fd, dataSize, data);
+}
+
+bool ffAppendFileBufferRelative(int dfd, const char* fileName, FFstrbuf* buffer)
+{
+    int FF_AUTO_CLOSE_FD fd = openat(dfd, fileName, O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        return false;
+    ++ffStatCounters.filesOpened;
 
     return ffAppendFDBuffer(fd, buffer);
 }
 
+ssize_t ffReadFileStrRelative(int dfd, const char* fileName, size_t bufSize, char* buf)
+{
+    assert(bufSize > 0);
+    ssize_t length = ffReadFileDataRelative(dfd, fileName, bufSize - 1, buf);
+    if(length < 0)
+        return -1;
+
+    while(length > 0 && isspace((unsigned char) buf[length - 1]))
+        --length;
+    buf[length] = '\0';
+    return length;
+}
+
+bool ffReadFileUInt64Relative(int dfd, const char* fileName, uint64_t* value)
+{
+    char buf[32];
+    if(ffReadFileStrRelative(dfd, fileName, sizeof(buf), buf) <= 0)
+        return false;
+
+    char* end;
+    errno = 0;
+    unsigned long long result = strtoull(buf, &end, 10);
+    if(end == buf || errno != 0)
+        return false;
+    *value = (uint64_t) result;
+    return true;
+}
+
+bool ffReadFileInt64Relative(int dfd, const char* fileName, int64_t* value)
+{
+    char buf[32];
+    if(ffReadFileStrRelative(dfd, fileName, sizeof(buf), buf) <= 0)
+        return false;
+
+    char* end;
+    errno = 0;
+    long long result = strtoll(buf, &end, 10);
+    if(end == buf || errno != 0)
+        return false;
+    *value = (int64_t) result;
+    return true;
+}
+
+ssize_t ffReadLinkRelative(int dfd, const char* fileName, size_t bufSize, char* buf)
+{
+    ssize_t length = readlinkat(dfd, fileName, buf, bufSize);
+    if(length < 0 || (size_t) length >= bufSize) // doesn't contain trailing NUL
+        return -1;
+    buf[length] = '\0';
+    return length;
+}
+
+void ffReadFilesBatch(uint32_t count, FFReadFileRequest requests[])
+{
+    #if __linux__ && FF_HAVE_LINUX_IO_URING
+    // Setting up a ring costs a few syscalls itself
+    bool ffReadFilesBatchIoUring(uint32_t count, FFReadFileRequest requests[]);
+    if (count >= 8 && ffReadFilesBatchIoUring(count, requests))
+        return;
+    #endif
+
+    for (uint32_t i = 0; i < count; ++i)
+        requests[i].result = ffReadFileDataRelative(requests[i].dfd, requests[i].path, requests[i].size, requests[i].buf);
+}
+
 bool ffPathExpandEnv(FF_MAYBE_UNUSED const char* in, FF_MAYBE_UNUSED FFstrbuf* out)
 {
     bool result = false;
@@ -0,0 +1,257 @@
+#include "io.h"
+
+#if FF_HAVE_LINUX_IO_URING
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <linux/io_uring.h>
+
+// Files per submission. Every file takes 3 SQEs (openat, read, close) and one direct descriptor slot
+#define FF_IO_URING_CHUNK 64
+
+typedef struct FFIoUring
+{
+    int fd;
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+
+    uint32_t* sqTail;
+    uint32_t sqMask;
+    uint32_t* sqArray;
+    uint32_t* cqHead;
+    uint32_t* cqTail;
+    uint32_t cqMask;
+    struct io_uring_cqe* cqes;
+} FFIoUring;
+
+// 1 once the kernel has been checked, -1 once io_uring turned out to be unusable: kernel too old, disabled by sysctl or seccomp
+static int availability;
+
+static void destroyRing(FFIoUring* ring)
+{
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing && ring->cqRing != MAP_FAILED && ring->cqRing != ring->sqRing)
+        munmap(ring->cqRing, ring->cqRingSize);
+    if (ring->sqRing && ring->sqRing != MAP_FAILED)
+        munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->fd); // Also closes the direct descriptors left in the file table
+}
+
+// Opening into direct descriptors (`file_index`) requires Linux 5.15. Older kernels ignore the field without an error:
+// the opened files would leak, the fixed reads would fail and the linked close would close fd 0
+static bool checkSupport(int ringFd)
+{
+    struct utsname name;
+    unsigned major, minor;
+    if (uname(&name) != 0 || sscanf(name.release, "%u.%u", &major, &minor) != 2 || (major < 5 || (major == 5 && minor < 15)))
+        return false;
+
+    // The opcodes may still be disabled, e.g. by io_uring restrictions
+    const uint32_t maxOps = 256;
+    struct io_uring_probe* probe = calloc(1, sizeof(*probe) + maxOps * sizeof(struct io_uring_probe_op));
+    if (!probe)
+        return false;
+    bool result = syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, maxOps) == 0;
+    const uint8_t ops[] = { IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE };
+    for (uint32_t i = 0; result && i < sizeof(ops) / sizeof(ops[0]); ++i)
+        result = ops[i] < probe->ops_len && (probe->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+    return result;
+}
+
+static bool initRing(FFIoUring* ring, uint32_t files)
+{
+    struct io_uring_params params = {};
+    ring->fd = (int) syscall(__NR_io_uring_setup, files * 3, &params);
+    if (ring->fd < 0)
+        return false;
+
+    if (__atomic_load_n(&availability, __ATOMIC_RELAXED) == 0)
+    {
+        if (!checkSupport(ring->fd))
+            return false;
+        __atomic_store_n(&availability, 1, __ATOMIC_RELAXED);
+    }
+
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cqRingSize > ring->sqRingSize)
+            ring->sqRingSize = ring->cqRingSize;
+        ring->cqRingSize = ring->sqRingSize;
+    }
+
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sqRing == MAP_FAILED)
+        return false;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        ring->cqRing = ring->sqRing;
+    else
+    {
+        ring->cqRing = mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED)
+            return false;
+    }
+
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+        return false;
+
+    ring->sqTail = (uint32_t*) ((char*) ring->sqRing + params.sq_off.tail);
+    ring->sqMask = *(uint32_t*) ((char*) ring->sqRing + params.sq_off.ring_mask);
+    ring->sqArray = (uint32_t*) ((char*) ring->sqRing + params.sq_off.array);
+    ring->cqHead = (uint32_t*) ((char*) ring->cqRing + params.cq_off.head);
+    ring->cqTail = (uint32_t*) ((char*) ring->cqRing + params.cq_off.tail);
+    ring->cqMask = *(uint32_t*) ((char*) ring->cqRing + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*) ((char*) ring->cqRing + params.cq_off.cqes);
+
+    // Sparse table of direct descriptors. openat installs files into it, so that the linked read can refer to them
+    int fds[FF_IO_URING_CHUNK];
+    memset(fds, -1, sizeof(fds));
+    return syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES, fds, files) == 0;
+}
+
+static struct io_uring_sqe* getSqe(FFIoUring* ring, uint32_t tail, uint64_t userData)
+{
+    uint32_t index = tail & ring->sqMask;
+    ring->sqArray[index] = index;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = userData;
+    return sqe;
+}
+
+// Returns false if not all SQEs of the chunk could be submitted, after collecting the completions of those that were.
+// The whole chunk must be read synchronously then
+static bool submitChunk(FFIoUring* ring, uint32_t count, FFReadFileRequest requests[], int32_t openResults[])
+{
+    uint32_t tail = *ring->sqTail;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        FFReadFileRequest* request = &requests[i];
+        request->result = -1;
+        openResults[i] = -ECANCELED;
+
+        // The read is canceled if the open fails. The close runs even if the read is short
+        struct io_uring_sqe* sqe = getSqe(ring, tail++, i * 3 + 0);
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->fd = request->dfd;
+        sqe->addr = (uint64_t) (uintptr_t) request->path;
+        sqe->open_flags = O_RDONLY; // O_CLOEXEC is invalid for direct descriptors, which are never inherited anyway
+        sqe->file_index = i + 1;
+
+        sqe = getSqe(ring, tail++, i * 3 + 1);
+        sqe->opcode = IORING_OP_READ;
+        sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+        sqe->fd = (int32_t) i;
+        sqe->addr = (uint64_t) (uintptr_t) request->buf;
+        sqe->len = request->size > UINT32_MAX ? UINT32_MAX : (uint32_t) request->size;
+
+        sqe = getSqe(ring, tail++, i * 3 + 2);
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->file_index = i + 1;
+    }
+    __atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+
+    // The kernel stops submitting at the first SQE it rejects. Every SQE it consumed posts a completion, even if canceled
+    uint32_t total = count * 3;
+    long submitted = syscall(__NR_io_uring_enter, ring->fd, total, total, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (submitted <= 0)
+        return false;
+
+    uint32_t pending = (uint32_t) submitted;
+    while (pending > 0)
+    {
+        uint32_t head = *ring->cqHead;
+        uint32_t cqTail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        if (head == cqTail)
+        {
+            if (syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+                return false;
+            continue;
+        }
+
+        for (; head != cqTail; ++head, --pending)
+        {
+            const struct io_uring_cqe* cqe = &ring->cqes[head & ring->cqMask];
+            uint32_t index = (uint32_t) (cqe->user_data / 3);
+            switch (cqe->user_data % 3)
+            {
+                case 0:
+                    openResults[index] = cqe->res;
+                    if (cqe->res >= 0)
+                        ++ffStatCounters.filesOpened;
+                    break;
+                case 1:
+                    if (cqe->res >= 0)
+                    {
+                        requests[index].result = cqe->res;
+                        ffStatCounters.bytesRead += (uint64_t) cqe->res;
+                    }
+                    break;
+            }
+        }
+        __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    return submitted == total;
+}
+
+bool ffReadFilesBatchIoUring(uint32_t count, FFReadFileRequest requests[])
+{
+    if (__atomic_load_n(&availability, __ATOMIC_RELAXED) < 0)
+        return false;
+
+    FFIoUring ring = { .fd = -1 };
+    if (!initRing(&ring, count < FF_IO_URING_CHUNK ? count : FF_IO_URING_CHUNK))
+    {
+        if (ring.fd >= 0)
+            destroyRing(&ring);
+        __atomic_store_n(&availability, -1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    for (uint32_t start = 0; start < count; start += FF_IO_URING_CHUNK)
+    {
+        uint32_t chunk = count - start < FF_IO_URING_CHUNK ? count - start : FF_IO_URING_CHUNK;
+        int32_t openResults[FF_IO_URING_CHUNK];
+        if (!submitChunk(&ring, chunk, requests + start, openResults))
+        {
+            __atomic_store_n(&availability, -1, __ATOMIC_RELAXED);
+            for (uint32_t i = start; i < count; ++i)
+                requests[i].result = ffReadFileDataRelative(requests[i].dfd, requests[i].path, requests[i].size, requests[i].buf);
+            break;
+        }
+
+        for (uint32_t i = 0; i < chunk; ++i)
+        {
+            // EINVAL: the kernel doesn't support opening into direct descriptors (< 5.15)
+            if (openResults[i] == -EINVAL)
+            {
+                __atomic_store_n(&availability, -1, __ATOMIC_RELAXED);
+                FFReadFileRequest* request = &requests[start + i];
+                request->result = ffReadFileDataRelative(request->dfd, request->path, request->size, request->buf);
+            }
+        }
+    }
+
+    destroyRing(&ring);
+    return true;
+}
+
+#endif // FF_HAVE_LINUX_IO_URING
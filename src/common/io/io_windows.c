@@ -68,6 +68,8 @@ static inline void readUntilEOF(HANDLE handle, FFstrbuf* buffer)
 
 bool ffAppendFDBuffer(HANDLE handle, FFstrbuf* buffer)
 {
+    uint32_t startLength = buffer->length;
+
     LARGE_INTEGER fileSize;
     if(!GetFileSizeEx(handle, &fileSize))
         fileSize.QuadPart = 0;
@@ -78,6 +80,7 @@ bool ffAppendFDBuffer(HANDLE handle, FFstrbuf* buffer)
         readUntilEOF(handle, buffer);
 
     buffer->chars[buffer->length] = '\0';
+    ffStatCounters.bytesRead += buffer->length - startLength;
 
     return buffer->length > 0;
 }
@@ -87,6 +90,7 @@ ssize_t ffReadFileData(const char* fileName, size_t dataSize, void* data)
     HANDLE FF_AUTO_CLOSE_FD handle = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     if(handle == INVALID_HANDLE_VALUE)
         return -1;
+    ++ffStatCounters.filesOpened;
 
     return ffReadFDData(handle, dataSize, data);
 }
@@ -96,6 +100,7 @@ bool ffAppendFileBuffer(const char* fileName, FFstrbuf* buffer)
     HANDLE FF_AUTO_CLOSE_FD handle = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     if(handle == INVALID_HANDLE_VALUE)
         return false;
+    ++ffStatCounters.filesOpened;
 
     return ffAppendFDBuffer(handle, buffer);
 }
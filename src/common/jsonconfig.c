@@ -1,9 +1,15 @@
 #include "fastfetch.h"
-#include "common/color.h"
+#include "common/cache.h"
+#include "common/configsnapshot.h"
+#include "common/daemon.h"
 #include "common/jsonconfig.h"
 #include "common/printing.h"
+#include "common/stat.h"
+#include "common/trace.h"
 #include "common/io/io.h"
-#include "common/time.h"
+#include "common/watch.h"
+#include "detection/terminalshell/terminalshell.h"
+#include "detection/vulkan/vulkan.h"
 #include "modules/modules.h"
 #include "util/stringUtils.h"
 
@@ -105,32 +111,47 @@ static inline void genJsonResult(FFModuleBaseInfo* baseInfo, yyjson_mut_doc* doc
         yyjson_mut_obj_add_str(doc, module, "error", "Unsupported for JSON format");
 }
 
-static bool parseModuleJsonObject(const char* type, yyjson_val* jsonVal, yyjson_mut_doc* jsonDoc)
+static FFModuleBaseInfo* findModule(const char* type)
 {
-    if(!ffCharIsEnglishAlphabet(type[0])) return false;
+    if(!ffCharIsEnglishAlphabet(type[0])) return NULL;
 
     for (FFModuleBaseInfo** modules = ffModuleInfos[toupper(type[0]) - 'A']; *modules; ++modules)
     {
-        FFModuleBaseInfo* baseInfo = *modules;
-        if (ffStrEqualsIgnCase(type, baseInfo->name))
-        {
-            if (jsonVal) baseInfo->parseJsonObject(baseInfo, jsonVal);
-            if (__builtin_expect(jsonDoc != NULL, false))
-                genJsonResult(baseInfo, jsonDoc);
-            else
-                baseInfo->printModule(baseInfo);
-            return true;
-        }
+        if (ffStrEqualsIgnCase(type, (*modules)->name))
+            return *modules;
     }
-    return false;
+    return NULL;
+}
+
+// Options come either from the module object of the config file or from its snapshot
+static inline void parseModuleOptions(void* options, yyjson_val* module, const FFConfigSnapshotModule* compiled)
+{
+    if (compiled)
+        ffConfigSnapshotApplyModule(compiled, options);
+    else if (module)
+        ((FFModuleBaseInfo*) options)->parseJsonObject(options, module);
 }
 
-static void prepareModuleJsonObject(const char* type, yyjson_val* module)
+static void printModule(FFModuleBaseInfo* baseInfo, yyjson_val* module, const FFConfigSnapshotModule* compiled, yyjson_mut_doc* jsonDoc)
+{
+    parseModuleOptions(baseInfo, module, compiled);
+    if (!ffDaemonBeginModule(baseInfo, jsonDoc))
+        return;
+    if (__builtin_expect(jsonDoc != NULL, false))
+        genJsonResult(baseInfo, jsonDoc);
+    else
+        baseInfo->printModule(baseInfo);
+    ffDaemonEndModule(jsonDoc);
+}
+
+static FFCommandOptions preparedCommandOptions; // see prepareModuleJsonObject
+
+static void prepareModuleJsonObject(const char* type, yyjson_val* module, const FFConfigSnapshotModule* compiled)
 {
     FFconfig* cfg = &instance.config;
     switch (type[0])
     {
-        case 'b': case 'B': {
+        case 'c': case 'C': {
             if (ffStrEqualsIgnCase(type, FF_CPUUSAGE_MODULE_NAME))
                 ffPrepareCPUUsage();
             break;
@@ -138,7 +159,7 @@ static void prepareModuleJsonObject(const char* type, yyjson_val* module)
         case 'd': case 'D': {
             if (ffStrEqualsIgnCase(type, FF_DISKIO_MODULE_NAME))
             {
-                if (module) cfg->modules.diskIo.moduleInfo.parseJsonObject(&cfg->modules.diskIo, module);
+                parseModuleOptions(&cfg->modules.diskIo, module, compiled);
                 ffPrepareDiskIO(&cfg->modules.diskIo);
             }
             break;
@@ -146,23 +167,80 @@ static void prepareModuleJsonObject(const char* type, yyjson_val* module)
         case 'n': case 'N': {
             if (ffStrEqualsIgnCase(type, FF_NETIO_MODULE_NAME))
             {
-                if (module) cfg->modules.netIo.moduleInfo.parseJsonObject(&cfg->modules.netIo, module);
+                parseModuleOptions(&cfg->modules.netIo, module, compiled);
                 ffPrepareNetIO(&cfg->modules.netIo);
             }
             break;
         }
+    }
+
+    // The daemon renders other modules one at a time. Its request handlers only detect the few modules that depend on the client
+    if (instance.state.daemonMode)
+        return;
+
+    switch (type[0])
+    {
+        case 'c': case 'C': {
+            if (ffStrEqualsIgnCase(type, FF_COMMAND_MODULE_NAME) && cfg->general.multithreading)
+            {
+                // Options of Command modules carry over to the next one when printing.
+                // Replay that in a copy, so that printing starts from the same options as without preparing
+                FFCommandOptions* options = &preparedCommandOptions;
+                if (!options->moduleInfo.name)
+                {
+                    ffInitCommandOptions(options);
+                    ffStrbufSet(&options->shell, &cfg->modules.command.shell);
+                    ffStrbufSet(&options->text, &cfg->modules.command.text);
+                }
+                parseModuleOptions(options, module, compiled);
+                ffPrepareCommand(options);
+            }
+            break;
+        }
+        case 'g': case 'G': {
+            if (ffStrEqualsIgnCase(type, FF_GPU_MODULE_NAME) && cfg->general.multithreading)
+            {
+                parseModuleOptions(&cfg->modules.gpu, module, compiled);
+                ffPrepareGPU(&cfg->modules.gpu);
+            }
+            break;
+        }
         case 'p': case 'P': {
             if (ffStrEqualsIgnCase(type, FF_PUBLICIP_MODULE_NAME))
             {
-                if (module) cfg->modules.publicIP.moduleInfo.parseJsonObject(&cfg->modules.publicIP, module);
+                parseModuleOptions(&cfg->modules.publicIP, module, compiled);
                 ffPreparePublicIp(&cfg->modules.publicIP);
             }
+            else if (ffStrEqualsIgnCase(type, FF_PACKAGES_MODULE_NAME) && cfg->general.multithreading)
+            {
+                parseModuleOptions(&cfg->modules.packages, module, compiled);
+                ffPreparePackages(&cfg->modules.packages);
+            }
+            break;
+        }
+        case 's': case 'S': {
+            if (!cfg->general.multithreading)
+                break;
+            if (ffStrEqualsIgnCase(type, FF_SHELL_MODULE_NAME))
+                ffPrepareTerminalShell();
+            else if (ffStrEqualsIgnCase(type, FF_SOUND_MODULE_NAME))
+                ffPrepareSound(&cfg->modules.sound);
+            break;
+        }
+        case 't': case 'T': {
+            if (ffStrEqualsIgnCase(type, FF_TERMINAL_MODULE_NAME) && cfg->general.multithreading)
+                ffPrepareTerminalShell();
+            break;
+        }
+        case 'v': case 'V': {
+            if (ffStrEqualsIgnCase(type, FF_VULKAN_MODULE_NAME) && cfg->general.multithreading)
+                ffPrepareVulkan();
             break;
         }
         case 'w': case 'W': {
             if (ffStrEqualsIgnCase(type, FF_WEATHER_MODULE_NAME))
             {
-                if (module) cfg->modules.weather.moduleInfo.parseJsonObject(&cfg->modules.weather, module);
+                parseModuleOptions(&cfg->modules.weather, module, compiled);
                 ffPrepareWeather(&cfg->modules.weather);
             }
             break;
@@ -170,69 +248,81 @@ static void prepareModuleJsonObject(const char* type, yyjson_val* module)
     }
 }
 
+static void printJsonConfigModule(bool prepare, FFModuleBaseInfo* baseInfo, yyjson_val* module, const FFConfigSnapshotModule* compiled, yyjson_mut_doc* jsonDoc)
+{
+    FFModuleStat stat;
+    bool doStat = !prepare && instance.config.display.stat >= 0;
+    if(doStat)
+        ffModuleStatBegin(&stat);
+
+    FF_TRACE_SPAN(span, prepare ? "prepare" : "module", baseInfo->name, NULL);
+    uint32_t row = instance.state.keysHeight;
+    if(prepare)
+        prepareModuleJsonObject(baseInfo->name, module, compiled);
+    else
+    {
+        printModule(baseInfo, module, compiled, jsonDoc);
+        if(!jsonDoc)
+            ffWatchRecordModule(baseInfo->name, module, row);
+    }
+
+    if(doStat)
+        ffModuleStatEnd(&stat, jsonDoc);
+
+    #if defined(_WIN32)
+    if (!instance.config.display.noBuffer && !jsonDoc) fflush(stdout);
+    #endif
+}
+
 static const char* printJsonConfig(bool prepare, yyjson_mut_doc* jsonDoc)
 {
-    yyjson_val* const root = yyjson_doc_get_root(instance.state.configDoc);
-    assert(root);
-
-    if (!yyjson_is_obj(root))
-        return "Invalid JSON config format. Root value must be an object";
-
-    yyjson_val* modules = yyjson_obj_get(root, "modules");
-    if (!modules) return NULL;
-    if (!yyjson_is_arr(modules)) return "Property 'modules' must be an array of strings or objects";
-
-    int32_t thres = instance.config.display.stat;
-    yyjson_val* item;
-    size_t idx, max;
-    yyjson_arr_foreach(modules, idx, max, item)
-    {
-        double ms = 0;
-        if(!prepare && thres >= 0)
-            ms = ffTimeGetTick();
-
-        yyjson_val* module = item;
-        const char* type = yyjson_get_str(module);
-        if (type)
-            module = NULL;
-        else if (yyjson_is_obj(module))
-        {
-            type = yyjson_get_str(yyjson_obj_get(module, "type"));
-            if (!type) return "module object must contain a \"type\" key ( case sensitive )";
-            if (yyjson_obj_size(module) == 1) // contains only Property type
-                module = NULL;
-        }
-        else
-            return "modules must be an array of strings or objects";
+    const FFlist* compiledModules = ffConfigSnapshotGetModules();
+    if (compiledModules)
+    {
+        FF_LIST_FOR_EACH(FFConfigSnapshotModule, compiled, *compiledModules)
+            printJsonConfigModule(prepare, compiled->baseInfo, NULL, compiled->offset ? compiled : NULL, jsonDoc);
+    }
+    else
+    {
+        yyjson_val* const root = yyjson_doc_get_root(instance.state.configDoc);
+        assert(root);
+
+        if (!yyjson_is_obj(root))
+            return "Invalid JSON config format. Root value must be an object";
 
-        if(prepare)
-            prepareModuleJsonObject(type, module);
-        else if(!parseModuleJsonObject(type, module, jsonDoc))
-            return "Unknown module type";
+        yyjson_val* modules = yyjson_obj_get(root, "modules");
+        if (!modules) return NULL;
+        if (!yyjson_is_arr(modules)) return "Property 'modules' must be an array of strings or objects";
 
-        if(!prepare && thres >= 0)
+        yyjson_val* item;
+        size_t idx, max;
+        yyjson_arr_foreach(modules, idx, max, item)
         {
-            ms = ffTimeGetTick() - ms;
-            if (jsonDoc)
+            yyjson_val* module = item;
+            const char* type = yyjson_get_str(module);
+            if (type)
+                module = NULL;
+            else if (yyjson_is_obj(module))
             {
-                yyjson_mut_val* moduleJson = yyjson_mut_arr_get_last(jsonDoc->root);
-                yyjson_mut_obj_add_real(jsonDoc, moduleJson, "stat", ms);
+                type = yyjson_get_str(yyjson_obj_get(module, "type"));
+                if (!type) return "module object must contain a \"type\" key ( case sensitive )";
+                if (yyjson_obj_size(module) == 1) // contains only Property type
+                    module = NULL;
             }
             else
-            {
-                char str[64];
-                int len = snprintf(str, sizeof str, "%.3fms", ms);
-                if (thres > 0)
-                    snprintf(str, sizeof str, "\e[%sm%.3fms\e[m", (ms <= thres ? FF_COLOR_FG_GREEN : ms <= 2 * thres ? FF_COLOR_FG_YELLOW : FF_COLOR_FG_RED), ms);
-                printf("\e[s\e[1A\e[9999999C\e[%dD%s\e[u", len, str); // Save; Up 1; Right 9999999; Left <len>; Print <str>; Load
-            }
-        }
+                return "modules must be an array of strings or objects";
 
-        #if defined(_WIN32)
-        if (!instance.config.display.noBuffer && !jsonDoc) fflush(stdout);
-        #endif
+            FFModuleBaseInfo* baseInfo = findModule(type);
+            if (baseInfo)
+                printJsonConfigModule(prepare, baseInfo, module, NULL, jsonDoc);
+            else if (!prepare)
+                return "Unknown module type";
+        }
     }
 
+    if(!prepare && instance.config.display.stat >= 0)
+        ffCachePrintStat(jsonDoc);
+
     return NULL;
 }
 
@@ -251,3 +341,12 @@ void ffPrintJsonConfig(bool prepare, yyjson_mut_doc* jsonDoc)
             ffPrintError("JsonConfig", 0, NULL, FF_PRINT_TYPE_NO_CUSTOM_KEY, "%s", error);
     }
 }
+
+void ffJsonConfigDestroy(void)
+{
+    if (preparedCommandOptions.moduleInfo.name)
+    {
+        ffDestroyCommandOptions(&preparedCommandOptions);
+        preparedCommandOptions.moduleInfo.name = NULL;
+    }
+}
@@ -1,5 +1,7 @@
 #include "fastfetch.h"
 #include "common/library.h"
+#include "common/stat.h"
+#include "common/trace.h"
 
 #ifndef FF_DISABLE_DLOPEN
 
@@ -57,14 +59,21 @@ static void* libraryLoad(const char* path, int maxVersion)
 
 void* ffLibraryLoad(const FFstrbuf* userProvidedName, ...)
 {
+    void* result = NULL;
+    FF_TRACE_SPAN(span, "dlopen", "ffLibraryLoad", NULL);
+
     if(userProvidedName != NULL && userProvidedName->length > 0)
-        return dlopen(userProvidedName->chars, FF_DLOPEN_FLAGS);
+    {
+        span.detail = userProvidedName->chars;
+        result = dlopen(userProvidedName->chars, FF_DLOPEN_FLAGS);
+        if(result != NULL)
+            ++ffStatCounters.libraries;
+        return result;
+    }
 
     va_list defaultNames;
     va_start(defaultNames, userProvidedName);
 
-    void* result = NULL;
-
     while(result == NULL)
     {
         const char* path = va_arg(defaultNames, const char*);
@@ -72,11 +81,15 @@ void* ffLibraryLoad(const FFstrbuf* userProvidedName, ...)
             break;
 
         int maxVersion = va_arg(defaultNames, int);
+        span.detail = path;
         result = libraryLoad(path, maxVersion);
     }
 
     va_end(defaultNames);
 
+    if(result != NULL)
+        ++ffStatCounters.libraries;
+
     return result;
 }
 
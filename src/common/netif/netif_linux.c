@@ -1,13 +1,75 @@
 #include "netif.h"
+#include "netlink_linux.h"
 #include "common/io/io.h"
 
 #include <net/if.h>
 #include <stdio.h>
+#include <string.h>
 
 #define FF_STR_INDIR(x) #x
 #define FF_STR(x) FF_STR_INDIR(x)
 
-bool ffNetifGetDefaultRouteImpl(char iface[IF_NAMESIZE + 1], uint32_t* ifIndex)
+typedef struct FFDefaultRoute
+{
+    uint32_t ifIndex;
+    uint32_t metric;
+} FFDefaultRoute;
+
+static void parseRoute(const struct nlmsghdr* msg, void* data)
+{
+    if (msg->nlmsg_type != RTM_NEWROUTE || msg->nlmsg_len < NLMSG_LENGTH(sizeof(struct rtmsg)))
+        return;
+
+    // Same routes as /proc/net/route: IPv4, main table
+    const struct rtmsg* rtm = NLMSG_DATA(msg);
+    if (rtm->rtm_family != AF_INET || rtm->rtm_dst_len != 0 || rtm->rtm_table != RT_TABLE_MAIN || rtm->rtm_type != RTN_UNICAST)
+        return;
+
+    const struct rtattr* attrs[RTA_MAX + 1];
+    ffNetlinkParseAttrs(msg, sizeof(*rtm), attrs, RTA_MAX);
+    if (!attrs[RTA_OIF])
+        return;
+
+    uint32_t ifIndex, metric = 0;
+    memcpy(&ifIndex, RTA_DATA(attrs[RTA_OIF]), sizeof(ifIndex));
+    if (attrs[RTA_PRIORITY])
+        memcpy(&metric, RTA_DATA(attrs[RTA_PRIORITY]), sizeof(metric));
+
+    // The kernel prefers the route with the lowest metric
+    FFDefaultRoute* route = data;
+    if (route->ifIndex == 0 || metric < route->metric)
+        *route = (FFDefaultRoute) { .ifIndex = ifIndex, .metric = metric };
+}
+
+static bool getDefaultRouteNetlink(char iface[IF_NAMESIZE + 1], uint32_t* ifIndex)
+{
+    struct
+    {
+        struct nlmsghdr header;
+        struct rtmsg rtm;
+    } request = {
+        .header = {
+            .nlmsg_len = sizeof(request),
+            .nlmsg_type = RTM_GETROUTE,
+        },
+        .rtm = {
+            .rtm_family = AF_INET,
+        },
+    };
+
+    FFDefaultRoute route = {};
+    if (!ffNetlinkDump(&request.header, parseRoute, &route))
+        return false;
+
+    // The dump succeeded. No default route is a valid answer
+    if (route.ifIndex == 0 || !if_indextoname(route.ifIndex, iface))
+        iface[0] = '\0';
+    else
+        *ifIndex = route.ifIndex;
+    return true;
+}
+
+static bool getDefaultRouteProc(char iface[IF_NAMESIZE + 1], uint32_t* ifIndex)
 {
     FILE* FF_AUTO_CLOSE_FILE netRoute = fopen("/proc/net/route", "r");
     if (!netRoute) return false;
@@ -24,5 +86,15 @@ bool ffNetifGetDefaultRouteImpl(char iface[IF_NAMESIZE + 1], uint32_t* ifIndex)
         *ifIndex = if_nametoindex(iface);
         return true;
     }
+    iface[0] = '\0';
     return false;
 }
+
+bool ffNetifGetDefaultRouteImpl(char iface[IF_NAMESIZE + 1], uint32_t* ifIndex)
+{
+    // One socket round trip instead of parsing the whole routing table as text
+    if (getDefaultRouteNetlink(iface, ifIndex))
+        return iface[0] != '\0';
+
+    return getDefaultRouteProc(iface, ifIndex);
+}
@@ -0,0 +1,70 @@
+#include "netlink_linux.h"
+#include "common/io/io.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+bool ffNetlinkDump(struct nlmsghdr* request, void (*callback)(const struct nlmsghdr* msg, void* data), void* data)
+{
+    int FF_AUTO_CLOSE_FD fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
+        return false;
+
+    request->nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request->nlmsg_seq = 1;
+
+    struct sockaddr_nl kernel = { .nl_family = AF_NETLINK };
+    if (sendto(fd, request, request->nlmsg_len, 0, (struct sockaddr*) &kernel, sizeof(kernel)) != (ssize_t) request->nlmsg_len)
+        return false;
+
+    // The kernel never sends datagrams larger than 32 KiB in a dump; see netlink_dump
+    uint8_t buffer[32768] __attribute__((__aligned__(NLMSG_ALIGNTO)));
+    while (true)
+    {
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        if (received == 0)
+            return false;
+        ffStatCounters.bytesRead += (uint64_t) received;
+
+        for (uint32_t offset = 0; offset + sizeof(struct nlmsghdr) <= (uint32_t) received;)
+        {
+            const struct nlmsghdr* msg = (const struct nlmsghdr*) (buffer + offset);
+            if (msg->nlmsg_len < sizeof(*msg) || msg->nlmsg_len > (uint32_t) received - offset)
+                return false;
+            offset += NLMSG_ALIGN(msg->nlmsg_len);
+
+            if (msg->nlmsg_seq != request->nlmsg_seq)
+                continue;
+            if (msg->nlmsg_type == NLMSG_DONE)
+                return true;
+            if (msg->nlmsg_type == NLMSG_ERROR)
+                return false;
+            callback(msg, data);
+        }
+    }
+}
+
+void ffNetlinkParseAttrs(const struct nlmsghdr* msg, uint32_t headerSize, const struct rtattr* attrs[], uint16_t maxType)
+{
+    memset(attrs, 0, sizeof(*attrs) * (maxType + 1u));
+
+    uint32_t offset = NLMSG_HDRLEN + NLMSG_ALIGN(headerSize);
+    while (offset + sizeof(struct rtattr) <= msg->nlmsg_len)
+    {
+        const struct rtattr* attr = (const struct rtattr*) ((const uint8_t*) msg + offset);
+        if (attr->rta_len < sizeof(*attr) || attr->rta_len > msg->nlmsg_len - offset)
+            break;
+        offset += RTA_ALIGN(attr->rta_len);
+
+        uint16_t type = (uint16_t) (attr->rta_type & NLA_TYPE_MASK);
+        if (type <= maxType)
+            attrs[type] = attr;
+    }
+}
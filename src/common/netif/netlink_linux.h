@@ -0,0 +1,14 @@
+#pragma once
+
+#include "fastfetch.h"
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+// Sends the rtnetlink dump request `request` and calls `callback` for every message of the reply, e.g. one RTM_NEWLINK per interface.
+// Returns false if netlink can't be used or the kernel answers with an error. `callback` may have been called for some messages then
+bool ffNetlinkDump(struct nlmsghdr* request, void (*callback)(const struct nlmsghdr* msg, void* data), void* data);
+
+// Indexes the attributes that follow the fixed header (e.g. struct ifinfomsg) of `msg` by type, like mnl_attr_parse.
+// `attrs` must have `maxType + 1` elements. Unknown types are ignored
+void ffNetlinkParseAttrs(const struct nlmsghdr* msg, uint32_t headerSize, const struct rtattr* attrs[], uint16_t maxType);
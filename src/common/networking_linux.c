@@ -1,5 +1,6 @@
 #include "fastfetch.h"
 #include "common/networking.h"
+#include "common/trace.h"
 
 #include <unistd.h>
 #include <sys/time.h>
@@ -10,6 +11,7 @@
 
 static const char* connectAndSend(FFNetworkingState* state)
 {
+    FF_TRACE_SPAN(span, "network", "connectAndSend", state->host.chars);
     const char* ret = NULL;
     struct addrinfo* addr;
 
@@ -67,6 +69,7 @@ error:
     state->sockfd = -1;
 
 exit:
+    ffTraceEnd(&span);
     ffStrbufDestroy(&state->host);
     ffStrbufDestroy(&state->command);
 
@@ -101,6 +104,7 @@ const char* ffNetworkingSendHttpRequest(FFNetworkingState* state, const char* ho
 
 const char* ffNetworkingRecvHttpResponse(FFNetworkingState* state, FFstrbuf* buffer)
 {
+    FF_TRACE_SPAN(span, "network", "ffNetworkingRecvHttpResponse", NULL);
     uint32_t timeout = state->timeout;
 
     #ifdef FF_HAVE_THREADS
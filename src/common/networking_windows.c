@@ -4,6 +4,7 @@
 //Must be included after <mswsock.h>
 #include "fastfetch.h"
 #include "common/networking.h"
+#include "common/trace.h"
 
 static LPFN_CONNECTEX ConnectEx;
 
@@ -35,6 +36,7 @@ static const char* initWsaData(WSADATA* wsaData)
 
 const char* ffNetworkingSendHttpRequest(FFNetworkingState* state, const char* host, const char* path, const char* headers)
 {
+    FF_TRACE_SPAN(span, "network", "ffNetworkingSendHttpRequest", host);
     static WSADATA wsaData;
     if (wsaData.wVersion == 0)
     {
@@ -103,6 +105,7 @@ const char* ffNetworkingSendHttpRequest(FFNetworkingState* state, const char* ho
 
 const char* ffNetworkingRecvHttpResponse(FFNetworkingState* state, FFstrbuf* buffer)
 {
+    FF_TRACE_SPAN(span, "network", "ffNetworkingRecvHttpResponse", NULL);
     if (state->sockfd == INVALID_SOCKET)
         return "ffNetworkingSendHttpRequest() failed";
 
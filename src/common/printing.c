@@ -99,8 +99,21 @@ void ffPrintFormat(const char* moduleName, uint8_t moduleIndex, const FFModuleAr
     ffStrbufPutTo(&buffer, stdout);
 }
 
+static uint32_t* errorCounter;
+
+void ffPrintErrorRedirect(uint32_t* counter)
+{
+    errorCounter = counter;
+}
+
 static void printError(const char* moduleName, uint8_t moduleIndex, const FFModuleArgs* moduleArgs, FFPrintType printType, const char* message, va_list arguments)
 {
+    if(errorCounter)
+    {
+        ++*errorCounter;
+        return;
+    }
+
     if(!instance.config.display.showErrors)
         return;
 
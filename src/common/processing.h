@@ -1,11 +1,30 @@
 #pragma once
 
 #include "util/FFstrbuf.h"
+#include "common/trace.h"
 
 #include <sys/types.h>
 
 const char* ffProcessAppendOutput(FFstrbuf* buffer, char* const argv[], bool useStdErr);
 
+#ifndef _WIN32
+// A started child process whose output hasn't been read yet
+typedef struct FFProcessHandle
+{
+    pid_t pid;
+    int pipeRead;
+    FFTraceSpan span; // from spawning until the child is reaped
+} FFProcessHandle;
+
+// Starts `argv` with its stdout (or stderr if `useStdErr`) connected to a pipe, without waiting for it
+const char* ffProcessSpawn(char* const argv[], bool useStdErr, FFProcessHandle* handle);
+// Appends the output of started processes to `buffers` until they exit, and stores their results in `errors`.
+// One poll loop serves all of them, and they share the deadline of `--processing-timeout`
+void ffProcessReadOutputs(uint32_t count, FFProcessHandle* const handles[], FFstrbuf* const buffers[], const char* errors[]);
+// Terminates a started process and reaps it
+void ffProcessKill(FFProcessHandle* handle);
+#endif
+
 static inline const char* ffProcessAppendStdOut(FFstrbuf* buffer, char* const argv[])
 {
     const char* error = ffProcessAppendOutput(buffer, argv, false);
@@ -22,6 +41,36 @@ static inline const char* ffProcessAppendStdErr(FFstrbuf* buffer, char* const ar
     return error;
 }
 
+// For commands that only print something about the executable, e.g. `<exe> --version`.
+// The output is cached, keyed by the arguments and the device, inode, size and mtime of the executable found in PATH,
+// so that the command runs again only after the executable was updated
+#ifdef _WIN32
+static inline const char* ffProcessAppendOutputCached(FFstrbuf* buffer, char* const argv[], bool useStdErr)
+{
+    return ffProcessAppendOutput(buffer, argv, useStdErr);
+}
+#else
+const char* ffProcessAppendOutputCached(FFstrbuf* buffer, char* const argv[], bool useStdErr);
+// Resolves `name` in PATH the way execvp does, without spawning `which`
+bool ffProcessFindExecutable(const char* name, FFstrbuf* path);
+#endif
+
+static inline const char* ffProcessAppendStdOutCached(FFstrbuf* buffer, char* const argv[])
+{
+    const char* error = ffProcessAppendOutputCached(buffer, argv, false);
+    if (!error)
+        ffStrbufTrimRightSpace(buffer);
+    return error;
+}
+
+static inline const char* ffProcessAppendStdErrCached(FFstrbuf* buffer, char* const argv[])
+{
+    const char* error = ffProcessAppendOutputCached(buffer, argv, true);
+    if (!error)
+        ffStrbufTrimRightSpace(buffer);
+    return error;
+}
+
 #ifdef _WIN32
 bool ffProcessGetInfoWindows(uint32_t pid, uint32_t* ppid, FFstrbuf* pname, FFstrbuf* exe, const char** exeName, FFstrbuf* exePath, bool* gui);
 #else
@@ -1,7 +1,9 @@
 #include "fastfetch.h"
 #include "common/processing.h"
+#include "common/cache.h"
 #include "common/io/io.h"
 #include "common/time.h"
+#include "common/trace.h"
 #include "util/stringUtils.h"
 #include "util/mallocHelper.h"
 
@@ -11,6 +13,7 @@
 #include <poll.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <spawn.h>
 #include <sys/wait.h>
 
 #if defined(__FreeBSD__) || defined(__APPLE__)
@@ -22,10 +25,14 @@
     #include <libproc.h>
 #elif defined(__sun)
     #include <procfs.h>
+#elif defined(__linux__)
+    #include "common/procsnapshot.h"
 #endif
 
 enum { FF_PIPE_BUFSIZ = 8192 };
 
+extern char** environ;
+
 static inline int ffPipe2(int *fds, int flags)
 {
     #ifdef __APPLE__
@@ -39,80 +46,244 @@ static inline int ffPipe2(int *fds, int flags)
     #endif
 }
 
-const char* ffProcessAppendOutput(FFstrbuf* buffer, char* const argv[], bool useStdErr)
+// Copy of `environ` with `LANG=C`, so that the output doesn't depend on the user's locale
+static char** createChildEnv(void)
 {
-    int pipes[2];
-    const int timeout = instance.config.general.processingTimeout;
+    uint32_t count = 0;
+    while (environ[count]) ++count;
 
+    char** env = malloc(sizeof(*env) * (count + 2));
+    uint32_t index = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (!ffStrStartsWith(environ[i], "LANG="))
+            env[index++] = environ[i];
+    }
+    env[index++] = "LANG=C";
+    env[index] = NULL;
+    return env;
+}
+
+const char* ffProcessSpawn(char* const argv[], bool useStdErr, FFProcessHandle* handle)
+{
+    int pipes[2];
     if(ffPipe2(pipes, O_CLOEXEC) == -1)
         return "pipe() failed";
 
-    pid_t childPid = fork();
-    if(childPid == -1)
+    // posix_spawn uses vfork / CLONE_VM where available, so the address space is never copied
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipes[1], useStdErr ? STDERR_FILENO : STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, useStdErr ? STDOUT_FILENO : STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    FF_AUTO_FREE char** env = createChildEnv();
+    pid_t childPid;
+    int err = posix_spawnp(&childPid, argv[0], &actions, NULL, argv, env);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipes[1]);
+
+    if(err != 0)
     {
         close(pipes[0]);
-        close(pipes[1]);
-        return "fork() failed";
+        return err == ENOENT ? "command was not found" : "posix_spawnp() failed";
     }
 
-    //Child
-    if(childPid == 0)
+    ++ffStatCounters.processes;
+    handle->pid = childPid;
+    handle->pipeRead = pipes[0];
+    // argv[0] must outlive the child; callers keep argv alive until they read the output
+    ffTraceBegin(&handle->span, "process", "ffProcessSpawn", argv[0]);
+    return NULL;
+}
+
+void ffProcessKill(FFProcessHandle* handle)
+{
+    kill(handle->pid, SIGTERM);
+    waitpid(handle->pid, NULL, 0);
+    close(handle->pipeRead);
+    handle->pipeRead = -1;
+    ffTraceEnd(&handle->span);
+}
+
+static const char* reapProcess(FFProcessHandle* handle)
+{
+    close(handle->pipeRead);
+    handle->pipeRead = -1;
+
+    int stat_loc = 0;
+    pid_t pid = waitpid(handle->pid, &stat_loc, 0);
+    ffTraceEnd(&handle->span);
+    if (pid != handle->pid)
+        return "waitpid() failed";
+    if (!WIFEXITED(stat_loc))
+        return "child process exited abnormally";
+    if (WEXITSTATUS(stat_loc) == 127)
+        return "command was not found";
+    // We only handle 127 as an error. See `getTerminalVersionUrxvt` in `terminalshell.c`
+    return NULL;
+}
+
+void ffProcessReadOutputs(uint32_t count, FFProcessHandle* const handles[], FFstrbuf* const buffers[], const char* errors[])
+{
+    const int timeout = instance.config.general.processingTimeout;
+    const double deadline = ffTimeGetTick() + timeout;
+
+    FF_AUTO_FREE struct pollfd* pollfds = malloc(sizeof(*pollfds) * count);
+    uint32_t running = 0;
+    for (uint32_t i = 0; i < count; ++i)
     {
-        int nullFile = open("/dev/null", O_WRONLY | O_CLOEXEC);
-        dup2(pipes[1], useStdErr ? STDERR_FILENO : STDOUT_FILENO);
-        dup2(nullFile, useStdErr ? STDOUT_FILENO : STDERR_FILENO);
-        setenv("LANG", "C", 1);
-        execvp(argv[0], argv);
-        _exit(127);
+        errors[i] = NULL;
+        pollfds[i] = (struct pollfd) { handles[i]->pipeRead, POLLIN, 0 }; // poll ignores negative fds
+        if (handles[i]->pipeRead >= 0)
+            ++running;
     }
 
-    //Parent
-    close(pipes[1]);
-
-    int FF_AUTO_CLOSE_FD childPipeFd = pipes[0];
     char str[FF_PIPE_BUFSIZ];
-
-    while(1)
+    while (running > 0)
     {
+        int waitMs = -1;
         if (timeout >= 0)
         {
-            struct pollfd pollfd = { childPipeFd, POLLIN, 0 };
-            if (poll(&pollfd, 1, timeout) == 0)
-            {
-                kill(childPid, SIGTERM);
-                waitpid(childPid, NULL, 0);
-                return "poll(&pollfd, 1, timeout) timeout (try increasing --processing-timeout)";
-            }
-            else if (pollfd.revents & POLLERR)
+            double remaining = deadline - ffTimeGetTick();
+            waitMs = remaining > 0 ? (int) remaining + 1 : 0;
+        }
+
+        int ready = poll(pollfds, count, waitMs);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+        {
+            for (uint32_t i = 0; i < count; ++i)
             {
-                kill(childPid, SIGTERM);
-                waitpid(childPid, NULL, 0);
-                return "poll(&pollfd, 1, timeout) error";
+                if (pollfds[i].fd < 0) continue;
+                ffProcessKill(handles[i]);
+                errors[i] = ready == 0
+                    ? "poll() timeout (try increasing --processing-timeout)"
+                    : "poll() failed";
             }
+            return;
         }
 
-        ssize_t nRead = read(childPipeFd, str, FF_PIPE_BUFSIZ);
-        if (nRead > 0)
-            ffStrbufAppendNS(buffer, (uint32_t) nRead, str);
-        else if (nRead == 0)
+        for (uint32_t i = 0; i < count; ++i)
         {
-            int stat_loc = 0;
-            if (waitpid(childPid, &stat_loc, 0) == childPid)
+            if (pollfds[i].fd < 0 || pollfds[i].revents == 0) continue;
+
+            if (pollfds[i].revents & POLLERR)
+            {
+                ffProcessKill(handles[i]);
+                errors[i] = "poll() error";
+            }
+            else
             {
-                if (!WIFEXITED(stat_loc))
-                    return "child process exited abnormally";
-                if (WEXITSTATUS(stat_loc) == 127)
-                    return "command was not found";
-                // We only handle 127 as an error. See `getTerminalVersionUrxvt` in `terminalshell.c`
-                return NULL;
+                ssize_t nRead = read(pollfds[i].fd, str, FF_PIPE_BUFSIZ);
+                if (nRead > 0)
+                {
+                    ffStrbufAppendNS(buffers[i], (uint32_t) nRead, str);
+                    continue;
+                }
+                if (nRead < 0 && errno == EINTR)
+                    continue;
+
+                if (nRead == 0)
+                    errors[i] = reapProcess(handles[i]);
+                else
+                {
+                    ffProcessKill(handles[i]);
+                    errors[i] = "read(childPipeFd, str, FF_PIPE_BUFSIZ) failed";
+                }
             }
-            return "waitpid() failed";
+            pollfds[i].fd = -1;
+            --running;
         }
-        else if (nRead < 0)
-            break;
-    };
+    }
+}
 
-    return "read(childPipeFd, str, FF_PIPE_BUFSIZ) failed";
+const char* ffProcessAppendOutput(FFstrbuf* buffer, char* const argv[], bool useStdErr)
+{
+    FFProcessHandle handle;
+    const char* error = ffProcessSpawn(argv, useStdErr, &handle);
+    if (error)
+        return error;
+
+    ffProcessReadOutputs(1, (FFProcessHandle*[]) { &handle }, (FFstrbuf*[]) { buffer }, &error);
+    return error;
+}
+
+bool ffProcessFindExecutable(const char* name, FFstrbuf* path)
+{
+    if (strchr(name, '/'))
+    {
+        ffStrbufSetS(path, name);
+        return access(name, X_OK) == 0;
+    }
+
+    const char* dirs = getenv("PATH");
+    if (!ffStrSet(dirs))
+        dirs = "/bin:/usr/bin";
+
+    while (true)
+    {
+        const char* end = strchr(dirs, ':');
+        if (!end) end = dirs + strlen(dirs);
+        if (end == dirs)
+            ffStrbufSetS(path, "./"); // Empty entry means the current directory
+        else
+        {
+            ffStrbufSetNS(path, (uint32_t) (end - dirs), dirs);
+            ffStrbufAppendC(path, '/');
+        }
+        ffStrbufAppendS(path, name);
+        if (access(path->chars, X_OK) == 0)
+            return true;
+
+        if (*end == '\0')
+            return false;
+        dirs = end + 1;
+    }
+}
+
+const char* ffProcessAppendOutputCached(FFstrbuf* buffer, char* const argv[], bool useStdErr)
+{
+    FF_STRBUF_AUTO_DESTROY exePath = ffStrbufCreate();
+    if (!ffProcessFindExecutable(argv[0], &exePath))
+        return ffProcessAppendOutput(buffer, argv, useStdErr);
+
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    ffCacheEntryInit(&cache, NULL);
+    ffStrbufAppend(&cache.key, &exePath);
+    for (char* const* arg = argv + 1; *arg; ++arg)
+    {
+        ffStrbufAppendC(&cache.key, ' ');
+        ffStrbufAppendS(&cache.key, *arg);
+    }
+    ffStrbufAppendS(&cache.key, useStdErr ? " 2> " : " > ");
+
+    // The file name doesn't depend on the file identity, so that an updated executable replaces its old entry
+    uint64_t hash = 14695981039346656037ULL; // FNV-1a
+    for (uint32_t i = 0; i < cache.key.length; ++i)
+        hash = (hash ^ (uint8_t) cache.key.chars[i]) * 1099511628211ULL;
+    char name[32];
+    snprintf(name, sizeof(name), "process/%016llx", (unsigned long long) hash);
+    cache.name = name;
+
+    ffCacheKeyAddFile(&cache, exePath.chars);
+
+    FF_STRBUF_AUTO_DESTROY output = ffStrbufCreate();
+    if (ffCacheLoad(&cache) && ffCacheGetStrbuf(&cache, &output))
+    {
+        ffStrbufAppend(buffer, &output);
+        return NULL;
+    }
+
+    const char* error = ffProcessAppendOutput(&output, argv, useStdErr);
+    if (error)
+        return error;
+
+    ffStrbufAppend(buffer, &output);
+    ffStrbufClear(&cache.data);
+    ffCachePutStrbuf(&cache, &output);
+    ffCacheStore(&cache);
+    return NULL;
 }
 
 void ffProcessGetInfoLinux(pid_t pid, FFstrbuf* processName, FFstrbuf* exe, const char** exeName, FFstrbuf* exePath)
@@ -122,17 +293,28 @@ void ffProcessGetInfoLinux(pid_t pid, FFstrbuf* processName, FFstrbuf* exe, cons
 
     #ifdef __linux__
 
+    // Reuse the process table if another detector has listed it already
+    FFProcEntry* entry = ffProcSnapshotFind(pid);
+
     char filePath[64];
     snprintf(filePath, sizeof(filePath), "/proc/%d/cmdline", (int)pid);
 
-    if(ffReadFileBuffer(filePath, exe))
+    if (entry && ffProcSnapshotLoad(entry, FF_PROC_FIELD_CMDLINE))
+    {
+        ffStrbufSet(exe, &entry->argv0);
+        ffStrbufTrimRightSpace(exe);
+        ffStrbufTrimLeft(exe, '-'); //Login shells start with a dash
+    }
+    else if(ffReadFileBuffer(filePath, exe))
     {
         ffStrbufRecalculateLength(exe); //Trim the arguments
         ffStrbufTrimRightSpace(exe);
         ffStrbufTrimLeft(exe, '-'); //Login shells start with a dash
     }
 
-    if (exePath)
+    if (exePath && entry && ffProcSnapshotLoad(entry, FF_PROC_FIELD_EXE))
+        ffStrbufSet(exePath, &entry->exe);
+    else if (exePath)
     {
         snprintf(filePath, sizeof(filePath), "/proc/%d/exe", (int)pid);
         ffStrbufEnsureFixedLengthFree(exePath, PATH_MAX);
@@ -277,8 +459,19 @@ const char* ffProcessGetBasicInfoLinux(pid_t pid, FFstrbuf* name, pid_t* ppid, i
 
     #ifdef __linux__
 
+    FFProcEntry* entry = ffProcSnapshotFind(pid);
     char procFilePath[64];
-    if (ppid)
+    if (entry && ffProcSnapshotLoad(entry, FF_PROC_FIELD_STAT))
+    {
+        ffStrbufSet(name, &entry->comm);
+        if (ppid)
+        {
+            *ppid = entry->ppid;
+            if (tty)
+                *tty = entry->tty & 0xFF;
+        }
+    }
+    else if (ppid)
     {
         snprintf(procFilePath, sizeof(procFilePath), "/proc/%d/stat", (int)pid);
         char buf[PROC_FILE_BUFFSIZ];
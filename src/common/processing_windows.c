@@ -1,6 +1,7 @@
 #include "fastfetch.h"
 #include "common/processing.h"
 #include "common/io/io.h"
+#include "common/trace.h"
 
 #include <Windows.h>
 #include <ntstatus.h>
@@ -10,6 +11,7 @@ enum { FF_PIPE_BUFSIZ = 8192 };
 
 const char* ffProcessAppendOutput(FFstrbuf* buffer, char* const argv[], bool useStdErr)
 {
+    FF_TRACE_SPAN(span, "process", "ffProcessAppendOutput", argv[0]);
     int timeout = instance.config.general.processingTimeout;
 
     FF_AUTO_CLOSE_FD HANDLE hChildPipeRead = CreateNamedPipeW(
@@ -79,6 +81,7 @@ const char* ffProcessAppendOutput(FFstrbuf* buffer, char* const argv[], bool use
     CloseHandle(hChildPipeWrite);
     if(!success)
         return "CreateProcessA() failed";
+    ++ffStatCounters.processes;
 
     FF_AUTO_CLOSE_FD HANDLE hProcess = piProcInfo.hProcess;
     FF_MAYBE_UNUSED FF_AUTO_CLOSE_FD HANDLE hThread = piProcInfo.hThread;
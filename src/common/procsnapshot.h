@@ -0,0 +1,35 @@
+#pragma once
+
+#include "fastfetch.h"
+
+#include <sys/types.h>
+
+typedef enum FFProcFields
+{
+    FF_PROC_FIELD_STAT = 1 << 0, // ppid, tty, comm
+    FF_PROC_FIELD_UID = 1 << 1, // uid, loginuid
+    FF_PROC_FIELD_CMDLINE = 1 << 2, // argv0
+    FF_PROC_FIELD_EXE = 1 << 3, // exe
+} FFProcFields;
+
+typedef struct FFProcEntry
+{
+    pid_t pid;
+    pid_t ppid;
+    int32_t tty; // tty_nr of /proc/<pid>/stat
+    uint32_t uid; // owner of /proc/<pid>
+    uint32_t loginuid; // (uint32_t) -1 if unset
+    FFstrbuf comm; // truncated to 15 characters by the kernel
+    FFstrbuf argv0; // first argument of the command line, not truncated
+    FFstrbuf exe; // target of /proc/<pid>/exe
+    uint8_t loaded; // FFProcFields that have been read
+    uint8_t failed; // FFProcFields that couldn't be read, usually because the process has exited
+} FFProcEntry;
+
+// Lists the processes in /proc with getdents64, once per run, and shares the list between detectors.
+// Entries are sorted by pid. Returns NULL if /proc can't be read
+FFlist* ffProcSnapshotGet(void); // FFProcEntry
+// Finds `pid` in the snapshot if one has been taken. Returns NULL otherwise, so that looking up a few pids never lists /proc
+FFProcEntry* ffProcSnapshotFind(pid_t pid);
+// Reads the missing `fields` of `entry` relative to the /proc dirfd. Returns false if any of them couldn't be read
+bool ffProcSnapshotLoad(FFProcEntry* entry, FFProcFields fields);
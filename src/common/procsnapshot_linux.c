@@ -0,0 +1,262 @@
+#include "common/procsnapshot.h"
+#include "common/cache.h"
+#include "common/io/io.h"
+#include "common/thread.h"
+#include "util/stringUtils.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+// Layout of the records returned by getdents64. glibc only provides a wrapper since 2.30
+struct FFLinuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+static FFlist snapshot; // FFProcEntry
+static int procFd = -1;
+static bool initialized;
+
+#ifdef FF_HAVE_THREADS
+static FFThreadMutex mutex = FF_THREAD_MUTEX_INITIALIZER;
+#define FF_PROC_LOCK() ffThreadMutexLock(&mutex)
+#define FF_PROC_UNLOCK() ffThreadMutexUnlock(&mutex)
+#else
+#define FF_PROC_LOCK()
+#define FF_PROC_UNLOCK()
+#endif
+
+static void initEntry(FFProcEntry* entry, pid_t pid)
+{
+    *entry = (FFProcEntry) {
+        .pid = pid,
+        .tty = -1,
+        .loginuid = (uint32_t) -1,
+    };
+    ffStrbufInit(&entry->comm);
+    ffStrbufInit(&entry->argv0);
+    ffStrbufInit(&entry->exe);
+}
+
+static void destroyEntry(FFProcEntry* entry)
+{
+    ffStrbufDestroy(&entry->comm);
+    ffStrbufDestroy(&entry->argv0);
+    ffStrbufDestroy(&entry->exe);
+}
+
+static void resetSnapshot(void)
+{
+    FF_LIST_FOR_EACH(FFProcEntry, entry, snapshot)
+        destroyEntry(entry);
+    ffListDestroy(&snapshot);
+    if (procFd >= 0)
+    {
+        close(procFd);
+        procFd = -1;
+    }
+    initialized = false;
+}
+
+static int comparePid(const void* a, const void* b)
+{
+    pid_t x = ((const FFProcEntry*) a)->pid, y = ((const FFProcEntry*) b)->pid;
+    return (x > y) - (x < y);
+}
+
+static void buildSnapshot(void)
+{
+    ffListInitA(&snapshot, sizeof(FFProcEntry), 512);
+
+    procFd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (procFd < 0)
+        return;
+    ++ffStatCounters.filesOpened;
+
+    char buffer[32768] __attribute__((__aligned__(8)));
+    long nRead;
+    while ((nRead = syscall(SYS_getdents64, procFd, buffer, sizeof(buffer))) > 0)
+    {
+        for (long offset = 0; offset < nRead;)
+        {
+            const struct FFLinuxDirent64* dirent = (const struct FFLinuxDirent64*) (buffer + offset);
+            offset += dirent->d_reclen;
+            ++ffStatCounters.dirEntries;
+
+            //Match only folders starting with a number (the pid folders)
+            if (dirent->d_type != DT_DIR || !ffCharIsDigit(dirent->d_name[0]))
+                continue;
+
+            initEntry(ffListAdd(&snapshot), (pid_t) strtol(dirent->d_name, NULL, 10));
+        }
+    }
+
+    // /proc lists pids in ascending order already. Make sure of it for binary searches
+    ffListSort(&snapshot, comparePid);
+}
+
+FFlist* ffProcSnapshotGet(void)
+{
+    FF_PROC_LOCK();
+    if (!initialized)
+    {
+        initialized = true;
+        buildSnapshot();
+        ffCacheRegisterReset(resetSnapshot);
+    }
+    FF_PROC_UNLOCK();
+
+    return procFd >= 0 ? &snapshot : NULL;
+}
+
+FFProcEntry* ffProcSnapshotFind(pid_t pid)
+{
+    FF_PROC_LOCK();
+    bool available = initialized && procFd >= 0;
+    FF_PROC_UNLOCK();
+    if (!available)
+        return NULL;
+
+    FFProcEntry key = { .pid = pid };
+    return bsearch(&key, snapshot.data, snapshot.length, snapshot.elementSize, comparePid);
+}
+
+static bool readProcFile(pid_t pid, const char* name, FFstrbuf* buffer)
+{
+    char path[32];
+    snprintf(path, sizeof(path), "%d/%s", (int) pid, name);
+
+    int FF_AUTO_CLOSE_FD fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    ++ffStatCounters.filesOpened;
+
+    // The file may be empty, e.g. cmdline of kernel threads
+    ffStrbufClear(buffer);
+    ffAppendFDBuffer(fd, buffer);
+    return true;
+}
+
+static bool loadStat(FFProcEntry* entry)
+{
+    FF_STRBUF_AUTO_DESTROY content = ffStrbufCreate();
+    if (!readProcFile(entry->pid, "stat", &content))
+        return false;
+
+    // pid (comm) state ppid pgrp session tty_nr. comm may contain spaces and parentheses
+    const char* start = strchr(content.chars, '(');
+    const char* end = strrchr(content.chars, ')');
+    if (!start || !end || end <= start + 1)
+        return false;
+
+    int ppid, tty;
+    if (sscanf(end + 1, " %*c %d %*d %*d %d", &ppid, &tty) != 2)
+        return false;
+
+    ffStrbufSetNS(&entry->comm, (uint32_t) (end - start - 1), start + 1);
+    entry->ppid = (pid_t) ppid;
+    entry->tty = (int32_t) tty;
+    return true;
+}
+
+static bool loadUid(FFProcEntry* entry)
+{
+    char path[32];
+    snprintf(path, sizeof(path), "%d", (int) entry->pid);
+    struct stat st;
+    if (fstatat(procFd, path, &st, 0) != 0)
+        return false;
+    entry->uid = (uint32_t) st.st_uid;
+
+    // Doesn't exist if the kernel is built without audit support
+    FF_STRBUF_AUTO_DESTROY content = ffStrbufCreate();
+    if (readProcFile(entry->pid, "loginuid", &content))
+        entry->loginuid = (uint32_t) ffStrbufToUInt(&content, (uint32_t) -1);
+    return true;
+}
+
+static bool loadCmdline(FFProcEntry* entry)
+{
+    if (!readProcFile(entry->pid, "cmdline", &entry->argv0))
+        return false;
+    ffStrbufRecalculateLength(&entry->argv0); //Trim the arguments. Empty for kernel threads
+    return true;
+}
+
+static bool loadExe(FFProcEntry* entry)
+{
+    char path[32];
+    snprintf(path, sizeof(path), "%d/exe", (int) entry->pid);
+    ffStrbufEnsureFixedLengthFree(&entry->exe, PATH_MAX);
+    ssize_t length = readlinkat(procFd, path, entry->exe.chars, entry->exe.allocated - 1);
+    if (length <= 0) // doesn't contain trailing NUL
+        return false;
+    entry->exe.chars[length] = '\0';
+    entry->exe.length = (uint32_t) length;
+    return true;
+}
+
+bool ffProcSnapshotLoad(FFProcEntry* entry, FFProcFields fields)
+{
+    FF_PROC_LOCK();
+    uint8_t missing = (uint8_t) (fields & ~(entry->loaded | entry->failed));
+    FF_PROC_UNLOCK();
+
+    if (missing)
+    {
+        // Read into a copy, so that other threads never see half written fields
+        FFProcEntry copy;
+        initEntry(&copy, entry->pid);
+
+        uint8_t loaded = 0;
+        if ((missing & FF_PROC_FIELD_STAT) && loadStat(&copy)) loaded |= FF_PROC_FIELD_STAT;
+        if ((missing & FF_PROC_FIELD_UID) && loadUid(&copy)) loaded |= FF_PROC_FIELD_UID;
+        if ((missing & FF_PROC_FIELD_CMDLINE) && loadCmdline(&copy)) loaded |= FF_PROC_FIELD_CMDLINE;
+        if ((missing & FF_PROC_FIELD_EXE) && loadExe(&copy)) loaded |= FF_PROC_FIELD_EXE;
+
+        FF_PROC_LOCK();
+        // Another thread may have loaded some of them in the meantime
+        loaded &= (uint8_t) ~entry->loaded;
+        if (loaded & FF_PROC_FIELD_STAT)
+        {
+            entry->ppid = copy.ppid;
+            entry->tty = copy.tty;
+            ffStrbufDestroy(&entry->comm);
+            ffStrbufInitMove(&entry->comm, &copy.comm);
+        }
+        if (loaded & FF_PROC_FIELD_UID)
+        {
+            entry->uid = copy.uid;
+            entry->loginuid = copy.loginuid;
+        }
+        if (loaded & FF_PROC_FIELD_CMDLINE)
+        {
+            ffStrbufDestroy(&entry->argv0);
+            ffStrbufInitMove(&entry->argv0, &copy.argv0);
+        }
+        if (loaded & FF_PROC_FIELD_EXE)
+        {
+            ffStrbufDestroy(&entry->exe);
+            ffStrbufInitMove(&entry->exe, &copy.exe);
+        }
+        entry->loaded |= loaded;
+        entry->failed |= (uint8_t) (missing & ~entry->loaded);
+        FF_PROC_UNLOCK();
+
+        destroyEntry(&copy);
+    }
+
+    FF_PROC_LOCK();
+    bool result = (fields & entry->failed) == 0;
+    FF_PROC_UNLOCK();
+    return result;
+}
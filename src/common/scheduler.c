@@ -0,0 +1,157 @@
+#include "common/scheduler.h"
+#include "common/thread.h"
+#include "common/trace.h"
+
+#include <assert.h>
+
+static void runTask(FFSchedulerTask* task)
+{
+    FF_TRACE_SPAN(span, "detect", task->name, NULL);
+    FFStatCounters saved = ffStatCounters;
+    ffStatCounters = (FFStatCounters) {};
+    task->func(task->data);
+    task->counters = ffStatCounters;
+    ffStatCounters = saved;
+}
+
+#ifdef FF_HAVE_THREADS
+
+#define FF_SCHEDULER_MAX_WORKERS 8
+
+static FFThreadMutex mutex = FF_THREAD_MUTEX_INITIALIZER;
+static FFThreadCond queueCond = FF_THREAD_COND_INITIALIZER; // signaled when a task is queued or workers should exit
+static FFThreadCond doneCond = FF_THREAD_COND_INITIALIZER; // signaled when a task is finished
+static FFSchedulerTask* queueHead;
+static FFSchedulerTask* queueTail;
+static uint32_t workerCount;
+static uint32_t idleCount;
+static uint32_t runningCount;
+static bool stopping;
+
+static void workerMain(void)
+{
+    ffThreadMutexLock(&mutex);
+    while (true)
+    {
+        while (!queueHead && !stopping)
+        {
+            ++idleCount;
+            ffThreadCondWait(&queueCond, &mutex);
+            --idleCount;
+        }
+        if (!queueHead)
+            break;
+
+        FFSchedulerTask* task = queueHead;
+        queueHead = task->next;
+        if (!queueHead) queueTail = NULL;
+        ++runningCount;
+        ffThreadMutexUnlock(&mutex);
+
+        runTask(task);
+
+        ffThreadMutexLock(&mutex);
+        --runningCount;
+        task->done = true;
+        ffThreadCondBroadcast(&doneCond);
+    }
+    --workerCount;
+    ffThreadMutexUnlock(&mutex);
+}
+
+FF_THREAD_ENTRY_DECL_WRAPPER_NOPARAM(workerMain)
+
+void ffSchedulerSubmit(FFSchedulerTask* task, const char* name, void (*func)(void* data), void* data)
+{
+    assert(task->func == NULL);
+    task->name = name;
+    task->func = func;
+    task->data = data;
+    task->next = NULL;
+    task->done = false;
+
+    ffThreadMutexLock(&mutex);
+    if (queueTail)
+        queueTail->next = task;
+    else
+        queueHead = task;
+    queueTail = task;
+
+    if (idleCount == 0 && workerCount < FF_SCHEDULER_MAX_WORKERS)
+    {
+        FFThreadType thread = ffThreadCreate(workerMainThreadMain, NULL);
+        if (thread)
+        {
+            ffThreadDetach(thread);
+            ++workerCount;
+        }
+    }
+    ffThreadCondSignal(&queueCond);
+
+    bool noWorker = workerCount == 0;
+    if (noWorker)
+    {
+        // Failed to create any thread. Run it on the current thread
+        queueHead = queueTail = NULL;
+    }
+    ffThreadMutexUnlock(&mutex);
+
+    if (noWorker)
+    {
+        runTask(task);
+        task->done = true;
+    }
+}
+
+bool ffSchedulerWait(FFSchedulerTask* task)
+{
+    if (task->func == NULL)
+        return false;
+
+    ffThreadMutexLock(&mutex);
+    while (!task->done)
+        ffThreadCondWait(&doneCond, &mutex);
+    ffThreadMutexUnlock(&mutex);
+
+    ffStatCountersAdd(&ffStatCounters, &task->counters);
+    task->func = NULL;
+    return true;
+}
+
+void ffSchedulerDestroy(void)
+{
+    ffThreadMutexLock(&mutex);
+    while (queueHead || runningCount > 0)
+        ffThreadCondWait(&doneCond, &mutex);
+    stopping = true;
+    ffThreadCondBroadcast(&queueCond);
+    ffThreadMutexUnlock(&mutex);
+}
+
+#else //FF_HAVE_THREADS
+
+void ffSchedulerSubmit(FFSchedulerTask* task, const char* name, void (*func)(void* data), void* data)
+{
+    assert(task->func == NULL);
+    task->name = name;
+    task->func = func;
+    task->data = data;
+    task->next = NULL;
+    runTask(task);
+    task->done = true;
+}
+
+bool ffSchedulerWait(FFSchedulerTask* task)
+{
+    if (task->func == NULL)
+        return false;
+    ffStatCountersAdd(&ffStatCounters, &task->counters);
+    task->func = NULL;
+    return true;
+}
+
+void ffSchedulerDestroy(void)
+{
+}
+
+#endif //FF_HAVE_THREADS
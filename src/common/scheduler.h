@@ -0,0 +1,22 @@
+#pragma once
+
+#include "fastfetch.h"
+#include "common/stat.h"
+
+// A detection job that can be started early and joined later, in config order
+typedef struct FFSchedulerTask
+{
+    const char* name; // shown in `--trace`
+    void (*func)(void* data);
+    void* data;
+    struct FFSchedulerTask* next;
+    bool done;
+    FFStatCounters counters; // work done by `func`, added to the waiting thread
+} FFSchedulerTask;
+
+// Queue `func(data)` on the detection worker pool. Runs it in place when built without threads
+void ffSchedulerSubmit(FFSchedulerTask* task, const char* name, void (*func)(void* data), void* data);
+// Block until the task is finished. Returns true exactly once for each submitted task
+bool ffSchedulerWait(FFSchedulerTask* task);
+// Wait for all queued tasks and stop the workers
+void ffSchedulerDestroy(void);
@@ -285,24 +285,37 @@ typedef struct SQLiteData
     bool inited;
 } SQLiteData;
 
+static void loadSQLiteData(SQLiteData* data)
+{
+    FF_LIBRARY_LOAD(libsqlite, &instance.config.library.libSQLite3, , "libsqlite3" FF_LIBRARY_EXTENSION, 1);
+    FF_LIBRARY_LOAD_SYMBOL_PTR(libsqlite, data, sqlite3_open_v2, )
+    FF_LIBRARY_LOAD_SYMBOL_PTR(libsqlite, data, sqlite3_prepare_v2, )
+    FF_LIBRARY_LOAD_SYMBOL_PTR(libsqlite, data, sqlite3_step, )
+    FF_LIBRARY_LOAD_SYMBOL_PTR(libsqlite, data, sqlite3_data_count, )
+    FF_LIBRARY_LOAD_SYMBOL_PTR(libsqlite, data, sqlite3_column_int, )
+    FF_LIBRARY_LOAD_SYMBOL_PTR(libsqlite, data, sqlite3_column_text, )
+    FF_LIBRARY_LOAD_SYMBOL_PTR(libsqlite, data, sqlite3_finalize, )
+    FF_LIBRARY_LOAD_SYMBOL_PTR(libsqlite, data, sqlite3_close, )
+    libsqlite = NULL;
+}
+
 static const SQLiteData* getSQLiteData(void)
 {
     static SQLiteData data;
 
+    // Package managers are counted concurrently
+    #ifdef FF_HAVE_THREADS
+    static FFThreadMutex mutex = FF_THREAD_MUTEX_INITIALIZER;
+    ffThreadMutexLock(&mutex);
+    #endif
     if (!data.inited)
     {
+        loadSQLiteData(&data);
         data.inited = true;
-        FF_LIBRARY_LOAD(libsqlite, &instance.config.library.libSQLite3, NULL, "libsqlite3" FF_LIBRARY_EXTENSION, 1);
-        FF_LIBRARY_LOAD_SYMBOL_VAR(libsqlite, data, sqlite3_open_v2, NULL)
-        FF_LIBRARY_LOAD_SYMBOL_VAR(libsqlite, data, sqlite3_prepare_v2, NULL)
-        FF_LIBRARY_LOAD_SYMBOL_VAR(libsqlite, data, sqlite3_step, NULL)
-        FF_LIBRARY_LOAD_SYMBOL_VAR(libsqlite, data, sqlite3_data_count, NULL)
-        FF_LIBRARY_LOAD_SYMBOL_VAR(libsqlite, data, sqlite3_column_int, NULL)
-        FF_LIBRARY_LOAD_SYMBOL_VAR(libsqlite, data, sqlite3_column_text, NULL)
-        FF_LIBRARY_LOAD_SYMBOL_VAR(libsqlite, data, sqlite3_finalize, NULL)
-        FF_LIBRARY_LOAD_SYMBOL_VAR(libsqlite, data, sqlite3_close, NULL)
-        libsqlite = NULL;
     }
+    #ifdef FF_HAVE_THREADS
+    ffThreadMutexUnlock(&mutex);
+    #endif
 
     if (!data.ffsqlite3_close)
         return NULL;
@@ -0,0 +1,68 @@
+#include "fastfetch.h"
+#include "common/stat.h"
+#include "common/color.h"
+#include "common/parsing.h"
+#include "common/time.h"
+
+__thread FFStatCounters ffStatCounters;
+
+void ffModuleStatBegin(FFModuleStat* stat)
+{
+    stat->counters = ffStatCounters;
+    stat->start = ffTimeGetTick();
+}
+
+static void appendCounter(FFstrbuf* str, uint32_t value, const char* unit)
+{
+    if (value == 0) return;
+    ffStrbufAppendF(str, "%u %s, ", value, unit);
+}
+
+void ffModuleStatEnd(FFModuleStat* stat, yyjson_mut_doc* jsonDoc)
+{
+    double ms = ffTimeGetTick() - stat->start;
+
+    FFStatCounters counters = {
+        .filesOpened = ffStatCounters.filesOpened - stat->counters.filesOpened,
+        .dirEntries = ffStatCounters.dirEntries - stat->counters.dirEntries,
+        .processes = ffStatCounters.processes - stat->counters.processes,
+        .libraries = ffStatCounters.libraries - stat->counters.libraries,
+        .dbusCalls = ffStatCounters.dbusCalls - stat->counters.dbusCalls,
+        .bytesRead = ffStatCounters.bytesRead - stat->counters.bytesRead,
+    };
+
+    if (jsonDoc)
+    {
+        yyjson_mut_val* moduleJson = yyjson_mut_arr_get_last(jsonDoc->root);
+        yyjson_mut_val* obj = yyjson_mut_obj_add_obj(jsonDoc, moduleJson, "stat");
+        yyjson_mut_obj_add_real(jsonDoc, obj, "time", ms);
+        yyjson_mut_obj_add_uint(jsonDoc, obj, "filesOpened", counters.filesOpened);
+        yyjson_mut_obj_add_uint(jsonDoc, obj, "bytesRead", counters.bytesRead);
+        yyjson_mut_obj_add_uint(jsonDoc, obj, "dirEntries", counters.dirEntries);
+        yyjson_mut_obj_add_uint(jsonDoc, obj, "processes", counters.processes);
+        yyjson_mut_obj_add_uint(jsonDoc, obj, "libraries", counters.libraries);
+        yyjson_mut_obj_add_uint(jsonDoc, obj, "dbusCalls", counters.dbusCalls);
+        return;
+    }
+
+    // Only non-zero counters, e.g. `3 files, 1.20 KiB, 1 proc, 2.345ms`
+    FF_STRBUF_AUTO_DESTROY detail = ffStrbufCreate();
+    appendCounter(&detail, counters.filesOpened, "files");
+    if (counters.bytesRead > 0)
+    {
+        ffParseSize(counters.bytesRead, &detail);
+        ffStrbufAppendS(&detail, ", ");
+    }
+    appendCounter(&detail, counters.dirEntries, "dirents");
+    appendCounter(&detail, counters.processes, "procs");
+    appendCounter(&detail, counters.libraries, "libs");
+    appendCounter(&detail, counters.dbusCalls, "dbus");
+
+    int32_t thres = instance.config.display.stat;
+    char str[64];
+    int len = snprintf(str, sizeof str, "%.3fms", ms);
+    if (thres > 0)
+        snprintf(str, sizeof str, "\e[%sm%.3fms\e[m", (ms <= thres ? FF_COLOR_FG_GREEN : ms <= 2 * thres ? FF_COLOR_FG_YELLOW : FF_COLOR_FG_RED), ms);
+    len += (int) detail.length;
+    printf("\e[s\e[1A\e[9999999C\e[%dD%s%s\e[u", len, detail.chars, str); // Save; Up 1; Right 9999999; Left <len>; Print <str>; Load
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+// Work done by the current thread, reported per module by `--stat`
+typedef struct FFStatCounters
+{
+    uint32_t filesOpened;
+    uint32_t dirEntries;
+    uint32_t processes; // spawned by ffProcessAppendOutput
+    uint32_t libraries; // loaded by ffLibraryLoad
+    uint32_t dbusCalls; // method calls sent, blocking or batched
+    uint64_t bytesRead;
+} FFStatCounters;
+
+// Thread local, so that detections running on the worker pool are not counted twice.
+// Scheduler tasks collect their own counters, which are added to the thread that waits for them
+extern __thread FFStatCounters ffStatCounters;
+
+static inline void ffStatCountersAdd(FFStatCounters* result, const FFStatCounters* value)
+{
+    result->filesOpened += value->filesOpened;
+    result->dirEntries += value->dirEntries;
+    result->processes += value->processes;
+    result->libraries += value->libraries;
+    result->dbusCalls += value->dbusCalls;
+    result->bytesRead += value->bytesRead;
+}
+
+typedef struct FFModuleStat
+{
+    double start;
+    FFStatCounters counters;
+} FFModuleStat;
+
+struct yyjson_mut_doc;
+
+void ffModuleStatBegin(FFModuleStat* stat);
+// Prints the time and counters since ffModuleStatBegin, as text annotation or as the "stat" object of the last module in `jsonDoc`
+void ffModuleStatEnd(FFModuleStat* stat, struct yyjson_mut_doc* jsonDoc);
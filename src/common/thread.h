@@ -9,10 +9,16 @@
         #include <process.h>
         #include <processthreadsapi.h>
         #define FF_THREAD_MUTEX_INITIALIZER SRWLOCK_INIT
+        #define FF_THREAD_COND_INITIALIZER CONDITION_VARIABLE_INIT
         typedef SRWLOCK FFThreadMutex;
+        typedef CONDITION_VARIABLE FFThreadCond;
         typedef HANDLE FFThreadType;
         static inline void ffThreadMutexLock(FFThreadMutex* mutex) { AcquireSRWLockExclusive(mutex); }
         static inline void ffThreadMutexUnlock(FFThreadMutex* mutex) { ReleaseSRWLockExclusive(mutex); }
+        static inline void ffThreadCondWait(FFThreadCond* cond, FFThreadMutex* mutex) { SleepConditionVariableSRW(cond, mutex, INFINITE, 0); }
+        static inline bool ffThreadCondTimedWait(FFThreadCond* cond, FFThreadMutex* mutex, uint32_t msec) { return SleepConditionVariableSRW(cond, mutex, msec, 0); }
+        static inline void ffThreadCondSignal(FFThreadCond* cond) { WakeConditionVariable(cond); }
+        static inline void ffThreadCondBroadcast(FFThreadCond* cond) { WakeAllConditionVariable(cond); }
         static inline FFThreadType ffThreadCreate(unsigned (__stdcall* func)(void*), void* data) {
             return (FFThreadType)_beginthreadex(NULL, 0, func, data, 0, NULL);
         }
@@ -37,10 +43,29 @@
             #include <pthread_np.h>
         #endif
         #define FF_THREAD_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+        #define FF_THREAD_COND_INITIALIZER PTHREAD_COND_INITIALIZER
         typedef pthread_mutex_t FFThreadMutex;
+        typedef pthread_cond_t FFThreadCond;
         typedef pthread_t FFThreadType;
         static inline void ffThreadMutexLock(FFThreadMutex* mutex) { pthread_mutex_lock(mutex); }
         static inline void ffThreadMutexUnlock(FFThreadMutex* mutex) { pthread_mutex_unlock(mutex); }
+        static inline void ffThreadCondWait(FFThreadCond* cond, FFThreadMutex* mutex) { pthread_cond_wait(cond, mutex); }
+        // Returns false on timeout
+        static inline bool ffThreadCondTimedWait(FFThreadCond* cond, FFThreadMutex* mutex, uint32_t msec)
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += msec / 1000;
+            ts.tv_nsec += (long) (msec % 1000) * 1000000;
+            if (ts.tv_nsec >= 1000000000)
+            {
+                ++ts.tv_sec;
+                ts.tv_nsec -= 1000000000;
+            }
+            return pthread_cond_timedwait(cond, mutex, &ts) == 0;
+        }
+        static inline void ffThreadCondSignal(FFThreadCond* cond) { pthread_cond_signal(cond); }
+        static inline void ffThreadCondBroadcast(FFThreadCond* cond) { pthread_cond_broadcast(cond); }
         static inline FFThreadType ffThreadCreate(void* (* func)(void*), void* data) {
             FFThreadType newThread = 0;
             pthread_create(&newThread, NULL, func, data);
@@ -0,0 +1,143 @@
+#include "common/trace.h"
+#include "common/io/io.h"
+#include "common/jsonconfig.h"
+#include "common/thread.h"
+#include "common/time.h"
+
+#include <stdlib.h>
+#ifdef _WIN32
+    #include <process.h>
+#endif
+
+typedef struct FFTraceEvent
+{
+    const char* category;
+    FFstrbuf name;
+    FFstrbuf detail;
+    double start;
+    double duration;
+    uint32_t tid;
+} FFTraceEvent;
+
+static FFstrbuf tracePath;
+static double traceOrigin;
+static int tracePid;
+static FFlist traceEvents; // FFTraceEvent
+static uint32_t threadCount;
+static __thread uint32_t threadId;
+
+#ifdef FF_HAVE_THREADS
+static FFThreadMutex mutex = FF_THREAD_MUTEX_INITIALIZER;
+#endif
+
+static uint32_t getThreadId(void)
+{
+    // Small sequential ids read better in trace viewers than native thread ids. The main thread is 1
+    if (threadId == 0)
+        threadId = __atomic_add_fetch(&threadCount, 1, __ATOMIC_RELAXED);
+    return threadId;
+}
+
+static void writeTrace(void)
+{
+    // Forked processes (e.g. daemon handlers) inherit the recording but must not overwrite the file
+    if (getpid() != tracePid)
+        return;
+
+    yyjson_mut_doc* doc = yyjson_mut_doc_new(NULL);
+    yyjson_mut_val* root = yyjson_mut_obj(doc);
+    yyjson_mut_doc_set_root(doc, root);
+    yyjson_mut_obj_add_str(doc, root, "displayTimeUnit", "ms");
+    yyjson_mut_val* events = yyjson_mut_obj_add_arr(doc, root, "traceEvents");
+
+    #ifdef FF_HAVE_THREADS
+    ffThreadMutexLock(&mutex);
+    #endif
+
+    for (uint32_t tid = 1; tid <= threadCount; ++tid)
+    {
+        yyjson_mut_val* event = yyjson_mut_arr_add_obj(doc, events);
+        yyjson_mut_obj_add_str(doc, event, "name", "thread_name");
+        yyjson_mut_obj_add_str(doc, event, "ph", "M");
+        yyjson_mut_obj_add_int(doc, event, "pid", tracePid);
+        yyjson_mut_obj_add_uint(doc, event, "tid", tid);
+        yyjson_mut_val* args = yyjson_mut_obj_add_obj(doc, event, "args");
+        yyjson_mut_obj_add_str(doc, args, "name", tid == 1 ? "main" : "worker");
+    }
+
+    FF_LIST_FOR_EACH(FFTraceEvent, traceEvent, traceEvents)
+    {
+        yyjson_mut_val* event = yyjson_mut_arr_add_obj(doc, events);
+        yyjson_mut_obj_add_strbuf(doc, event, "name", &traceEvent->name);
+        yyjson_mut_obj_add_str(doc, event, "cat", traceEvent->category);
+        yyjson_mut_obj_add_str(doc, event, "ph", "X");
+        yyjson_mut_obj_add_real(doc, event, "ts", (traceEvent->start - traceOrigin) * 1000);
+        yyjson_mut_obj_add_real(doc, event, "dur", traceEvent->duration * 1000);
+        yyjson_mut_obj_add_int(doc, event, "pid", tracePid);
+        yyjson_mut_obj_add_uint(doc, event, "tid", traceEvent->tid);
+        if (traceEvent->detail.length > 0)
+        {
+            yyjson_mut_val* args = yyjson_mut_obj_add_obj(doc, event, "args");
+            yyjson_mut_obj_add_strbuf(doc, args, "detail", &traceEvent->detail);
+        }
+    }
+
+    #ifdef FF_HAVE_THREADS
+    ffThreadMutexUnlock(&mutex);
+    #endif
+
+    size_t len;
+    char* str = yyjson_mut_write(doc, 0, &len);
+    if (!str || !ffWriteFileData(tracePath.chars, len, str))
+        fprintf(stderr, "Error: failed to write trace file `%s`\n", tracePath.chars);
+    free(str);
+    yyjson_mut_doc_free(doc);
+}
+
+void ffTraceStart(const char* path)
+{
+    if (tracePath.length > 0)
+        return;
+
+    ffStrbufInitS(&tracePath, path);
+    traceOrigin = ffTimeGetTick();
+    tracePid = (int) getpid();
+    ffListInit(&traceEvents, sizeof(FFTraceEvent));
+    getThreadId();
+    atexit(writeTrace);
+}
+
+void ffTraceBegin(FFTraceSpan* span, const char* category, const char* name, const char* detail)
+{
+    span->category = category;
+    span->name = name;
+    span->detail = detail;
+    span->start = tracePath.length > 0 ? ffTimeGetTick() : 0;
+}
+
+void ffTraceEnd(FFTraceSpan* span)
+{
+    if (span->start == 0)
+        return;
+
+    double end = ffTimeGetTick();
+    uint32_t tid = getThreadId();
+
+    #ifdef FF_HAVE_THREADS
+    ffThreadMutexLock(&mutex);
+    #endif
+
+    FFTraceEvent* event = ffListAdd(&traceEvents);
+    event->category = span->category;
+    ffStrbufInitS(&event->name, span->name);
+    ffStrbufInitS(&event->detail, span->detail ? span->detail : "");
+    event->start = span->start;
+    event->duration = end - span->start;
+    event->tid = tid;
+
+    #ifdef FF_HAVE_THREADS
+    ffThreadMutexUnlock(&mutex);
+    #endif
+
+    span->start = 0;
+}
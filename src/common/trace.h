@@ -0,0 +1,24 @@
+#pragma once
+
+#include "fastfetch.h"
+
+// A timeline of the run (`--trace <file>`), written in Chrome's trace event format when the process exits.
+// Can be loaded into Perfetto or chrome://tracing
+typedef struct FFTraceSpan
+{
+    const char* category; // must be a string literal
+    const char* name;
+    const char* detail; // optional, e.g. the command of a subprocess
+    double start;
+} FFTraceSpan;
+
+// Start recording. Should be called as early as possible. Later calls are no-ops
+void ffTraceStart(const char* path);
+// `name` and `detail` are only copied when the span ends, so they must be valid until then
+void ffTraceBegin(FFTraceSpan* span, const char* category, const char* name, const char* detail);
+// Records the span. Can be called early; later calls are no-ops
+void ffTraceEnd(FFTraceSpan* span);
+
+#define FF_TRACE_SPAN(var, category, name, detail) \
+    FFTraceSpan __attribute__((__cleanup__(ffTraceEnd), __unused__)) var; \
+    ffTraceBegin(&var, category, name, detail)
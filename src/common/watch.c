@@ -0,0 +1,168 @@
+#include "common/watch.h"
+#include "common/cache.h"
+#include "common/jsonconfig.h"
+#include "common/time.h"
+#include "modules/modules.h"
+#include "util/stringUtils.h"
+
+#include <ctype.h>
+
+typedef struct FFWatchModule
+{
+    FFModuleBaseInfo* baseInfo;
+    yyjson_val* module; // JSON config of the module, or NULL
+    uint32_t row;
+    uint32_t lines;
+} FFWatchModule;
+
+static bool recording;
+static FFlist modules; // FFWatchModule
+static uint32_t cursorRow; // Relative to the first key line
+static uint32_t frameEndRow;
+
+// Modules whose output changes between frames. Everything else is printed once
+static const char* volatileModules[] = {
+    FF_BATTERY_MODULE_NAME,
+    FF_CPUUSAGE_MODULE_NAME,
+    FF_DATETIME_MODULE_NAME,
+    FF_DISKIO_MODULE_NAME,
+    FF_LOADAVG_MODULE_NAME,
+    FF_MEMORY_MODULE_NAME,
+    FF_NETIO_MODULE_NAME,
+    FF_PROCESSES_MODULE_NAME,
+    FF_SWAP_MODULE_NAME,
+    FF_UPTIME_MODULE_NAME,
+};
+
+void ffWatchRecordModule(const char* type, yyjson_val* module, uint32_t row)
+{
+    if (!recording || !ffCharIsEnglishAlphabet(type[0]))
+        return;
+
+    for (uint32_t i = 0; i < sizeof(volatileModules) / sizeof(volatileModules[0]); ++i)
+    {
+        if (!ffStrEqualsIgnCase(type, volatileModules[i]))
+            continue;
+
+        for (FFModuleBaseInfo** infos = ffModuleInfos[toupper(type[0]) - 'A']; *infos; ++infos)
+        {
+            if (ffStrEqualsIgnCase(type, (*infos)->name))
+            {
+                FFWatchModule* item = (FFWatchModule*) ffListAdd(&modules);
+                item->baseInfo = *infos;
+                item->module = module;
+                item->row = row;
+                item->lines = instance.state.keysHeight - row;
+                break;
+            }
+        }
+        return;
+    }
+}
+
+static void moveToRow(uint32_t row)
+{
+    if (row < cursorRow)
+        printf("\e[%uA", cursorRow - row);
+    else if (row > cursorRow)
+        printf("\e[%uB", row - cursorRow);
+    putchar('\r');
+    cursorRow = row;
+}
+
+static void printModules(FFdata* data)
+{
+    if (data->structure.length == 0 && instance.state.configDoc)
+        ffPrintJsonConfig(false, NULL);
+    else
+        ffPrintCommandOption(data, NULL);
+}
+
+// The output of a module takes a different number of lines. Print everything again
+static void redrawAll(FFdata* data)
+{
+    moveToRow(0);
+    fputs("\e[J", stdout);
+
+    ffListClear(&modules);
+    instance.state.keysHeight = 0;
+    if (instance.config.logo.position != FF_LOGO_POSITION_TOP)
+        ffLogoPrint();
+    printModules(data);
+    if (instance.config.logo.printRemaining)
+        ffLogoPrintRemaining();
+    cursorRow = frameEndRow = instance.state.keysHeight;
+}
+
+static void redrawVolatile(FFdata* data)
+{
+    FF_LIST_FOR_EACH(FFWatchModule, item, modules)
+    {
+        // Clear the old output, but not the logo
+        for (uint32_t i = 0; i < item->lines; ++i)
+        {
+            moveToRow(item->row + i);
+            if (instance.state.logoWidth > 0)
+                printf("\e[%uC", instance.state.logoWidth);
+            fputs("\e[K", stdout);
+        }
+        moveToRow(item->row);
+
+        instance.state.keysHeight = item->row;
+        if (item->module)
+            item->baseInfo->parseJsonObject(item->baseInfo, item->module);
+        item->baseInfo->printModule(item->baseInfo);
+        cursorRow = instance.state.keysHeight;
+
+        if (instance.state.keysHeight - item->row != item->lines)
+        {
+            redrawAll(data);
+            return;
+        }
+    }
+}
+
+void ffWatchRun(FFdata* data, void (*run)(FFdata* data))
+{
+    if (instance.state.resultDoc)
+    {
+        fputs("Error: --watch doesn't support JSON output\n", stderr);
+        exit(400);
+    }
+
+    ffListInit(&modules, sizeof(FFWatchModule));
+    recording = true;
+    run(data);
+    cursorRow = frameEndRow = instance.state.keysHeight;
+    fflush(stdout);
+
+    bool disableLinewrap = instance.config.display.disableLinewrap && !instance.config.display.pipe;
+    bool hideCursor = instance.config.display.hideCursor && !instance.config.display.pipe;
+
+    while (true)
+    {
+        double start = ffTimeGetTick();
+
+        // Volatile results, e.g. the process table, must be detected again
+        ffCacheResetMemoized();
+
+        // Lines must not wrap or the line numbers of modules would be off
+        if (disableLinewrap) fputs("\e[?7l", stdout);
+        if (hideCursor) fputs("\e[?25l", stdout);
+
+        // The logo is on the right. Clearing lines would erase it
+        if (instance.config.logo.position == FF_LOGO_POSITION_RIGHT)
+            redrawAll(data);
+        else
+            redrawVolatile(data);
+        moveToRow(frameEndRow);
+
+        if (disableLinewrap) fputs("\e[?7h", stdout);
+        if (hideCursor) fputs("\e[?25h", stdout);
+        fflush(stdout);
+
+        double elapsed = ffTimeGetTick() - start;
+        if (elapsed < data->watch)
+            ffTimeSleep((uint32_t) (data->watch - elapsed));
+    }
+}
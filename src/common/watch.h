@@ -0,0 +1,9 @@
+#pragma once
+
+#include "fastfetch.h"
+#include "common/commandoption.h"
+
+// Called by the print loops after a module has been printed, starting at key line `row`
+void ffWatchRecordModule(const char* type, yyjson_val* module, uint32_t row);
+// Print the first frame with `run`, then refresh volatile modules in place every `data->watch` ms until killed
+void ffWatchRun(FFdata* data, void (*run)(FFdata* data));
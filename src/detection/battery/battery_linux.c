@@ -7,68 +7,47 @@
 
 // https://www.kernel.org/doc/Documentation/ABI/testing/sysfs-class-power
 
-static void parseBattery(FFstrbuf* dir, const char* id, FFBatteryOptions* options, FFlist* results)
+static bool readTrimmed(int dfd, const char* fileName, FFstrbuf* buffer)
 {
-    uint32_t dirLength = dir->length;
+    if (!ffReadFileBufferRelative(dfd, fileName, buffer))
+        return false;
+    ffStrbufTrimRightSpace(buffer);
+    return true;
+}
 
-    FF_STRBUF_AUTO_DESTROY tmpBuffer = ffStrbufCreate();
+static void parseBattery(int dfd, const char* id, FFBatteryOptions* options, FFlist* results)
+{
+    char tmp[64];
 
     //type must exist and be "Battery"
-    ffStrbufAppendS(dir, "/type");
-    if (ffReadFileBuffer(dir->chars, &tmpBuffer))
-        ffStrbufTrimRightSpace(&tmpBuffer);
-    ffStrbufSubstrBefore(dir, dirLength);
-
-    if(!ffStrbufIgnCaseEqualS(&tmpBuffer, "Battery"))
+    if (ffReadFileStrRelative(dfd, "type", sizeof(tmp), tmp) < 0 || !ffStrEqualsIgnCase(tmp, "Battery"))
         return;
 
     //scope may not exist or must not be "Device"
-    ffStrbufAppendS(dir, "/scope");
-    if (ffReadFileBuffer(dir->chars, &tmpBuffer))
-        ffStrbufTrimRightSpace(&tmpBuffer);
-    ffStrbufSubstrBefore(dir, dirLength);
-
-    if(ffStrbufIgnCaseEqualS(&tmpBuffer, "Device"))
+    if (ffReadFileStrRelative(dfd, "scope", sizeof(tmp), tmp) >= 0 && ffStrEqualsIgnCase(tmp, "Device"))
         return;
 
     //capacity must exist and be not empty
-    ffStrbufAppendS(dir, "/capacity");
-    bool available = ffReadFileBuffer(dir->chars, &tmpBuffer); // This is expensive in my laptop
-    ffStrbufSubstrBefore(dir, dirLength);
-
-    if (!available)
+    if (ffReadFileStrRelative(dfd, "capacity", sizeof(tmp), tmp) <= 0) // This is expensive in my laptop
         return;
 
     FFBatteryResult* result = ffListAdd(results);
-    result->capacity = ffStrbufToDouble(&tmpBuffer);
+    result->capacity = strtod(tmp, NULL);
 
     //At this point, we have a battery. Try to get as much values as possible.
 
     ffStrbufInit(&result->manufacturer);
-    ffStrbufAppendS(dir, "/manufacturer");
-    if (ffReadFileBuffer(dir->chars, &result->manufacturer))
-        ffStrbufTrimRightSpace(&result->manufacturer);
-    else if (ffStrEquals(id, "macsmc-battery")) // asahi
+    if (!readTrimmed(dfd, "manufacturer", &result->manufacturer) && ffStrEquals(id, "macsmc-battery")) // asahi
         ffStrbufSetStatic(&result->manufacturer, "Apple Inc.");
-    ffStrbufSubstrBefore(dir, dirLength);
 
     ffStrbufInit(&result->modelName);
-    ffStrbufAppendS(dir, "/model_name");
-    if (ffReadFileBuffer(dir->chars, &result->modelName))
-        ffStrbufTrimRightSpace(&result->modelName);
-    ffStrbufSubstrBefore(dir, dirLength);
+    readTrimmed(dfd, "model_name", &result->modelName);
 
     ffStrbufInit(&result->technology);
-    ffStrbufAppendS(dir, "/technology");
-    if (ffReadFileBuffer(dir->chars, &result->technology))
-        ffStrbufTrimRightSpace(&result->technology);
-    ffStrbufSubstrBefore(dir, dirLength);
+    readTrimmed(dfd, "technology", &result->technology);
 
     ffStrbufInit(&result->status);
-    ffStrbufAppendS(dir, "/status");
-    if (ffReadFileBuffer(dir->chars, &result->status))
-        ffStrbufTrimRightSpace(&result->status);
-    ffStrbufSubstrBefore(dir, dirLength);
+    readTrimmed(dfd, "status", &result->status);
 
     // Unknown, Charging, Discharging, Not charging, Full
     if (ffStrbufEqualS(&result->status, "Not charging") || ffStrbufEqualS(&result->status, "Full"))
@@ -76,98 +55,55 @@ static void parseBattery(FFstrbuf* dir, const char* id, FFBatteryOptions* option
     else if (ffStrbufEqualS(&result->status, "Unknown"))
         ffStrbufClear(&result->status);
 
-    ffStrbufAppendS(dir, "/capacity_level");
-    if (ffReadFileBuffer(dir->chars, &tmpBuffer))
+    if (ffReadFileStrRelative(dfd, "capacity_level", sizeof(tmp), tmp) > 0 && ffStrEquals(tmp, "Critical"))
     {
-        ffStrbufTrimRightSpace(&result->manufacturer);
-        if (ffStrbufEqualS(&tmpBuffer, "Critical"))
-        {
-            if (result->status.length)
-                ffStrbufAppendS(&result->status, ", Critical");
-            else
-                ffStrbufSetStatic(&result->status, "Critical");
-        }
+        if (result->status.length)
+            ffStrbufAppendS(&result->status, ", Critical");
+        else
+            ffStrbufSetStatic(&result->status, "Critical");
     }
-    ffStrbufSubstrBefore(dir, dirLength);
 
     ffStrbufInit(&result->serial);
-    ffStrbufAppendS(dir, "/serial_number");
-    if (ffReadFileBuffer(dir->chars, &result->serial))
-        ffStrbufTrimRightSpace(&result->serial);
-    ffStrbufSubstrBefore(dir, dirLength);
-
-    ffStrbufAppendS(dir, "/cycle_count");
-    available = ffReadFileBuffer(dir->chars, &tmpBuffer);
-    ffStrbufSubstrBefore(dir, dirLength);
-    if (available)
-    {
-        int64_t cycleCount = ffStrbufToSInt(&tmpBuffer, 0);
+    readTrimmed(dfd, "serial_number", &result->serial);
+
+    int64_t cycleCount;
+    if (ffReadFileInt64Relative(dfd, "cycle_count", &cycleCount))
         result->cycleCount = cycleCount < 0 || cycleCount > UINT32_MAX ? 0 : (uint32_t) cycleCount;
-    }
 
     ffStrbufInit(&result->manufactureDate);
-    ffStrbufAppendS(dir, "/manufacture_year");
-    available = ffReadFileBuffer(dir->chars, &tmpBuffer);
-    ffStrbufSubstrBefore(dir, dirLength);
-    if (available)
-    {
-        int year = (int) ffStrbufToSInt(&tmpBuffer, 0);
-        if (year > 0)
-        {
-            ffStrbufAppendS(dir, "/manufacture_month");
-            available = ffReadFileBuffer(dir->chars, &tmpBuffer);
-            ffStrbufSubstrBefore(dir, dirLength);
-            if (available)
-            {
-                int month = (int) ffStrbufToSInt(&tmpBuffer, 0);
-                if (month > 0)
-                {
-                    ffStrbufAppendS(dir, "/manufacture_day");
-                    available = ffReadFileBuffer(dir->chars, &tmpBuffer);
-                    ffStrbufSubstrBefore(dir, dirLength);
-                    if (available)
-                    {
-                        int day = (int) ffStrbufToSInt(&tmpBuffer, 0);
-                        if (day > 0)
-                        {
-                            ffStrbufSetF(&result->manufactureDate, "%.4d-%.2d-%.2d", year, month, day);
-                        }
-                    }
-                }
-            }
-        }
-    }
+    int64_t year, month, day;
+    if (
+        ffReadFileInt64Relative(dfd, "manufacture_year", &year) && year > 0 &&
+        ffReadFileInt64Relative(dfd, "manufacture_month", &month) && month > 0 &&
+        ffReadFileInt64Relative(dfd, "manufacture_day", &day) && day > 0
+    )
+        ffStrbufSetF(&result->manufactureDate, "%.4d-%.2d-%.2d", (int) year, (int) month, (int) day);
 
     result->temperature = FF_BATTERY_TEMP_UNSET;
     if (options->temp)
     {
-        ffStrbufAppendS(dir, "/temp");
-        if (ffReadFileBuffer(dir->chars, &tmpBuffer))
-            result->temperature = ffStrbufToDouble(&tmpBuffer) / 10;
-        ffStrbufSubstrBefore(dir, dirLength);
+        int64_t temp;
+        if (ffReadFileInt64Relative(dfd, "temp", &temp))
+            result->temperature = (double) temp / 10;
     }
 }
 
 const char* ffDetectBattery(FFBatteryOptions* options, FFlist* results)
 {
-    FF_STRBUF_AUTO_DESTROY baseDir = ffStrbufCreateA(64);
-    ffStrbufAppendS(&baseDir, "/sys/class/power_supply/");
-
-    uint32_t baseDirLength = baseDir.length;
-
-    FF_AUTO_CLOSE_DIR DIR* dirp = opendir(baseDir.chars);
+    FF_AUTO_CLOSE_DIR DIR* dirp = opendir("/sys/class/power_supply/");
     if(dirp == NULL)
         return "opendir(\"/sys/class/power_supply/\") == NULL";
 
     struct dirent* entry;
-    while((entry = readdir(dirp)) != NULL)
+    while((entry = ffReadDir(dirp)) != NULL)
     {
         if(ffStrEquals(entry->d_name, ".") || ffStrEquals(entry->d_name, ".."))
             continue;
 
-        ffStrbufAppendS(&baseDir, entry->d_name);
-        parseBattery(&baseDir, entry->d_name, options, results);
-        ffStrbufSubstrBefore(&baseDir, baseDirLength);
+        int FF_AUTO_CLOSE_FD supplyFd = ffOpenDirRelative(dirfd(dirp), entry->d_name);
+        if(supplyFd < 0)
+            continue;
+        parseBattery(supplyFd, entry->d_name, options, results);
     }
 
     return NULL;
@@ -23,7 +23,7 @@ static const char* detectWithBacklight(FFlist* result)
     FF_STRBUF_AUTO_DESTROY buffer = ffStrbufCreate();
 
     struct dirent* entry;
-    while((entry = readdir(dirp)) != NULL)
+    while((entry = ffReadDir(dirp)) != NULL)
     {
         if(ffStrEquals(entry->d_name, ".") || ffStrEquals(entry->d_name, ".."))
             continue;
@@ -175,85 +175,100 @@ static const char* parseCpuInfo(FILE* cpuinfo, FFCPUResult* cpu, FFstrbuf* physi
     return NULL;
 }
 
-static uint32_t getFrequency(FFstrbuf* basePath, const char* cpuinfoFileName, const char* scalingFileName, FFstrbuf* buffer)
+static uint8_t getNumCores(int policyFd, FFstrbuf* buffer)
 {
-    uint32_t baseLen = basePath->length;
-    ffStrbufAppendS(basePath, cpuinfoFileName);
-    bool ok = ffReadFileBuffer(basePath->chars, buffer);
-    ffStrbufSubstrBefore(basePath, baseLen);
-    if (ok)
-        return (uint32_t) (ffStrbufToUInt(buffer, 0) / 1000);
-
-    if (scalingFileName)
-    {
-        ffStrbufAppendS(basePath, scalingFileName);
-        ok = ffReadFileBuffer(basePath->chars, buffer);
-        ffStrbufSubstrBefore(basePath, baseLen);
-        if (ok)
-            return (uint32_t) (ffStrbufToUInt(buffer, 0) / 1000);
-    }
+    if (ffReadFileBufferRelative(policyFd, "affected_cpus", buffer) ||
+        ffReadFileBufferRelative(policyFd, "related_cpus", buffer))
+        return (uint8_t) (ffStrbufCountC(buffer, ' ') + 1);
 
     return 0;
 }
 
-static uint8_t getNumCores(FFstrbuf* basePath, FFstrbuf* buffer)
-{
-    uint32_t baseLen = basePath->length;
-    ffStrbufAppendS(basePath, "/affected_cpus");
-    bool ok = ffReadFileBuffer(basePath->chars, buffer);
-    ffStrbufSubstrBefore(basePath, baseLen);
-    if (ok)
-        return (uint8_t) (ffStrbufCountC(buffer, ' ') + 1);
+enum { FF_CPUFREQ_BASE, FF_CPUFREQ_BIOS_LIMIT, FF_CPUFREQ_CPUINFO_MAX, FF_CPUFREQ_SCALING_MAX, FF_CPUFREQ_COUNT };
 
-    ffStrbufAppendS(basePath, "/related_cpus");
-    ok = ffReadFileBuffer(basePath->chars, buffer);
-    ffStrbufSubstrBefore(basePath, baseLen);
-    if (ok)
-        return (uint8_t) (ffStrbufCountC(buffer, ' ') + 1);
+static const char* cpufreqFileNames[FF_CPUFREQ_COUNT] = {
+    [FF_CPUFREQ_BASE] = "base_frequency",
+    [FF_CPUFREQ_BIOS_LIMIT] = "bios_limit",
+    [FF_CPUFREQ_CPUINFO_MAX] = "cpuinfo_max_freq",
+    [FF_CPUFREQ_SCALING_MAX] = "scaling_max_freq",
+};
 
-    return 0;
+static uint32_t getFrequency(const FFReadFileRequest* request)
+{
+    if (request->result <= 0)
+        return 0;
+    ((char*) request->buf)[request->result] = '\0';
+    return (uint32_t) (strtoul(request->buf, NULL, 10) / 1000);
 }
 
 static bool detectFrequency(FFCPUResult* cpu, const FFCPUOptions* options)
 {
-    FF_STRBUF_AUTO_DESTROY path = ffStrbufCreateS("/sys/devices/system/cpu/cpufreq/");
-    FF_AUTO_CLOSE_DIR DIR* dir = opendir(path.chars);
+    FF_AUTO_CLOSE_DIR DIR* dir = opendir("/sys/devices/system/cpu/cpufreq/");
     if (!dir) return false;
 
-    FF_STRBUF_AUTO_DESTROY buffer = ffStrbufCreate();
-    uint32_t baseLen = path.length;
+    // With intel_pstate, there is a policy for every logical CPU. Read the files of all policies at once
+    FF_LIST_AUTO_DESTROY policyFds = ffListCreate(sizeof(int));
 
     struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL)
+    while ((entry = ffReadDir(dir)) != NULL)
     {
         if (ffStrStartsWith(entry->d_name, "policy") && ffCharIsDigit(entry->d_name[strlen("policy")]))
         {
-            ffStrbufAppendS(&path, entry->d_name);
-            uint32_t fbase = getFrequency(&path, "/base_frequency", NULL, &buffer);
-            if (fbase > 0)
-                cpu->frequencyBase = cpu->frequencyBase > fbase ? cpu->frequencyBase : fbase;
+            int policyFd = ffOpenDirRelative(dirfd(dir), entry->d_name);
+            if (policyFd >= 0)
+                *(int*) ffListAdd(&policyFds) = policyFd;
+        }
+    }
+
+    uint32_t count = policyFds.length * FF_CPUFREQ_COUNT;
+    FF_AUTO_FREE FFReadFileRequest* requests = malloc(count * sizeof(*requests));
+    FF_AUTO_FREE char (*values)[24] = malloc(count * sizeof(*values));
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        requests[i] = (FFReadFileRequest) {
+            .dfd = *FF_LIST_GET(int, policyFds, i / FF_CPUFREQ_COUNT),
+            .path = cpufreqFileNames[i % FF_CPUFREQ_COUNT],
+            .size = sizeof(*values) - 1,
+            .buf = values[i],
+        };
+    }
+    ffReadFilesBatch(count, requests);
 
-            uint32_t fbioslimit = getFrequency(&path, "/bios_limit", NULL, &buffer);
-            if (fbioslimit > 0)
-                cpu->frequencyBiosLimit = cpu->frequencyBiosLimit > fbioslimit ? cpu->frequencyBiosLimit : fbioslimit;
+    FF_STRBUF_AUTO_DESTROY buffer = ffStrbufCreate();
 
-            uint32_t fmax = getFrequency(&path, "/cpuinfo_max_freq", "/scaling_max_freq", &buffer);
-            if (fmax > 0)
-                cpu->frequencyMax = cpu->frequencyMax > fmax ? cpu->frequencyMax : fmax;
+    for (uint32_t i = 0; i < policyFds.length; ++i)
+    {
+        const FFReadFileRequest* policy = &requests[i * FF_CPUFREQ_COUNT];
 
-            if (options->showPeCoreCount)
-            {
-                uint32_t freq = fbase == 0 ? fmax : fbase; // seems base frequencies are more stable
-                uint32_t ifreq = 0;
-                while (cpu->coreTypes[ifreq].freq != freq && cpu->coreTypes[ifreq].freq > 0)
-                    ++ifreq;
-                if (cpu->coreTypes[ifreq].freq == 0)
-                    cpu->coreTypes[ifreq].freq = freq;
-                cpu->coreTypes[ifreq].count += getNumCores(&path, &buffer);
-            }
-            ffStrbufSubstrBefore(&path, baseLen);
+        uint32_t fbase = getFrequency(&policy[FF_CPUFREQ_BASE]);
+        if (fbase > 0)
+            cpu->frequencyBase = cpu->frequencyBase > fbase ? cpu->frequencyBase : fbase;
+
+        uint32_t fbioslimit = getFrequency(&policy[FF_CPUFREQ_BIOS_LIMIT]);
+        if (fbioslimit > 0)
+            cpu->frequencyBiosLimit = cpu->frequencyBiosLimit > fbioslimit ? cpu->frequencyBiosLimit : fbioslimit;
+
+        uint32_t fmax = getFrequency(&policy[FF_CPUFREQ_CPUINFO_MAX]);
+        if (fmax == 0)
+            fmax = getFrequency(&policy[FF_CPUFREQ_SCALING_MAX]);
+        if (fmax > 0)
+            cpu->frequencyMax = cpu->frequencyMax > fmax ? cpu->frequencyMax : fmax;
+
+        if (options->showPeCoreCount)
+        {
+            uint32_t freq = fbase == 0 ? fmax : fbase; // seems base frequencies are more stable
+            uint32_t ifreq = 0;
+            while (cpu->coreTypes[ifreq].freq != freq && cpu->coreTypes[ifreq].freq > 0)
+                ++ifreq;
+            if (cpu->coreTypes[ifreq].freq == 0)
+                cpu->coreTypes[ifreq].freq = freq;
+            cpu->coreTypes[ifreq].count += getNumCores(*FF_LIST_GET(int, policyFds, i), &buffer);
         }
     }
+
+    FF_LIST_FOR_EACH(int, policyFd, policyFds)
+        close(*policyFd);
+
     return true;
 }
 
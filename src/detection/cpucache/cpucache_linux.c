@@ -65,7 +65,7 @@ static const char* parseCpuCache(FFstrbuf* path, FFCPUCacheResult* result, FFstr
         return "opendir(\"/sys/devices/system/cpu/cpuX/cache/\") == NULL";
 
     struct dirent* pathCacheEntry;
-    while ((pathCacheEntry = readdir(pathCacheDir)) != NULL)
+    while ((pathCacheEntry = ffReadDir(pathCacheDir)) != NULL)
     {
         if (!ffStrStartsWith(pathCacheEntry->d_name, "index")
             || !ffCharIsDigit(pathCacheEntry->d_name[strlen("index")])) continue;
@@ -92,7 +92,7 @@ const char* ffDetectCPUCache(FFCPUCacheResult* result)
     FF_STRBUF_AUTO_DESTROY added = ffStrbufCreate();
 
     struct dirent* pathCpuEntry;
-    while ((pathCpuEntry = readdir(pathCpuDir)) != NULL)
+    while ((pathCpuEntry = ffReadDir(pathCpuDir)) != NULL)
     {
         if (!ffStrStartsWith(pathCpuEntry->d_name, "cpu") ||
             !ffCharIsDigit(pathCpuEntry->d_name[strlen("cpu")])) continue;
@@ -1,22 +1,83 @@
 #include "fastfetch.h"
 #include "detection/cpuusage/cpuusage.h"
+#include "common/cache.h"
 #include "common/time.h"
 
 #include <stdint.h>
 
 static FFlist cpuTimes1;
+static FFlist cpuTimesNext;
+static bool baselinePersisted; // cpuTimes1 was stored by the previous run
+
+static void initBaselineEntry(FFCacheEntry* cache)
+{
+    ffCacheEntryInit(cache, "cpuusage");
+    ffCacheKeyAddBootId(cache);
+}
+
+static bool loadBaseline(void)
+{
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    initBaselineEntry(&cache);
+
+    uint32_t size;
+    const void* data;
+    if (ffCacheLoadBaseline(&cache) == UINT64_MAX || !ffCacheGetDataRef(&cache, &size, &data) ||
+        size == 0 || size % sizeof(FFCpuUsageInfo) != 0)
+        return false;
+
+    uint32_t count = size / (uint32_t) sizeof(FFCpuUsageInfo);
+    ffListInitA(&cpuTimes1, sizeof(FFCpuUsageInfo), count);
+    memcpy(cpuTimes1.data, data, size);
+    cpuTimes1.length = count;
+    baselinePersisted = true;
+    return true;
+}
+
+static void storeBaseline(void)
+{
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    initBaselineEntry(&cache);
+    ffCacheStartBaseline(&cache);
+    ffCachePutData(&cache, cpuTimes1.length * (uint32_t) sizeof(FFCpuUsageInfo), cpuTimes1.data);
+    ffCacheStore(&cache);
+}
 
 void ffPrepareCPUUsage(void)
 {
-    assert(cpuTimes1.elementSize == 0);
+    if (cpuTimes1.elementSize != 0)
+        return; // Sampled by the daemon already
+
+    if (loadBaseline())
+        return;
+
     ffListInit(&cpuTimes1, sizeof(FFCpuUsageInfo));
     ffGetCpuUsageInfo(&cpuTimes1);
 }
 
+// Called periodically by long running processes. The baseline is always one sampling interval old
+void ffSampleCPUUsage(void)
+{
+    if (cpuTimes1.elementSize == 0)
+        return;
+
+    if (cpuTimesNext.elementSize == 0)
+        ffListInit(&cpuTimesNext, sizeof(FFCpuUsageInfo));
+    else
+    {
+        FFlist temp = cpuTimes1;
+        cpuTimes1 = cpuTimesNext;
+        cpuTimesNext = temp;
+        ffListClear(&cpuTimesNext);
+        baselinePersisted = false;
+    }
+    ffGetCpuUsageInfo(&cpuTimesNext);
+}
+
 const char* ffGetCpuUsageResult(FFlist* result)
 {
     const char* error = NULL;
-    if(cpuTimes1.elementSize == 0)
+    if(cpuTimes1.elementSize == 0 && !loadBaseline())
     {
         ffListInit(&cpuTimes1, sizeof(FFCpuUsageInfo));
         error = ffGetCpuUsageInfo(&cpuTimes1);
@@ -32,6 +93,20 @@ const char* ffGetCpuUsageResult(FFlist* result)
 retry:
     error = ffGetCpuUsageInfo(&cpuTimes2);
     if(error) return error;
+    if(baselinePersisted)
+    {
+        baselinePersisted = false;
+        if(cpuTimes1.length != cpuTimes2.length)
+        {
+            // CPUs were hot-plugged since the previous run. Start over with the current sample
+            FFlist temp = cpuTimes1;
+            cpuTimes1 = cpuTimes2;
+            cpuTimes2 = temp;
+            ffListClear(&cpuTimes2);
+            ffTimeSleep(200);
+            goto retry;
+        }
+    }
     if(cpuTimes1.length != cpuTimes2.length) return "Unexpected CPU usage result";
 
     for (uint32_t i = 0; i < cpuTimes1.length; ++i)
@@ -57,5 +132,6 @@ retry:
         cpuTime1->inUseAll = cpuTime2->inUseAll;
         cpuTime1->totalAll = cpuTime2->totalAll;
     }
+    storeBaseline();
     return NULL;
 }
@@ -34,7 +34,7 @@ static void getKDE(FFstrbuf* result, FFDEOptions* options)
 
     if(result->length == 0 && options->slowVersionDetection)
     {
-        if (ffProcessAppendStdOut(result, (char* const[]){
+        if (ffProcessAppendStdOutCached(result, (char* const[]){
             "plasmashell",
             "--version",
             NULL
@@ -63,7 +63,7 @@ static void getGnome(FFstrbuf* result, FF_MAYBE_UNUSED FFDEOptions* options)
 
     if (result->length == 0 && options->slowVersionDetection)
     {
-        if (ffProcessAppendStdOut(result, (char* const[]){
+        if (ffProcessAppendStdOutCached(result, (char* const[]){
             "gnome-shell",
             "--version",
             NULL
@@ -81,7 +81,7 @@ static void getCinnamon(FFstrbuf* result, FF_MAYBE_UNUSED FFDEOptions* options)
 
     if (result->length == 0 && options->slowVersionDetection)
     {
-        if (ffProcessAppendStdOut(result, (char* const[]){
+        if (ffProcessAppendStdOutCached(result, (char* const[]){
             "cinnamon",
             "--version",
             NULL
@@ -106,7 +106,7 @@ static void getMate(FFstrbuf* result, FFDEOptions* options)
 
     if(result->length == 0 && options->slowVersionDetection)
     {
-        ffProcessAppendStdOut(result, (char* const[]){
+        ffProcessAppendStdOutCached(result, (char* const[]){
             "mate-session",
             "--version",
             NULL
@@ -138,7 +138,7 @@ static void getXFCE4(FFstrbuf* result, FFDEOptions* options)
     if(result->length == 0 && options->slowVersionDetection)
     {
         //This is somewhat slow
-        ffProcessAppendStdOut(result, (char* const[]){
+        ffProcessAppendStdOutCached(result, (char* const[]){
             "xfce4-session",
             "--version",
             NULL
@@ -162,7 +162,7 @@ static void getLXQt(FFstrbuf* result, FFDEOptions* options)
     if(result->length == 0 && options->slowVersionDetection)
     {
         //This is really, really, really slow. Thank you, LXQt developers
-        ffProcessAppendStdOut(result, (char* const[]){
+        ffProcessAppendStdOutCached(result, (char* const[]){
             "lxqt-session",
             "-v",
             NULL
@@ -1,12 +1,14 @@
 #include "disk.h"
 
 #include "common/io/io.h"
+#include "common/thread.h"
+#include "common/time.h"
 #include "util/stringUtils.h"
 
 #include <limits.h>
 #include <ctype.h>
 #include <dirent.h>
-#include <mntent.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
 #include <sys/mount.h>
@@ -18,41 +20,105 @@
     #define readdir readdir64
 #endif
 
-static bool isPhysicalDevice(const struct mntent* device)
+// Statvfs of a network filesystem may block for minutes if the server is unreachable
+#define FF_DISK_STATS_TIMEOUT 500 // msec, same as the remote volume check on Windows
+#define FF_DISK_STATS_MAX_WORKERS 8
+#define FF_DISK_STATS_MAX_THREADS (FF_DISK_STATS_MAX_WORKERS * 2) // including the ones that hang
+
+typedef struct FFMountInfo
+{
+    const char* mountFrom;
+    const char* mountpoint;
+    const char* filesystem;
+    const char* superOptions;
+} FFMountInfo;
+
+// Splits off the next field of a mountinfo line, and decodes the octal escapes (`\040`) used for spaces and other special characters
+static char* nextMountInfoField(char** cursor)
+{
+    char* field = *cursor;
+    char* end = strchr(field, ' ');
+    if (end)
+    {
+        *end = '\0';
+        *cursor = end + 1;
+    }
+    else
+        *cursor = field + strlen(field);
+
+    char* out = field;
+    for (const char* in = field; *in; ++in)
+    {
+        if (in[0] == '\\' && in[1] >= '0' && in[1] <= '3' && in[2] >= '0' && in[2] <= '7' && in[3] >= '0' && in[3] <= '7')
+        {
+            *out++ = (char) (((in[1] - '0') << 6) | ((in[2] - '0') << 3) | (in[3] - '0'));
+            in += 3;
+        }
+        else
+            *out++ = *in;
+    }
+    *out = '\0';
+    return field;
+}
+
+// 36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+static bool parseMountInfo(char* line, FFMountInfo* info)
+{
+    for (int i = 0; i < 4; ++i) // mount ID, parent ID, major:minor, root
+        nextMountInfoField(&line);
+    info->mountpoint = nextMountInfoField(&line);
+    nextMountInfoField(&line); // mount options
+
+    // Optional fields, terminated by a single hyphen
+    const char* field;
+    do
+    {
+        if (*line == '\0')
+            return false;
+        field = nextMountInfoField(&line);
+    } while (!ffStrEquals(field, "-"));
+
+    info->filesystem = nextMountInfoField(&line);
+    info->mountFrom = nextMountInfoField(&line);
+    info->superOptions = nextMountInfoField(&line);
+    return *info->mountpoint != '\0';
+}
+
+static bool isPhysicalDevice(const FFMountInfo* device)
 {
     #ifndef __ANDROID__ //On Android, `/dev` is not accessible, so that the following checks always fail
 
     //Always show the root path
-    if(ffStrEquals(device->mnt_dir, "/"))
+    if(ffStrEquals(device->mountpoint, "/"))
         return true;
 
-    if(ffStrEquals(device->mnt_fsname, "none"))
+    if(ffStrEquals(device->mountFrom, "none"))
         return false;
 
     //DrvFs is a filesystem plugin to WSL that was designed to support interop between WSL and the Windows filesystem.
-    if(ffStrEquals(device->mnt_type, "9p"))
-        return ffStrContains(device->mnt_opts, "aname=drvfs");
+    if(ffStrEquals(device->filesystem, "9p"))
+        return ffStrContains(device->superOptions, "aname=drvfs");
 
     //ZFS pool
-    if(ffStrEquals(device->mnt_type, "zfs"))
+    if(ffStrEquals(device->filesystem, "zfs"))
         return true;
 
     //Pseudo filesystems don't have a device in /dev
-    if(!ffStrStartsWith(device->mnt_fsname, "/dev/"))
+    if(!ffStrStartsWith(device->mountFrom, "/dev/"))
         return false;
 
     //#731
-    if(ffStrEquals(device->mnt_type, "bcachefs"))
+    if(ffStrEquals(device->filesystem, "bcachefs"))
         return true;
 
     if(
-        ffStrStartsWith(device->mnt_fsname + 5, "loop") || //Ignore loop devices
-        ffStrStartsWith(device->mnt_fsname + 5, "ram")  || //Ignore ram devices
-        ffStrStartsWith(device->mnt_fsname + 5, "fd")      //Ignore fd devices
+        ffStrStartsWith(device->mountFrom + 5, "loop") || //Ignore loop devices
+        ffStrStartsWith(device->mountFrom + 5, "ram")  || //Ignore ram devices
+        ffStrStartsWith(device->mountFrom + 5, "fd")      //Ignore fd devices
     ) return false;
 
     struct stat deviceStat;
-    if(stat(device->mnt_fsname, &deviceStat) != 0)
+    if(stat(device->mountFrom, &deviceStat) != 0)
         return false;
 
     //Ignore all devices that are not block devices
@@ -62,17 +128,17 @@ static bool isPhysicalDevice(const struct mntent* device)
     #else
 
     //Pseudo filesystems don't have a device in /dev
-    if(!ffStrStartsWith(device->mnt_fsname, "/dev/"))
+    if(!ffStrStartsWith(device->mountFrom, "/dev/"))
         return false;
 
     if(
-        ffStrStartsWith(device->mnt_fsname + 5, "loop") || //Ignore loop devices
-        ffStrStartsWith(device->mnt_fsname + 5, "ram")  || //Ignore ram devices
-        ffStrStartsWith(device->mnt_fsname + 5, "fd")      //Ignore fd devices
+        ffStrStartsWith(device->mountFrom + 5, "loop") || //Ignore loop devices
+        ffStrStartsWith(device->mountFrom + 5, "ram")  || //Ignore ram devices
+        ffStrStartsWith(device->mountFrom + 5, "fd")      //Ignore fd devices
     ) return false;
 
     // https://source.android.com/docs/core/ota/apex?hl=zh-cn
-    if(ffStrStartsWith(device->mnt_dir, "/apex/")) 
+    if(ffStrStartsWith(device->mountpoint, "/apex/")) 
         return false;
 
     #endif // __ANDROID__
@@ -147,9 +213,17 @@ static void detectName(FFDisk* disk)
     }
 }
 
+// Disks added so far, by mountFrom and by ZFS pool name. Open addressing, stores index in disks + 1
+typedef struct FFDiskKeySet
+{
+    uint32_t* mountFroms;
+    uint32_t* zpools;
+    uint32_t mask;
+} FFDiskKeySet;
+
 #ifdef __ANDROID__
 
-static void detectType(FF_MAYBE_UNUSED const FFlist* disks, FFDisk* currentDisk)
+static void detectType(FF_MAYBE_UNUSED FFDiskKeySet* keys, FF_MAYBE_UNUSED const FFlist* disks, FFDisk* currentDisk)
 {
     if(ffStrbufEqualS(&currentDisk->mountpoint, "/") || ffStrbufEqualS(&currentDisk->mountpoint, "/storage/emulated"))
         currentDisk->type = FF_DISK_VOLUME_TYPE_REGULAR_BIT;
@@ -161,41 +235,53 @@ static void detectType(FF_MAYBE_UNUSED const FFlist* disks, FFDisk* currentDisk)
 
 #else
 
-static bool isSubvolume(const FFlist* disks, FFDisk* currentDisk)
+static uint32_t hashKey(uint32_t length, const char* key)
 {
-    if(ffStrbufEqualS(&currentDisk->mountFrom, "drvfs")) // WSL Windows drives
-        return false;
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (uint32_t i = 0; i < length; ++i)
+        hash = (hash ^ (uint8_t) key[i]) * 16777619u;
+    return hash;
+}
 
-    if(ffStrbufEqualS(&currentDisk->filesystem, "zfs"))
+static inline uint32_t getKeyLength(const FFDisk* disk, bool zpool)
+{
+    return zpool ? ffStrbufFirstIndexC(&disk->mountFrom, '/') : disk->mountFrom.length;
+}
+
+// Returns true if an earlier disk has the same key. Adds the last disk to `table` otherwise
+static bool findOrAddKey(uint32_t* table, uint32_t mask, const FFlist* disks, bool zpool)
+{
+    const FFDisk* currentDisk = FF_LIST_GET(FFDisk, *disks, disks->length - 1);
+    uint32_t length = getKeyLength(currentDisk, zpool);
+
+    uint32_t i = hashKey(length, currentDisk->mountFrom.chars) & mask;
+    for (; table[i]; i = (i + 1) & mask)
     {
-        //ZFS subvolumes
-        uint32_t index = ffStrbufFirstIndexC(&currentDisk->mountFrom, '/');
-        if (index == currentDisk->mountFrom.length)
-            return false;
+        const FFDisk* otherDevice = FF_LIST_GET(FFDisk, *disks, table[i] - 1);
+        if (getKeyLength(otherDevice, zpool) == length && memcmp(otherDevice->mountFrom.chars, currentDisk->mountFrom.chars, length) == 0)
+            return true;
+    }
+    table[i] = disks->length;
+    return false;
+}
 
-        FF_STRBUF_AUTO_DESTROY zpoolName = ffStrbufCreateNS(index, currentDisk->mountFrom.chars);
-        for(uint32_t i = 0; i < disks->length - 1; i++)
-        {
-            const FFDisk* otherDevice = ffListGet(disks, i);
-            if(ffStrbufEqualS(&otherDevice->filesystem, "zfs") && ffStrbufStartsWith(&otherDevice->mountFrom, &zpoolName))
-                return true;
-        }
+// Must be called for every disk, so that later ones can be compared with it
+static bool isSubvolume(FFDiskKeySet* keys, const FFlist* disks, FFDisk* currentDisk)
+{
+    //Filter all disks which device was already found. This catches BTRFS subvolumes.
+    bool sameDevice = findOrAddKey(keys->mountFroms, keys->mask, disks, false);
 
+    if(ffStrbufEqualS(&currentDisk->mountFrom, "drvfs")) // WSL Windows drives
         return false;
-    }
-    else
-    {
-        //Filter all disks which device was already found. This catches BTRFS subvolumes.
-        for(uint32_t i = 0; i < disks->length - 1; i++)
-        {
-            const FFDisk* otherDevice = ffListGet(disks, i);
 
-            if(ffStrbufEqual(&currentDisk->mountFrom, &otherDevice->mountFrom))
-                return true;
-        }
+    if(ffStrbufEqualS(&currentDisk->filesystem, "zfs"))
+    {
+        //ZFS subvolumes
+        bool samePool = findOrAddKey(keys->zpools, keys->mask, disks, true);
+        return samePool && ffStrbufContainC(&currentDisk->mountFrom, '/');
     }
 
-    return false;
+    return sameDevice;
 }
 
 static bool isRemovable(FFDisk* currentDisk)
@@ -203,23 +289,23 @@ static bool isRemovable(FFDisk* currentDisk)
     if (!ffStrbufStartsWithS(&currentDisk->mountFrom, "/dev/"))
         return false;
 
-    char sysBlockPartition[64];
-    snprintf(sysBlockPartition, sizeof(sysBlockPartition), "/sys/class/block/%s", currentDisk->mountFrom.chars + strlen("/dev/"));
-
-    char sysBlockVolume[PATH_MAX]; // /sys/devices/pci0000:00/0000:00:14.0/usb4/4-3/4-3:1.0/host0/target0:0:0/0:0:0:0/block/sda/sda1
-    if (realpath(sysBlockPartition, sysBlockVolume) == NULL)
-        return false;
-    strcpy(strrchr(sysBlockVolume, '/') + 1, "removable");
+    // /sys/class/block/sda1 links to /sys/devices/pci0000:00/0000:00:14.0/usb4/4-3/4-3:1.0/host0/target0:0:0/0:0:0:0/block/sda/sda1
+    // `..` is resolved after following the link, so this reads removable of the whole disk without realpath.
+    // Each device is looked up once at most, later mounts of it are subvolumes
+    char sysBlockRemovable[128];
+    snprintf(sysBlockRemovable, sizeof(sysBlockRemovable), "/sys/class/block/%s/../removable", currentDisk->mountFrom.chars + strlen("/dev/"));
 
     char removableChar = '0';
-    return ffReadFileData(sysBlockVolume, 1, &removableChar) > 0 && removableChar == '1';
+    return ffReadFileData(sysBlockRemovable, 1, &removableChar) > 0 && removableChar == '1';
 }
 
-static void detectType(const FFlist* disks, FFDisk* currentDisk)
+static void detectType(FFDiskKeySet* keys, const FFlist* disks, FFDisk* currentDisk)
 {
+    bool subvolume = isSubvolume(keys, disks, currentDisk);
+
     if(ffStrbufStartsWithS(&currentDisk->mountpoint, "/boot") || ffStrbufStartsWithS(&currentDisk->mountpoint, "/efi"))
         currentDisk->type = FF_DISK_VOLUME_TYPE_HIDDEN_BIT;
-    else if(isSubvolume(disks, currentDisk))
+    else if(subvolume)
         currentDisk->type = FF_DISK_VOLUME_TYPE_SUBVOLUME_BIT;
     else if(isRemovable(currentDisk))
         currentDisk->type = FF_DISK_VOLUME_TYPE_EXTERNAL_BIT;
@@ -229,47 +315,231 @@ static void detectType(const FFlist* disks, FFDisk* currentDisk)
 
 #endif
 
-static void detectStats(FFDisk* disk)
+typedef struct FFDiskStatsJob
 {
+    const char* mountpoint;
+    double startTime; // 0 until a worker picks the job up
+    bool done;
     struct statvfs fs;
-    if(statvfs(disk->mountpoint.chars, &fs) != 0)
-        memset(&fs, 0, sizeof(struct statvfs)); //Set all values to 0, so our values get initialized to 0 too
+    uint64_t createTime;
+} FFDiskStatsJob;
+
+static void queryStats(FFDiskStatsJob* job)
+{
+    if(statvfs(job->mountpoint, &job->fs) != 0)
+        memset(&job->fs, 0, sizeof(struct statvfs)); //Set all values to 0, so our values get initialized to 0 too
 
-    disk->bytesTotal = fs.f_blocks * fs.f_frsize;
-    disk->bytesFree = fs.f_bfree * fs.f_frsize;
-    disk->bytesAvailable = fs.f_bavail * fs.f_frsize;
+    job->createTime = 0;
+    #ifdef FF_HAVE_STATX
+    struct statx stx;
+    if (statx(0, job->mountpoint, 0, STATX_BTIME, &stx) == 0 && (stx.stx_mask & STATX_BTIME))
+        job->createTime = (uint64_t)((stx.stx_btime.tv_sec * 1000) + (stx.stx_btime.tv_nsec / 1000000));
+    #endif
+}
+
+static void applyStats(FFDisk* disk, const FFDiskStatsJob* job)
+{
+    const struct statvfs* fs = &job->fs;
+    disk->bytesTotal = fs->f_blocks * fs->f_frsize;
+    disk->bytesFree = fs->f_bfree * fs->f_frsize;
+    disk->bytesAvailable = fs->f_bavail * fs->f_frsize;
     disk->bytesUsed = 0; // To be filled in ./disk.c
 
-    disk->filesTotal = (uint32_t) fs.f_files;
-    disk->filesUsed = (uint32_t) (disk->filesTotal - fs.f_ffree);
+    disk->filesTotal = (uint32_t) fs->f_files;
+    disk->filesUsed = (uint32_t) (disk->filesTotal - fs->f_ffree);
 
-    if(fs.f_flag & ST_RDONLY)
+    if(fs->f_flag & ST_RDONLY)
         disk->type |= FF_DISK_VOLUME_TYPE_READONLY_BIT;
 
-    disk->createTime = 0;
-    #ifdef FF_HAVE_STATX
-    struct statx stx;
-    if (statx(0, disk->mountpoint.chars, 0, STATX_BTIME, &stx) == 0 && (stx.stx_mask & STATX_BTIME))
-        disk->createTime = (uint64_t)((stx.stx_btime.tv_sec * 1000) + (stx.stx_btime.tv_nsec / 1000000));
-    #endif
+    disk->createTime = job->createTime;
 }
 
-const char* ffDetectDisksImpl(FFDiskOptions* options, FFlist* disks)
+static void detectStatsInline(FFDisk* disk)
+{
+    FFDiskStatsJob job = { .mountpoint = disk->mountpoint.chars };
+    queryStats(&job);
+    applyStats(disk, &job);
+}
+
+#ifdef FF_HAVE_THREADS
+
+typedef struct FFDiskStatsQueue
+{
+    FFThreadMutex mutex;
+    FFThreadCond cond; // signaled when a job is done
+    uint32_t refs; // the detecting thread and the workers. Workers may outlive the detection if they hang
+    uint32_t next;
+    uint32_t count;
+    FFDiskStatsJob jobs[];
+} FFDiskStatsQueue;
+
+// Called with the mutex locked
+static void releaseQueue(FFDiskStatsQueue* queue)
+{
+    bool last = --queue->refs == 0;
+    ffThreadMutexUnlock(&queue->mutex);
+    if (!last)
+        return;
+
+    for (uint32_t i = 0; i < queue->count; ++i)
+        free((char*) queue->jobs[i].mountpoint);
+    free(queue);
+}
+
+static void statsWorker(FFDiskStatsQueue* queue)
+{
+    ffThreadMutexLock(&queue->mutex);
+    while (queue->next < queue->count)
+    {
+        FFDiskStatsJob* job = &queue->jobs[queue->next++];
+        job->startTime = ffTimeGetTick();
+        ffThreadMutexUnlock(&queue->mutex);
+
+        queryStats(job);
+
+        ffThreadMutexLock(&queue->mutex);
+        job->done = true;
+        ffThreadCondBroadcast(&queue->cond);
+    }
+    releaseQueue(queue);
+}
+
+FF_THREAD_ENTRY_DECL_WRAPPER(statsWorker, FFDiskStatsQueue*)
+
+// Called with the mutex locked
+static bool startStatsWorker(FFDiskStatsQueue* queue)
 {
-    FILE* mountsFile = setmntent("/proc/mounts", "r");
-    if(mountsFile == NULL)
-        return "setmntent(\"/proc/mounts\", \"r\") == NULL";
+    FFThreadType thread = ffThreadCreate(statsWorkerThreadMain, queue);
+    if (!thread)
+        return false;
+    ffThreadDetach(thread);
+    ++queue->refs;
+    return true;
+}
 
-    struct mntent* device;
+// Queries the disks from `first` on in parallel. A mount that doesn't respond within FF_DISK_STATS_TIMEOUT is reported as unknown
+static void detectStats(FFlist* disks, uint32_t first)
+{
+    uint32_t count = disks->length - first;
+    if (count == 0)
+        return;
 
-    while((device = getmntent(mountsFile)))
+    FFDiskStatsQueue* queue = malloc(sizeof(*queue) + count * sizeof(FFDiskStatsJob));
+    *queue = (FFDiskStatsQueue) {
+        .mutex = FF_THREAD_MUTEX_INITIALIZER,
+        .cond = FF_THREAD_COND_INITIALIZER,
+        .refs = 1,
+        .count = count,
+    };
+    for (uint32_t i = 0; i < count; ++i)
     {
+        FFDisk* disk = FF_LIST_GET(FFDisk, *disks, first + i);
+        queue->jobs[i] = (FFDiskStatsJob) { .mountpoint = strdup(disk->mountpoint.chars) };
+    }
+
+    ffThreadMutexLock(&queue->mutex);
+    for (uint32_t i = 0; i < count && i < FF_DISK_STATS_MAX_WORKERS; ++i)
+    {
+        if (!startStatsWorker(queue))
+            break;
+    }
+
+    if (queue->refs == 1)
+    {
+        // Failed to create any thread
+        queue->next = count;
+        for (uint32_t i = 0; i < count; ++i)
+            detectStatsInline(FF_LIST_GET(FFDisk, *disks, first + i));
+        releaseQueue(queue);
+        return;
+    }
+
+    bool givenUp = false;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        FFDiskStatsJob* job = &queue->jobs[i];
+        FFDisk* disk = FF_LIST_GET(FFDisk, *disks, first + i);
+
+        // The deadline starts when a worker picks the job up. All earlier jobs are settled, so that happens soon
+        double waitStart = ffTimeGetTick();
+        while (!job->done && !givenUp)
+        {
+            double start = job->startTime > 0 ? job->startTime : waitStart;
+            double remaining = start + FF_DISK_STATS_TIMEOUT - ffTimeGetTick();
+            if (remaining <= 0)
+                break;
+            ffThreadCondTimedWait(&queue->cond, &queue->mutex, (uint32_t) remaining + 1);
+        }
+
+        if (job->done)
+            applyStats(disk, job);
+        else
+        {
+            applyStats(disk, &(FFDiskStatsJob) {});
+            // The worker hangs. Replace it, so that the remaining jobs don't wait for it
+            if (!givenUp && job->startTime > 0 && queue->next < queue->count &&
+                (queue->refs - 1 >= FF_DISK_STATS_MAX_THREADS || !startStatsWorker(queue)))
+            {
+                // Too many hanging mounts. Report the ones not done yet as unknown
+                givenUp = true;
+                queue->next = queue->count;
+            }
+        }
+    }
+
+    releaseQueue(queue);
+}
+
+#else
+
+static void detectStats(FFlist* disks, uint32_t first)
+{
+    for (uint32_t i = first; i < disks->length; ++i)
+        detectStatsInline(FF_LIST_GET(FFDisk, *disks, i));
+}
+
+#endif // FF_HAVE_THREADS
+
+const char* ffDetectDisksImpl(FFDiskOptions* options, FFlist* disks)
+{
+    // One read instead of a stdio stream. It may have tens of thousands of lines on container hosts
+    FF_STRBUF_AUTO_DESTROY mountInfo = ffStrbufCreateA(16384);
+    if (!ffAppendFileBuffer("/proc/self/mountinfo", &mountInfo))
+        return "ffAppendFileBuffer(\"/proc/self/mountinfo\") failed";
+
+    uint32_t lineCount = 0;
+    for (const char* p = mountInfo.chars; (p = strchr(p, '\n')) != NULL; ++p)
+        ++lineCount;
+
+    uint32_t capacity = 16;
+    while (capacity < lineCount * 2)
+        capacity *= 2;
+    FFDiskKeySet keys = {
+        .mountFroms = calloc(capacity, sizeof(uint32_t)),
+        .zpools = calloc(capacity, sizeof(uint32_t)),
+        .mask = capacity - 1,
+    };
+
+    uint32_t first = disks->length;
+    char* next;
+    for (char* line = mountInfo.chars; *line; line = next)
+    {
+        next = strchr(line, '\n');
+        if (next)
+            *next++ = '\0';
+        else
+            next = line + strlen(line);
+
+        FFMountInfo device;
+        if (!parseMountInfo(line, &device))
+            continue;
+
         if (__builtin_expect(options->folders.length, 0))
         {
-            if (!ffDiskMatchMountpoint(options, device->mnt_dir))
+            if (!ffDiskMatchMountpoint(options, device.mountpoint))
                 continue;
         }
-        else if(!isPhysicalDevice(device))
+        else if(!isPhysicalDevice(&device))
             continue;
 
         //We have a valid device, add it to the list
@@ -277,26 +547,27 @@ const char* ffDetectDisksImpl(FFDiskOptions* options, FFlist* disks)
         disk->type = FF_DISK_VOLUME_TYPE_NONE;
 
         //detect mountFrom
-        ffStrbufInitS(&disk->mountFrom, device->mnt_fsname);
+        ffStrbufInitS(&disk->mountFrom, device.mountFrom);
 
         //detect mountpoint
-        ffStrbufInitS(&disk->mountpoint, device->mnt_dir);
+        ffStrbufInitS(&disk->mountpoint, device.mountpoint);
 
         //detect filesystem
-        ffStrbufInitS(&disk->filesystem, device->mnt_type);
+        ffStrbufInitS(&disk->filesystem, device.filesystem);
 
         //detect name
         ffStrbufInit(&disk->name);
         detectName(disk); // Also detects external devices
 
         //detect type
-        detectType(disks, disk);
-
-        //Detects stats
-        detectStats(disk);
+        detectType(&keys, disks, disk);
     }
 
-    endmntent(mountsFile);
+    free(keys.mountFroms);
+    free(keys.zpools);
+
+    //Detects stats
+    detectStats(disks, first);
 
     return NULL;
 }
@@ -1,21 +1,139 @@
 #include "diskio.h"
 
+#include "common/cache.h"
 #include "common/time.h"
 
 const char* ffDiskIOGetIoCounters(FFlist* result, FFDiskIOOptions* options);
 
 static FFlist ioCounters1;
 static uint64_t time1;
+static FFlist ioCountersNext;
+static uint64_t timeNext;
+static FFDiskIOOptions* sampleOptions;
+static bool baselinePersisted; // ioCounters1 was stored by the previous run
+
+static void clearCounters(FFlist* counters)
+{
+    FF_LIST_FOR_EACH(FFDiskIOResult, counter, *counters)
+    {
+        ffStrbufDestroy(&counter->name);
+        ffStrbufDestroy(&counter->devPath);
+    }
+    ffListClear(counters);
+}
+
+static bool isSameDevices(const FFlist* counters1, const FFlist* counters2)
+{
+    if (counters1->length != counters2->length)
+        return false;
+    for (uint32_t i = 0; i < counters1->length; ++i)
+    {
+        const FFDiskIOResult* counter1 = FF_LIST_GET(FFDiskIOResult, *counters1, i);
+        const FFDiskIOResult* counter2 = FF_LIST_GET(FFDiskIOResult, *counters2, i);
+        if (!ffStrbufEqual(&counter1->devPath, &counter2->devPath))
+            return false;
+
+        // A device that was recreated under the same name restarts its counters
+        for (size_t off = offsetof(FFDiskIOResult, bytesRead); off < sizeof(FFDiskIOResult); off += sizeof(uint64_t))
+        {
+            if (*(const uint64_t*) ((const uint8_t*) counter2 + off) < *(const uint64_t*) ((const uint8_t*) counter1 + off))
+                return false;
+        }
+    }
+    return true;
+}
+
+static void initBaselineEntry(FFCacheEntry* cache, FFDiskIOOptions* options)
+{
+    ffCacheEntryInit(cache, "diskio");
+    ffCacheKeyAddBootId(cache);
+    ffStrbufAppend(&cache->key, &options->namePrefix);
+    ffStrbufAppendC(&cache->key, ' ');
+}
+
+static bool loadBaseline(FFDiskIOOptions* options)
+{
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    initBaselineEntry(&cache, options);
+
+    uint64_t age = ffCacheLoadBaseline(&cache);
+    uint32_t count;
+    if (age == UINT64_MAX || !ffCacheGetData(&cache, sizeof(count), &count) || count == 0)
+        return false;
+
+    ffListInitA(&ioCounters1, sizeof(FFDiskIOResult), count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        FFDiskIOResult* counter = (FFDiskIOResult*) ffListAdd(&ioCounters1);
+        *counter = (FFDiskIOResult) {};
+        ffStrbufInit(&counter->name);
+        ffStrbufInit(&counter->devPath);
+        if (!ffCacheGetStrbuf(&cache, &counter->name) || !ffCacheGetStrbuf(&cache, &counter->devPath) ||
+            !ffCacheGetData(&cache, sizeof(FFDiskIOResult) - offsetof(FFDiskIOResult, bytesRead), &counter->bytesRead))
+        {
+            clearCounters(&ioCounters1);
+            ffListDestroy(&ioCounters1);
+            return false;
+        }
+    }
+
+    time1 = ffTimeGetNow() - age;
+    baselinePersisted = true;
+    return true;
+}
+
+static void storeBaseline(FFDiskIOOptions* options)
+{
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    initBaselineEntry(&cache, options);
+    ffCacheStartBaseline(&cache);
+    ffCachePutData(&cache, sizeof(ioCounters1.length), &ioCounters1.length);
+    FF_LIST_FOR_EACH(FFDiskIOResult, counter, ioCounters1)
+    {
+        ffCachePutStrbuf(&cache, &counter->name);
+        ffCachePutStrbuf(&cache, &counter->devPath);
+        ffCachePutData(&cache, sizeof(FFDiskIOResult) - offsetof(FFDiskIOResult, bytesRead), &counter->bytesRead);
+    }
+    ffCacheStore(&cache);
+}
 
 void ffPrepareDiskIO(FFDiskIOOptions* options)
 {
-    if (options->detectTotal) return;
+    if (options->detectTotal || time1 != 0) return;
+
+    sampleOptions = options;
+
+    if (loadBaseline(options))
+        return;
 
     ffListInit(&ioCounters1, sizeof(FFDiskIOResult));
     ffDiskIOGetIoCounters(&ioCounters1, options);
     time1 = ffTimeGetNow();
 }
 
+// Called periodically by long running processes. The baseline is kept one sampling interval old
+// so that rates can be reported without waiting for a new sample
+void ffSampleDiskIO(void)
+{
+    if (!sampleOptions || time1 == 0)
+        return;
+
+    if (timeNext == 0)
+        ffListInit(&ioCountersNext, sizeof(FFDiskIOResult));
+    else
+    {
+        FFlist temp = ioCounters1;
+        ioCounters1 = ioCountersNext;
+        ioCountersNext = temp;
+        time1 = timeNext;
+        baselinePersisted = false;
+    }
+
+    clearCounters(&ioCountersNext);
+    ffDiskIOGetIoCounters(&ioCountersNext, sampleOptions);
+    timeNext = ffTimeGetNow();
+}
+
 const char* ffDetectDiskIO(FFlist* result, FFDiskIOOptions* options)
 {
     const char* error = NULL;
@@ -28,7 +146,7 @@ const char* ffDetectDiskIO(FFlist* result, FFDiskIOOptions* options)
         return NULL;
     }
 
-    if (time1 == 0)
+    if (time1 == 0 && !loadBaseline(options))
     {
         ffListInit(&ioCounters1, sizeof(FFDiskIOResult));
         error = ffDiskIOGetIoCounters(&ioCounters1, options);
@@ -40,6 +158,7 @@ const char* ffDetectDiskIO(FFlist* result, FFDiskIOOptions* options)
     if (ioCounters1.length == 0)
         return "No physical disk found";
 
+retry:;
     uint64_t time2 = ffTimeGetNow();
     while (time2 - time1 < 1000)
     {
@@ -51,6 +170,21 @@ const char* ffDetectDiskIO(FFlist* result, FFDiskIOOptions* options)
     if (error)
         return error;
 
+    if (baselinePersisted)
+    {
+        baselinePersisted = false;
+        if (!isSameDevices(&ioCounters1, result))
+        {
+            // Disks changed or restarted their counters since the previous run. Start over with the current sample
+            FFlist temp = ioCounters1;
+            ioCounters1 = *result;
+            *result = temp;
+            clearCounters(result);
+            time1 = time2;
+            goto retry;
+        }
+    }
+
     if (result->length != ioCounters1.length)
         return "Different number of physical disks. Hardware change?";
 
@@ -68,11 +202,12 @@ const char* ffDetectDiskIO(FFlist* result, FFDiskIOOptions* options)
             uint64_t* currValue = (uint64_t*) ((uint8_t*) icCurr + off);
             uint64_t temp = *currValue;
             *currValue -= *prevValue;
-            *currValue /= (time2 - time1) / 1000 /* seconds */;
+            *currValue = *currValue * 1000 / (time2 - time1) /* per second */;
             *prevValue = temp;
         }
     }
     time1 = time2;
+    storeBaseline(options);
 
     return NULL;
 }
@@ -5,100 +5,241 @@
 
 #include <ctype.h>
 #include <limits.h>
-#include <inttypes.h>
+#include <stdlib.h>
 
-const char* ffDiskIOGetIoCounters(FFlist* result, FFDiskIOOptions* options)
+typedef struct FFDiskIODevice
+{
+    FFstrbuf name; // vendor and model
+    FFstrbuf devName; // kernel name, e.g. nvme0n1
+} FFDiskIODevice;
+
+// Identities of physical block devices. Resolved once, samples only read /proc/diskstats
+static FFlist devices;
+// Lines of /proc/diskstats when `devices` was resolved. Changes when a disk or partition is added or removed
+static uint32_t devicesLineCount;
+// Other names in /proc/diskstats (partitions, virtual devices). A name in neither list may be a new disk,
+// e.g. one that replaced a removed disk with the same number of partitions
+static FFlist ignoredNames; // FFstrbuf
+static FFstrbuf diskStats;
+
+typedef struct FFDiskIOLine
+{
+    const char* devName; // points into diskStats
+    uint64_t values[7];
+} FFDiskIOLine;
+static FFlist lines; // FFDiskIOLine
+
+static void detectDeviceName(int deviceFd, const char* devName, FFstrbuf* name)
+{
+    if (ffAppendFileBufferRelative(deviceFd, "vendor", name))
+    {
+        ffStrbufTrimRightSpace(name);
+        if (name->length > 0)
+            ffStrbufAppendC(name, ' ');
+    }
+
+    ffAppendFileBufferRelative(deviceFd, "model", name);
+    ffStrbufTrimRightSpace(name);
+
+    if (name->length == 0)
+        ffStrbufSetS(name, devName);
+    else if (ffStrStartsWith(devName, "nvme"))
+    {
+        int devid, nsid;
+        if (sscanf(devName, "nvme%dn%d", &devid, &nsid) == 2)
+        {
+            bool multiNs = nsid > 1;
+            if (!multiNs)
+            {
+                char nsName[32];
+                snprintf(nsName, sizeof(nsName), "nvme%dn2", devid);
+                struct stat nsStat;
+                multiNs = fstatat(deviceFd, nsName, &nsStat, 0) == 0 && S_ISDIR(nsStat.st_mode);
+            }
+            if (multiNs)
+            {
+                // In Asahi Linux, there are multiple namespaces for the same NVMe drive.
+                ffStrbufAppendF(name, " - %d", nsid);
+            }
+        }
+    }
+}
+
+static const char* detectDevices(void)
 {
+    FF_LIST_FOR_EACH(FFDiskIODevice, device, devices)
+    {
+        ffStrbufDestroy(&device->name);
+        ffStrbufDestroy(&device->devName);
+    }
+    ffListClear(&devices);
+
     FF_AUTO_CLOSE_DIR DIR* sysBlockDirp = opendir("/sys/block/");
     if(sysBlockDirp == NULL)
         return "opendir(\"/sys/block/\") == NULL";
+    int sysBlockFd = dirfd(sysBlockDirp);
 
     struct dirent* sysBlockEntry;
-    while ((sysBlockEntry = readdir(sysBlockDirp)) != NULL)
+    while ((sysBlockEntry = ffReadDir(sysBlockDirp)) != NULL)
     {
         const char* const devName = sysBlockEntry->d_name;
 
         if (devName[0] == '.')
             continue;
 
-        char pathSysBlock[PATH_MAX];
-        snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s", devName);
-
         char pathSysDeviceReal[PATH_MAX];
-        ssize_t pathLength = readlink(pathSysBlock, pathSysDeviceReal, sizeof(pathSysDeviceReal) - 1);
-        if (pathLength < 0)
+        if (ffReadLinkRelative(sysBlockFd, devName, sizeof(pathSysDeviceReal), pathSysDeviceReal) < 0)
             continue;
-        pathSysDeviceReal[pathLength] = '\0';
 
         if (strstr(pathSysDeviceReal, "/virtual/")) // virtual device
             continue;
 
-        snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device", devName);
-        if (!ffPathExists(pathSysBlock, FF_PATHTYPE_DIRECTORY))
+        // Attributes are read relative to this, instead of resolving /sys/block/<devName>/device/... every time
+        char devicePath[NAME_MAX + sizeof("/device")];
+        snprintf(devicePath, sizeof(devicePath), "%s/device", devName);
+        int FF_AUTO_CLOSE_FD deviceFd = ffOpenDirRelative(sysBlockFd, devicePath);
+        if (deviceFd < 0)
             continue;
 
-        FFDiskIOResult* device = (FFDiskIOResult*) ffListAdd(result);
+        FFDiskIODevice* device = (FFDiskIODevice*) ffListAdd(&devices);
         ffStrbufInit(&device->name);
+        ffStrbufInitS(&device->devName, devName);
+        detectDeviceName(deviceFd, devName, &device->name);
+    }
 
-        {
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device/vendor", devName);
-            if (ffAppendFileBuffer(pathSysBlock, &device->name))
-            {
-                ffStrbufTrimRightSpace(&device->name);
-                if (device->name.length > 0)
-                    ffStrbufAppendC(&device->name, ' ');
-            }
+    return NULL;
+}
 
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device/model", devName);
-            ffAppendFileBuffer(pathSysBlock, &device->name);
-            ffStrbufTrimRightSpace(&device->name);
+// major minor name reads merged sectors ticks writes merged sectors ticks ...
+static bool parseDiskStats(char* line, const char** devName, uint64_t values[7])
+{
+    strtoul(line, &line, 10); // major
+    strtoul(line, &line, 10); // minor
+    while (*line == ' ')
+        ++line;
+
+    *devName = line;
+    line = strchr(line, ' ');
+    if (!line)
+        return false;
+    *line++ = '\0';
+
+    for (int i = 0; i < 7; ++i)
+    {
+        char* end;
+        values[i] = strtoull(line, &end, 10);
+        if (end == line)
+            return false;
+        line = end;
+    }
+    return true;
+}
 
-            if (device->name.length == 0)
-                ffStrbufSetS(&device->name, devName);
-            else if (ffStrStartsWith(devName, "nvme"))
-            {
-                int devid, nsid;
-                if (sscanf(devName, "nvme%dn%d", &devid, &nsid) == 2)
-                {
-                    bool multiNs = nsid > 1;
-                    if (!multiNs)
-                    {
-                        snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device/nvme%dn2", devName, devid);
-                        multiNs = ffPathExists(pathSysBlock, FF_PATHTYPE_DIRECTORY);
-                    }
-                    if (multiNs)
-                    {
-                        // In Asahi Linux, there are multiple namespaces for the same NVMe drive.
-                        ffStrbufAppendF(&device->name, " - %d", nsid);
-                    }
-                }
-            }
+static FFDiskIODevice* findDevice(const char* devName)
+{
+    FF_LIST_FOR_EACH(FFDiskIODevice, device, devices)
+    {
+        if (ffStrbufEqualS(&device->devName, devName))
+            return device;
+    }
+    return NULL;
+}
 
-            if (options->namePrefix.length && !ffStrbufStartsWith(&device->name, &options->namePrefix))
-            {
-                ffStrbufDestroy(&device->name);
-                result->length--;
-                continue;
-            }
+static bool isIgnored(const char* devName)
+{
+    FF_LIST_FOR_EACH(FFstrbuf, name, ignoredNames)
+    {
+        if (ffStrbufEqualS(name, devName))
+            return true;
+    }
+    return false;
+}
+
+static bool hasNewDisk(void)
+{
+    FF_LIST_FOR_EACH(FFDiskIOLine, line, lines)
+    {
+        if (findDevice(line->devName) || isIgnored(line->devName))
+            continue;
+
+        char path[NAME_MAX + sizeof("/sys/block/")];
+        snprintf(path, sizeof(path), "/sys/block/%s", line->devName);
+        if (ffPathExists(path, FF_PATHTYPE_DIRECTORY))
+            return true;
+        ffStrbufInitS((FFstrbuf*) ffListAdd(&ignoredNames), line->devName); // A new partition
+    }
+    return false;
+}
+
+const char* ffDiskIOGetIoCounters(FFlist* result, FFDiskIOOptions* options)
+{
+    // The only syscalls of a sample once the devices are known
+    ffStrbufClear(&diskStats);
+    if (!ffAppendFileBuffer("/proc/diskstats", &diskStats))
+        return "ffAppendFileBuffer(\"/proc/diskstats\") failed";
+
+    if (lines.elementSize == 0)
+        ffListInit(&lines, sizeof(FFDiskIOLine));
+    ffListClear(&lines);
+
+    uint32_t lineCount = 0;
+    char* next;
+    for (char* line = diskStats.chars; *line; line = next)
+    {
+        next = strchr(line, '\n');
+        if (next)
+        {
+            *next++ = '\0';
+            ++lineCount;
         }
+        else
+            next = line + strlen(line);
+
+        FFDiskIOLine* item = (FFDiskIOLine*) ffListAdd(&lines);
+        if (!parseDiskStats(line, &item->devName, item->values))
+            --lines.length;
+    }
 
-        // I/Os merges sectors ticks ...
-        uint64_t nRead, sectorRead, nWritten, sectorWritten;
+    if (devices.elementSize == 0 || lineCount != devicesLineCount || hasNewDisk())
+    {
+        if (devices.elementSize == 0)
+        {
+            ffListInit(&devices, sizeof(FFDiskIODevice));
+            ffListInit(&ignoredNames, sizeof(FFstrbuf));
+        }
+        const char* error = detectDevices();
+        if (error)
+            return error;
+        devicesLineCount = lineCount;
+
+        FF_LIST_FOR_EACH(FFstrbuf, name, ignoredNames)
+            ffStrbufDestroy(name);
+        ffListClear(&ignoredNames);
+        FF_LIST_FOR_EACH(FFDiskIOLine, line, lines)
         {
-            char sysBlockStat[PROC_FILE_BUFFSIZ];
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/stat", devName);
-            ssize_t fileSize = ffReadFileData(pathSysBlock, sizeof(sysBlockStat) - 1, sysBlockStat);
-            if (fileSize <= 0) continue;
-            sysBlockStat[fileSize] = '\0';
-            if (sscanf(sysBlockStat, "%" PRIu64 "%*u%" PRIu64 "%*u%" PRIu64 "%*u%" PRIu64 "%*u", &nRead, &sectorRead, &nWritten, &sectorWritten) <= 0)
-                continue;
+            if (!findDevice(line->devName))
+                ffStrbufInitS((FFstrbuf*) ffListAdd(&ignoredNames), line->devName);
         }
+    }
+
+    FF_LIST_FOR_EACH(FFDiskIOLine, line, lines)
+    {
+        const char* devName = line->devName;
+        const uint64_t* values = line->values;
+        FFDiskIODevice* device = findDevice(devName);
+        if (!device)
+            continue; // partition or virtual device
+
+        if (options->namePrefix.length && !ffStrbufStartsWith(&device->name, &options->namePrefix))
+            continue;
 
-        ffStrbufInitF(&device->devPath, "/dev/%s", devName);
-        device->bytesRead = sectorRead * 512;
-        device->bytesWritten = sectorWritten * 512;
-        device->readCount = nRead;
-        device->writeCount = nWritten;
+        FFDiskIOResult* counter = (FFDiskIOResult*) ffListAdd(result);
+        ffStrbufInitCopy(&counter->name, &device->name);
+        ffStrbufInitF(&counter->devPath, "/dev/%s", devName);
+        counter->readCount = values[0];
+        counter->bytesRead = values[2] * 512;
+        counter->writeCount = values[4];
+        counter->bytesWritten = values[6] * 512;
     }
 
     return NULL;
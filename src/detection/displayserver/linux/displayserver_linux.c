@@ -116,7 +116,7 @@ bool ffdsMatchDrmConnector(const char* connName, FFstrbuf* edidName)
         return false;
 
     struct dirent* entry;
-    while((entry = readdir(dirp)) != NULL)
+    while((entry = ffReadDir(dirp)) != NULL)
     {
         const char* plainName = entry->d_name;
         if (ffStrStartsWith(plainName, "card"))
@@ -20,7 +20,7 @@ static const char* drmParseSysfs(FFDisplayServerResult* result)
     uint32_t drmDirLength = drmDir.length;
 
     struct dirent* entry;
-    while((entry = readdir(dirp)) != NULL)
+    while((entry = ffReadDir(dirp)) != NULL)
     {
         if(ffStrEquals(entry->d_name, ".") || ffStrEquals(entry->d_name, ".."))
             continue;
@@ -168,7 +168,7 @@ static const char* drmGetNameByConnId(uint32_t connId, FFstrbuf* name)
     uint32_t drmDirLength = drmDir.length;
 
     struct dirent* entry;
-    while((entry = readdir(dirp)) != NULL)
+    while((entry = ffReadDir(dirp)) != NULL)
     {
         if(ffStrEquals(entry->d_name, ".") || ffStrEquals(entry->d_name, ".."))
             continue;
@@ -14,6 +14,8 @@
     #include <sys/user.h>
 #elif defined(__sun)
     #include <procfs.h>
+#else
+    #include "common/procsnapshot.h"
 #endif
 
 static const char* parseEnv(void)
@@ -280,7 +282,7 @@ static const char* getFromProcesses(FFDisplayServerResult* result)
     uint32_t procPathLength = procPath.length;
 
     struct dirent* dirent;
-    while((dirent = readdir(procdir)) != NULL)
+    while((dirent = ffReadDir(procdir)) != NULL)
     {
         if (!ffCharIsDigit(dirent->d_name[0]))
             continue;
@@ -306,48 +308,26 @@ static const char* getFromProcesses(FFDisplayServerResult* result)
         }
     }
 #else
-    FF_AUTO_CLOSE_DIR DIR* procdir = opendir("/proc");
-    if(procdir == NULL)
-        return "opendir(\"/proc\") failed";
-
-    FF_STRBUF_AUTO_DESTROY procPath = ffStrbufCreateA(64);
-    ffStrbufAppendS(&procPath, "/proc/");
+    // Shared with the Processes module
+    FFlist* snapshot = ffProcSnapshotGet();
+    if(snapshot == NULL)
+        return "open(\"/proc\") failed";
 
-    uint32_t procPathLength = procPath.length;
-
-    FF_STRBUF_AUTO_DESTROY loginuid = ffStrbufCreate();
     FF_STRBUF_AUTO_DESTROY processName = ffStrbufCreateA(256); //Some processes have large command lines (looking at you chrome)
 
-    struct dirent* dirent;
-    while((dirent = readdir(procdir)) != NULL)
+    FF_LIST_FOR_EACH(FFProcEntry, entry, *snapshot)
     {
-        //Match only folders starting with a number (the pid folders)
-        if(dirent->d_type != DT_DIR || !ffCharIsDigit(dirent->d_name[0]))
-            continue;
-
-        ffStrbufAppendS(&procPath, dirent->d_name);
-        uint32_t procFolderPathLength = procPath.length;
-
         //Don't check for processes not owend by the current user.
-        ffStrbufAppendS(&procPath, "/loginuid");
-        ffReadFileBuffer(procPath.chars, &loginuid);
-        if(ffStrbufToUInt(&loginuid, (uint64_t) -1) != userId)
-        {
-            ffStrbufSubstrBefore(&procPath, procPathLength);
+        if(!ffProcSnapshotLoad(entry, FF_PROC_FIELD_UID) || entry->loginuid != userId)
             continue;
-        }
-
-        ffStrbufSubstrBefore(&procPath, procFolderPathLength);
 
         //We check the cmdline for the process name, because it is not trimmed.
-        ffStrbufAppendS(&procPath, "/cmdline");
-        ffReadFileBuffer(procPath.chars, &processName);
+        if(!ffProcSnapshotLoad(entry, FF_PROC_FIELD_CMDLINE))
+            continue;
+        ffStrbufSet(&processName, &entry->argv0);
         ffStrbufTrimRightSpace(&processName);
-        ffStrbufSubstrBeforeFirstC(&processName, '\0'); //Trim the arguments
         ffStrbufSubstrAfterLastC(&processName, '/');
 
-        ffStrbufSubstrBefore(&procPath, procPathLength);
-
         if(result->dePrettyName.length == 0)
             applyPrettyNameIfDE(result, processName.chars);
 
@@ -31,12 +31,11 @@ const char* ffDetectEditor(FFEditorResult* result)
     #ifndef _WIN32
     if (result->name.chars[0] != '/')
     {
-        if (ffProcessAppendStdOut(&result->path, (char* const[]){
-            FASTFETCH_TARGET_DIR_USR "/bin/which",
-            result->name.chars,
-            NULL,
-        }) != NULL || result->path.length == 0)
+        if (!ffProcessFindExecutable(result->name.chars, &result->path))
+        {
+            ffStrbufClear(&result->path);
             return NULL;
+        }
     }
     #else
     if (!(result->name.length > 3 && ffCharIsEnglishAlphabet(result->name.chars[0]) && result->name.chars[1] == ':' && result->name.chars[2] == '\\'))
@@ -104,7 +103,7 @@ const char* ffDetectEditor(FFEditorResult* result)
     ) param = "-h";
     else return NULL;
 
-    ffProcessAppendStdOut(&result->version, (char* const[]){
+    ffProcessAppendStdOutCached(&result->version, (char* const[]){
         result->path.chars,
         (char*) param,
         NULL,
@@ -21,7 +21,7 @@ static void detectGamepad(FFlist* devices, FFstrbuf* name, FFstrbuf* path)
     if (dirp)
     {
         struct dirent* entry;
-        while ((entry = readdir(dirp)) != NULL)
+        while ((entry = ffReadDir(dirp)) != NULL)
         {
             if (entry->d_name[0] == '.' || (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN))
                 continue;
@@ -64,7 +64,7 @@ const char* ffDetectGamepad(FFlist* devices /* List of FFGamepadDevice */)
     uint32_t baseLen = path.length;
 
     struct dirent* entry;
-    while ((entry = readdir(dirp)) != NULL)
+    while ((entry = ffReadDir(dirp)) != NULL)
     {
         if (!ffStrStartsWith(entry->d_name, "js"))
             continue;
@@ -2,6 +2,7 @@
 #include "detection/vulkan/vulkan.h"
 #include "detection/opencl/opencl.h"
 #include "detection/opengl/opengl.h"
+#include "common/scheduler.h"
 
 const char* FF_GPU_VENDOR_NAME_APPLE = "Apple";
 const char* FF_GPU_VENDOR_NAME_AMD = "AMD";
@@ -86,8 +87,43 @@ const char* detectByOpenGL(FFlist* gpus)
     return error;
 }
 
+static struct {
+    FFSchedulerTask task;
+    FFGPUOptions options;
+    FFlist gpus;
+    const char* error;
+} prefetch;
+
+static void prefetchGPUImpl(FF_MAYBE_UNUSED void* data)
+{
+    prefetch.error = ffDetectGPUImpl(&prefetch.options, &prefetch.gpus);
+}
+
+void ffPrepareGPU(const FFGPUOptions* options)
+{
+    // Only the native detection is done ahead of time.
+    // Vulkan / OpenCL / OpenGL fallbacks share global states with other modules and are done in place
+    if (prefetch.task.func || options->detectionMethod > FF_GPU_DETECTION_METHOD_PCI)
+        return;
+
+    prefetch.options = *options;
+    ffListInit(&prefetch.gpus, sizeof(FFGPUResult));
+    ffSchedulerSubmit(&prefetch.task, "GPU", prefetchGPUImpl, NULL);
+}
+
 const char* ffDetectGPU(const FFGPUOptions* options, FFlist* result)
 {
+    if (ffSchedulerWait(&prefetch.task))
+    {
+        if (!prefetch.error && prefetch.gpus.length > 0)
+        {
+            ffListDestroy(result);
+            ffListInitMove(result, &prefetch.gpus);
+            return NULL;
+        }
+        ffListDestroy(&prefetch.gpus);
+    }
+
     if (options->detectionMethod <= FF_GPU_DETECTION_METHOD_PCI)
     {
         const char* error = ffDetectGPUImpl(options, result);
@@ -41,6 +41,7 @@ typedef struct FFGPUResult
     uint64_t deviceId; // Used internally, may be uninitialized
 } FFGPUResult;
 
+void ffPrepareGPU(const FFGPUOptions* options);
 const char* ffDetectGPU(const FFGPUOptions* options, FFlist* result);
 const char* ffDetectGPUImpl(const FFGPUOptions* options, FFlist* gpus);
 
@@ -48,4 +49,9 @@ const char* ffGetGPUVendorString(unsigned vendorId);
 
 #if defined(__linux__) || defined(__FreeBSD__) || defined(__sun)
 void ffGPUParsePciIds(FFstrbuf* content, uint8_t subclass, uint16_t vendor, uint16_t device, FFGPUResult* gpu, FFstrbuf* coreName);
+// Maps the pci.ids file at `path` and loads its vendor / device index from the cache, building it if the file changed.
+// Only the first successful call has an effect
+bool ffGPULoadPciIds(const char* path);
+// Like ffGPUParsePciIds, using the file loaded by ffGPULoadPciIds
+void ffGPUFindPciIds(uint8_t subclass, uint16_t vendor, uint16_t device, FFGPUResult* gpu, FFstrbuf* coreName);
 #endif
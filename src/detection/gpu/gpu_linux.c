@@ -94,12 +94,10 @@
 #define FF_STR_INDIR(x) #x
 #define FF_STR(x) FF_STR_INDIR(x)
 
-static bool pciDetectDriver(FFGPUResult* gpu, FFstrbuf* pciDir, FFstrbuf* buffer, FF_MAYBE_UNUSED const char* drmKey)
+static bool pciDetectDriver(FFGPUResult* gpu, int deviceFd, FFstrbuf* buffer, FF_MAYBE_UNUSED const char* drmKey)
 {
-    uint32_t pciDirLength = pciDir->length;
-    ffStrbufAppendS(pciDir, "/driver");
     char pathBuf[PATH_MAX];
-    ssize_t resultLength = readlink(pciDir->chars, pathBuf, sizeof(pathBuf));
+    ssize_t resultLength = ffReadLinkRelative(deviceFd, "driver", sizeof(pathBuf), pathBuf);
     if(resultLength <= 0) return false;
 
     const char* slash = memrchr(pathBuf, '/', (size_t) resultLength);
@@ -122,51 +120,36 @@ static bool pciDetectDriver(FFGPUResult* gpu, FFstrbuf* pciDir, FFstrbuf* buffer
 
     if (instance.config.general.detectVersion)
     {
-        ffStrbufAppendS(pciDir, "/module/version");
-        if (ffReadFileBuffer(pciDir->chars, buffer))
+        if (ffReadFileBufferRelative(deviceFd, "driver/module/version", buffer) ||
+            (ffStrbufEqualS(&gpu->driver, "zx") && ffReadFileBufferRelative(deviceFd, "zx_info/driver_version", buffer)))
         {
             ffStrbufTrimRightSpace(buffer);
             ffStrbufAppendC(&gpu->driver, ' ');
             ffStrbufAppend(&gpu->driver, buffer);
         }
-        else if (ffStrbufEqualS(&gpu->driver, "zx"))
-        {
-            ffStrbufSubstrBefore(pciDir, pciDirLength);
-            ffStrbufAppendS(pciDir, "/zx_info/driver_version");
-            if (ffReadFileBuffer(pciDir->chars, buffer))
-            {
-                ffStrbufTrimRightSpace(buffer);
-                ffStrbufAppendC(&gpu->driver, ' ');
-                ffStrbufAppend(&gpu->driver, buffer);
-            }
-        }
     }
 
     return true;
 }
 
-static void pciDetectAmdSpecific(const FFGPUOptions* options, FFGPUResult* gpu, FFstrbuf* pciDir, FFstrbuf* buffer)
+static void pciDetectAmdSpecific(const FFGPUOptions* options, FFGPUResult* gpu, int deviceFd)
 {
     // https://www.kernel.org/doc/html/v5.10/gpu/amdgpu.html#mem-info-vis-vram-total
-    const uint32_t pciDirLen = pciDir->length;
-
-    ffStrbufAppendS(pciDir, "/hwmon/");
-    FF_AUTO_CLOSE_DIR DIR* dirp = opendir(pciDir->chars);
+    FF_AUTO_CLOSE_DIR DIR* dirp = fdopendir(ffOpenDirRelative(deviceFd, "hwmon"));
     if (!dirp) return;
 
     struct dirent* entry;
-    while ((entry = readdir(dirp)) != NULL)
+    while ((entry = ffReadDir(dirp)) != NULL)
     {
         if (entry->d_name[0] == '.') continue;
         break;
     }
     if (!entry) return;
-    ffStrbufAppendS(pciDir, entry->d_name);
-    ffStrbufAppendC(pciDir, '/');
+    int FF_AUTO_CLOSE_FD hwmonFd = ffOpenDirRelative(dirfd(dirp), entry->d_name);
+    if (hwmonFd < 0) return;
 
-    const uint32_t hwmonLen = pciDir->length;
-    ffStrbufAppendS(pciDir, "in1_input"); // Northbridge voltage in millivolts (APUs only)
-    if (ffPathExists(pciDir->chars, FF_PATHTYPE_ANY))
+    // Northbridge voltage in millivolts (APUs only)
+    if (faccessat(hwmonFd, "in1_input", F_OK, 0) == 0)
         gpu->type = FF_GPU_TYPE_INTEGRATED;
     else
         gpu->type = FF_GPU_TYPE_DISCRETE;
@@ -174,21 +157,16 @@ static void pciDetectAmdSpecific(const FFGPUOptions* options, FFGPUResult* gpu,
     uint64_t value = 0;
     if (options->temp)
     {
-        ffStrbufSubstrBefore(pciDir, hwmonLen);
-        ffStrbufAppendS(pciDir, "temp1_input"); // The on die GPU temperature in millidegrees Celsius
-        if (ffReadFileBuffer(pciDir->chars, buffer) && (value = ffStrbufToUInt(buffer, 0)))
+        // The on die GPU temperature in millidegrees Celsius
+        if (ffReadFileUInt64Relative(hwmonFd, "temp1_input", &value) && value)
             gpu->temperature = (double) value / 1000;
     }
 
     if (options->driverSpecific)
     {
-        ffStrbufSubstrBefore(pciDir, pciDirLen);
-        ffStrbufAppendS(pciDir, "/mem_info_vis_vram_total");
-        if (ffReadFileBuffer(pciDir->chars, buffer) && (value = ffStrbufToUInt(buffer, 0)))
+        if (ffReadFileUInt64Relative(deviceFd, "mem_info_vis_vram_total", &value) && value)
         {
-            ffStrbufSubstrBefore(pciDir, pciDir->length - (uint32_t) strlen("/mem_info_vis_vram_total"));
-            ffStrbufAppendS(pciDir, "/mem_info_vis_vram_used");
-            if (ffReadFileBuffer(pciDir->chars, buffer) && (value = ffStrbufToUInt(buffer, 0)))
+            if (ffReadFileUInt64Relative(deviceFd, "mem_info_vis_vram_used", &value) && value)
             {
                 if (gpu->type == FF_GPU_TYPE_DISCRETE)
                     gpu->dedicated.used = value;
@@ -199,7 +177,7 @@ static void pciDetectAmdSpecific(const FFGPUOptions* options, FFGPUResult* gpu,
     }
 }
 
-static void pciDetectIntelSpecific(FFGPUResult* gpu, FFstrbuf* pciDir, FFstrbuf* buffer, const FFstrbuf* coreName)
+static void pciDetectIntelSpecific(FFGPUResult* gpu, int deviceFd, const FFstrbuf* coreName)
 {
     // Works for Intel GPUs
     // https://patchwork.kernel.org/project/intel-gfx/patch/1422039866-11572-3-git-send-email-ville.syrjala@linux.intel.com/
@@ -211,54 +189,46 @@ static void pciDetectIntelSpecific(FFGPUResult* gpu, FFstrbuf* pciDir, FFstrbuf*
     else
         gpu->type = FF_GPU_TYPE_INTEGRATED;
 
+    uint64_t value;
     if (ffStrbufEqualS(&gpu->driver, "xe"))
     {
-        ffStrbufAppendS(pciDir, "/tile0/gt0/freq0/max_freq");
+        if (ffReadFileUInt64Relative(deviceFd, "tile0/gt0/freq0/max_freq", &value))
+            gpu->frequency = (uint32_t) value;
     }
     else
     {
-        ffStrbufAppendS(pciDir, "/drm/");
-        FF_AUTO_CLOSE_DIR DIR* dirp = opendir(pciDir->chars);
+        FF_AUTO_CLOSE_DIR DIR* dirp = fdopendir(ffOpenDirRelative(deviceFd, "drm"));
         if (!dirp) return;
         struct dirent* entry;
-        while ((entry = readdir(dirp)) != NULL)
+        while ((entry = ffReadDir(dirp)) != NULL)
         {
             if (ffStrStartsWith(entry->d_name, "card")) break;
         }
         if (!entry) return;
-        ffStrbufAppendS(pciDir, entry->d_name);
-        ffStrbufAppendS(pciDir, "/gt_max_freq_mhz");
+        int FF_AUTO_CLOSE_FD cardFd = ffOpenDirRelative(dirfd(dirp), entry->d_name);
+        if (cardFd >= 0 && ffReadFileUInt64Relative(cardFd, "gt_max_freq_mhz", &value))
+            gpu->frequency = (uint32_t) value;
     }
-    if (ffReadFileBuffer(pciDir->chars, buffer))
-        gpu->frequency = (uint32_t) ffStrbufToUInt(buffer, 0);
 }
 
-static bool loadPciIds(FFstrbuf* pciids)
+static bool loadPciIds(void)
 {
     #ifdef FF_CUSTOM_PCI_IDS_PATH
 
-    ffReadFileBuffer(FF_STR(FF_CUSTOM_PCI_IDS_PATH), pciids);
-    if (pciids->length > 0) return true;
+    return ffGPULoadPciIds(FF_STR(FF_CUSTOM_PCI_IDS_PATH));
 
     #else
 
-    ffReadFileBuffer(FASTFETCH_TARGET_DIR_USR "/share/hwdata/pci.ids", pciids);
-    if (pciids->length > 0) return true;
-
-    ffReadFileBuffer(FASTFETCH_TARGET_DIR_USR "/share/misc/pci.ids", pciids); // debian?
-    if (pciids->length > 0) return true;
-
-    ffReadFileBuffer(FASTFETCH_TARGET_DIR_USR "/local/share/hwdata/pci.ids", pciids);
-    if (pciids->length > 0) return true;
+    return ffGPULoadPciIds(FASTFETCH_TARGET_DIR_USR "/share/hwdata/pci.ids") ||
+        ffGPULoadPciIds(FASTFETCH_TARGET_DIR_USR "/share/misc/pci.ids") || // debian?
+        ffGPULoadPciIds(FASTFETCH_TARGET_DIR_USR "/local/share/hwdata/pci.ids");
 
     #endif
-
-    return false;
 }
 
-static const char* detectPci(const FFGPUOptions* options, FFlist* gpus, FFstrbuf* buffer, FFstrbuf* deviceDir, const char* drmKey)
+// `pciPath` is the name of the PCI device directory, or a path that ends with it
+static const char* detectPci(const FFGPUOptions* options, FFlist* gpus, FFstrbuf* buffer, int deviceFd, const char* pciPath, const char* drmKey)
 {
-    const uint32_t drmDirPathLength = deviceDir->length;
     uint32_t vendorId, deviceId, subVendorId, subDeviceId;
     uint8_t classId, subclassId;
     if (sscanf(buffer->chars + strlen("pci:"), "v%8" SCNx32 "d%8" SCNx32 "sv%8" SCNx32 "sd%8" SCNx32 "bc%2" SCNx8 "sc%2" SCNx8, &vendorId, &deviceId, &subVendorId, &subDeviceId, &classId, &subclassId) != 6)
@@ -267,24 +237,11 @@ static const char* detectPci(const FFGPUOptions* options, FFlist* gpus, FFstrbuf
     if (classId != 0x03 /*PCI_BASE_CLASS_DISPLAY*/)
         return "Not a GPU device";
 
-    char pciPath[PATH_MAX];
-    const char* pPciPath = NULL;
-    if (drmKey)
-    {
-        ssize_t pathLength = readlink(deviceDir->chars, pciPath, sizeof(pciPath) - 1);
-        if (pathLength <= 0)
-            return "Unable to get PCI device path";
-        pciPath[pathLength] = '\0';
-        pPciPath = strrchr(pciPath, '/');
-        if (__builtin_expect(pPciPath != NULL, true))
-            pPciPath++;
-        else
-            pPciPath = pciPath;
-    }
+    const char* pPciPath = strrchr(pciPath, '/');
+    if (pPciPath)
+        pPciPath++;
     else
-    {
-        pPciPath = memrchr(deviceDir->chars, '/', deviceDir->length) + 1;
-    }
+        pPciPath = pciPath;
 
     uint32_t pciDomain, pciBus, pciDevice, pciFunc;
     if (sscanf(pPciPath, "%" SCNx32 ":%" SCNx32 ":%" SCNx32 ".%" SCNx32, &pciDomain, &pciBus, &pciDevice, &pciFunc) != 4)
@@ -307,8 +264,7 @@ static const char* detectPci(const FFGPUOptions* options, FFlist* gpus, FFstrbuf
 
     if (gpu->vendor.chars == FF_GPU_VENDOR_NAME_AMD)
     {
-        ffStrbufAppendS(deviceDir, "/revision");
-        if (ffReadFileBuffer(deviceDir->chars, buffer))
+        if (ffReadFileBufferRelative(deviceFd, "revision", buffer))
         {
             char* pend;
             uint64_t revision = strtoul(buffer->chars, &pend, 16);
@@ -323,34 +279,26 @@ static const char* detectPci(const FFGPUOptions* options, FFlist* gpus, FFstrbuf
                 #endif
             }
         }
-        ffStrbufSubstrBefore(deviceDir, drmDirPathLength);
     }
 
     FF_STRBUF_AUTO_DESTROY coreName = ffStrbufCreate();
     if (gpu->name.length == 0)
     {
-        static FFstrbuf pciids;
-        if (pciids.chars == NULL)
+        static bool pciidsLoaded;
+        if (!pciidsLoaded)
         {
-            ffStrbufInit(&pciids);
-            loadPciIds(&pciids);
+            pciidsLoaded = true;
+            loadPciIds();
         }
-        ffGPUParsePciIds(&pciids, subclassId, (uint16_t) vendorId, (uint16_t) deviceId, gpu, &coreName);
+        ffGPUFindPciIds(subclassId, (uint16_t) vendorId, (uint16_t) deviceId, gpu, &coreName);
     }
 
-    pciDetectDriver(gpu, deviceDir, buffer, drmKey);
-    ffStrbufSubstrBefore(deviceDir, drmDirPathLength);
+    pciDetectDriver(gpu, deviceFd, buffer, drmKey);
 
     if (gpu->vendor.chars == FF_GPU_VENDOR_NAME_AMD)
-    {
-        pciDetectAmdSpecific(options, gpu, deviceDir, buffer);
-        ffStrbufSubstrBefore(deviceDir, drmDirPathLength);
-    }
+        pciDetectAmdSpecific(options, gpu, deviceFd);
     else if (gpu->vendor.chars == FF_GPU_VENDOR_NAME_INTEL)
-    {
-        pciDetectIntelSpecific(gpu, deviceDir, buffer, &coreName);
-        ffStrbufSubstrBefore(deviceDir, drmDirPathLength);
-    }
+        pciDetectIntelSpecific(gpu, deviceFd, &coreName);
     else
     {
         __typeof__(&ffDetectNvidiaGpuInfo) detectFn;
@@ -398,7 +346,7 @@ static const char* detectPci(const FFGPUOptions* options, FFlist* gpus, FFstrbuf
 
 #if __aarch64__
 
-FF_MAYBE_UNUSED static const char* detectAsahi(FFlist* gpus, FFstrbuf* buffer, FFstrbuf* drmDir, const char* drmKey)
+FF_MAYBE_UNUSED static const char* detectAsahi(FFlist* gpus, FFstrbuf* buffer, int deviceFd, const char* drmKey)
 {
     uint32_t index = ffStrbufFirstIndexS(buffer, "apple,agx-t");
     if (index == buffer->length) return "display-subsystem?";
@@ -417,7 +365,7 @@ FF_MAYBE_UNUSED static const char* detectAsahi(FFlist* gpus, FFstrbuf* buffer, F
     gpu->dedicated.total = gpu->dedicated.used = gpu->shared.total = gpu->shared.used = FF_GPU_VMEM_SIZE_UNSET;
     gpu->frequency = FF_GPU_FREQUENCY_UNSET;
 
-    pciDetectDriver(gpu, drmDir, buffer, drmKey);
+    pciDetectDriver(gpu, deviceFd, buffer, drmKey);
 
     #if FF_HAVE_DRM
     ffStrbufSetS(buffer, "/dev/dri/");
@@ -450,38 +398,39 @@ FF_MAYBE_UNUSED static const char* detectAsahi(FFlist* gpus, FFstrbuf* buffer, F
 
 static const char* drmDetectGPUs(const FFGPUOptions* options, FFlist* gpus)
 {
-    FF_STRBUF_AUTO_DESTROY drmDir = ffStrbufCreateA(64);
-    ffStrbufAppendS(&drmDir, "/sys/class/drm/");
-    const uint32_t drmDirLength = drmDir.length;
-
-    FF_AUTO_CLOSE_DIR DIR* dir = opendir(drmDir.chars);
+    FF_AUTO_CLOSE_DIR DIR* dir = opendir("/sys/class/drm/");
     if(dir == NULL)
         return "Failed to open `/sys/class/drm/`";
 
     FF_STRBUF_AUTO_DESTROY buffer = ffStrbufCreate();
 
     struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL)
+    while ((entry = ffReadDir(dir)) != NULL)
     {
         if (!ffStrStartsWith(entry->d_name, "card") ||
             strchr(entry->d_name + 4, '-') != NULL)
             continue;
 
-        ffStrbufAppendS(&drmDir, entry->d_name);
+        int FF_AUTO_CLOSE_FD cardFd = ffOpenDirRelative(dirfd(dir), entry->d_name);
+        if (cardFd < 0)
+            continue;
+        int FF_AUTO_CLOSE_FD deviceFd = ffOpenDirRelative(cardFd, "device");
+        if (deviceFd < 0)
+            continue;
 
-        ffStrbufAppendS(&drmDir, "/device/modalias");
-        if (!ffReadFileBuffer(drmDir.chars, &buffer))
+        if (!ffReadFileBufferRelative(deviceFd, "modalias", &buffer))
             continue;
-        ffStrbufSubstrBefore(&drmDir, drmDir.length - (uint32_t) strlen("/modalias"));
 
         if (ffStrbufStartsWithS(&buffer, "pci:"))
-            detectPci(options, gpus, &buffer, &drmDir, entry->d_name);
+        {
+            char pciPath[PATH_MAX];
+            if (ffReadLinkRelative(cardFd, "device", sizeof(pciPath), pciPath) > 0)
+                detectPci(options, gpus, &buffer, deviceFd, pciPath, entry->d_name);
+        }
         #ifdef __aarch64__
         else if (ffStrbufStartsWithS(&buffer, "of:"))
-            detectAsahi(gpus, &buffer, &drmDir, entry->d_name);
+            detectAsahi(gpus, &buffer, deviceFd, entry->d_name);
         #endif
-
-        ffStrbufSubstrBefore(&drmDir, drmDirLength);
     }
 
     return NULL;
@@ -491,37 +440,27 @@ static const char* drmDetectGPUs(const FFGPUOptions* options, FFlist* gpus)
 static const char* pciDetectGPUs(const FFGPUOptions* options, FFlist* gpus)
 {
     //https://www.kernel.org/doc/Documentation/ABI/testing/sysfs-bus-pci
-    const char* pciDirPath = "/sys/bus/pci/devices/";
-
-    FF_AUTO_CLOSE_DIR DIR* dirp = opendir(pciDirPath);
+    FF_AUTO_CLOSE_DIR DIR* dirp = opendir("/sys/bus/pci/devices/");
     if(dirp == NULL)
         return "Failed to open `/sys/bus/pci/devices/`";
 
-    FF_STRBUF_AUTO_DESTROY pciDir = ffStrbufCreateA(64);
-    ffStrbufAppendS(&pciDir, pciDirPath);
-
-    const uint32_t pciBaseDirLength = pciDir.length;
-
     FF_STRBUF_AUTO_DESTROY buffer = ffStrbufCreate();
 
     struct dirent* entry;
-    while((entry = readdir(dirp)) != NULL)
+    while((entry = ffReadDir(dirp)) != NULL)
     {
         if(entry->d_name[0] == '.')
             continue;
 
-        ffStrbufSubstrBefore(&pciDir, pciBaseDirLength);
-        ffStrbufAppendS(&pciDir, entry->d_name);
-        const uint32_t pciDevDirLength = pciDir.length;
+        int FF_AUTO_CLOSE_FD deviceFd = ffOpenDirRelative(dirfd(dirp), entry->d_name);
+        if (deviceFd < 0)
+            continue;
 
-        ffStrbufAppendS(&pciDir, "/modalias");
-        if (!ffReadFileBuffer(pciDir.chars, &buffer))
+        if (!ffReadFileBufferRelative(deviceFd, "modalias", &buffer))
             continue;
-        ffStrbufSubstrBefore(&pciDir, pciDevDirLength);
         assert(ffStrbufStartsWithS(&buffer, "pci:"));
 
-        detectPci(options, gpus, &buffer, &pciDir, NULL);
-        ffStrbufSubstrBefore(&pciDir, pciBaseDirLength);
+        detectPci(options, gpus, &buffer, deviceFd, entry->d_name, NULL);
     }
 
     return NULL;
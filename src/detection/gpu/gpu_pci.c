@@ -1,4 +1,44 @@
 #include "gpu.h"
+#include "common/cache.h"
+#include "common/io/io.h"
+
+#include <sys/mman.h>
+
+// `start` and `end` delimit the device name in a line of pci.ids, e.g. `Navi 31 [Radeon RX 7900 XT/7900 XTX/7900M]`
+static void setDeviceName(const char* start, const char* end, FFGPUResult* gpu, FFstrbuf* coreName)
+{
+    const char* closingBracket = end - 1;
+    if (*closingBracket == ']')
+    {
+        const char* openingBracket = memrchr(start, '[', (size_t) (closingBracket - start));
+        if (openingBracket)
+        {
+            openingBracket++;
+            ffStrbufSetNS(&gpu->name, (uint32_t) (closingBracket - openingBracket), openingBracket);
+            if (coreName)
+            {
+                ffStrbufSetNS(coreName, (uint32_t) (openingBracket - start) - 1, start);
+                ffStrbufTrimRight(coreName, ' ');
+            }
+        }
+    }
+    if (!gpu->name.length)
+        ffStrbufSetNS(&gpu->name, (uint32_t) (end - start), start);
+}
+
+static void setFallbackName(uint8_t subclass, uint16_t device, FFGPUResult* gpu)
+{
+    const char* subclassStr;
+    switch (subclass)
+    {
+    case 0 /*PCI_CLASS_DISPLAY_VGA*/: subclassStr = " (VGA compatible)"; break;
+    case 1 /*PCI_CLASS_DISPLAY_XGA*/: subclassStr = " (XGA compatible)"; break;
+    case 2 /*PCI_CLASS_DISPLAY_3D*/: subclassStr = " (3D)"; break;
+    default: subclassStr = ""; break;
+    }
+
+    ffStrbufSetF(&gpu->name, "%s Device %04X%s", gpu->vendor.length ? gpu->vendor.chars : "Unknown", device, subclassStr);
+}
 
 void ffGPUParsePciIds(FFstrbuf* content, uint8_t subclass, uint16_t vendor, uint16_t device, FFGPUResult* gpu, FFstrbuf* coreName)
 {
@@ -44,38 +84,228 @@ void ffGPUParsePciIds(FFstrbuf* content, uint8_t subclass, uint16_t vendor, uint
                 if (!end)
                     end = content->chars + content->length;
 
-                char* closingBracket = end - 1;
-                if (*closingBracket == ']')
-                {
-                    char* openingBracket = memrchr(start, '[', (size_t) (closingBracket - start));
-                    if (openingBracket)
-                    {
-                        openingBracket++;
-                        ffStrbufSetNS(&gpu->name, (uint32_t) (closingBracket - openingBracket), openingBracket);
-                        if (coreName)
-                        {
-                            ffStrbufSetNS(coreName, (uint32_t) (openingBracket - start) - 1, start);
-                            ffStrbufTrimRight(coreName, ' ');
-                        }
-                    }
-                }
-                if (!gpu->name.length)
-                    ffStrbufSetNS(&gpu->name, (uint32_t) (end - start), start);
+                setDeviceName(start, end, gpu, coreName);
             }
         }
     }
 
     if (!gpu->name.length)
+        setFallbackName(subclass, device, gpu);
+}
+
+// Index of pci.ids, stored in the cache as two sorted arrays.
+// The file itself is mapped, so a lookup only reads the index entries of the binary search and the two matching lines
+typedef struct FFPciIdsVendor
+{
+    uint32_t nameOffset;
+    uint32_t firstDevice;
+    uint32_t deviceCount;
+    uint16_t id;
+    uint16_t reserved;
+} FFPciIdsVendor;
+
+typedef struct FFPciIdsDevice
+{
+    uint32_t nameOffset;
+    uint16_t id;
+    uint16_t reserved;
+} FFPciIdsDevice;
+
+static struct
+{
+    const char* content;
+    size_t size;
+    FFCacheEntry index;
+    const void* vendors; // FFPciIdsVendor[], not necessarily aligned
+    uint32_t vendorCount;
+    const void* devices; // FFPciIdsDevice[], not necessarily aligned
+    uint32_t deviceCount;
+} pciIds;
+
+static bool parseHex4(const char* str, uint16_t* result)
+{
+    uint16_t value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        char c = str[i];
+        // pci.ids uses lower case only
+        if (c >= '0' && c <= '9') value = (uint16_t) (value << 4 | (c - '0'));
+        else if (c >= 'a' && c <= 'f') value = (uint16_t) (value << 4 | (c - 'a' + 10));
+        else return false;
+    }
+    *result = value;
+    return true;
+}
+
+static int compareVendor(const void* a, const void* b)
+{
+    const FFPciIdsVendor* x = a;
+    const FFPciIdsVendor* y = b;
+    if (x->id != y->id) return x->id < y->id ? -1 : 1;
+    return x->nameOffset < y->nameOffset ? -1 : x->nameOffset > y->nameOffset;
+}
+
+static int compareDevice(const void* a, const void* b)
+{
+    const FFPciIdsDevice* x = a;
+    const FFPciIdsDevice* y = b;
+    if (x->id != y->id) return x->id < y->id ? -1 : 1;
+    return x->nameOffset < y->nameOffset ? -1 : x->nameOffset > y->nameOffset;
+}
+
+static void buildIndex(FFCacheEntry* entry)
+{
+    FF_LIST_AUTO_DESTROY vendors = ffListCreate(sizeof(FFPciIdsVendor));
+    FF_LIST_AUTO_DESTROY devices = ffListCreate(sizeof(FFPciIdsDevice));
+    FFPciIdsVendor* vendor = NULL;
+
+    // Vendor lines are `vvvv  name`, followed by device lines `\tdddd  name`, subsystem lines and comments
+    for (const char* line = pciIds.content, *end = pciIds.content + pciIds.size; line < end;)
+    {
+        const char* lineEnd = memchr(line, '\n', (size_t) (end - line));
+        if (!lineEnd) lineEnd = end;
+        size_t lineLength = (size_t) (lineEnd - line);
+        uint16_t id;
+
+        if (line[0] == '\t')
+        {
+            if (vendor && lineLength > 7 && parseHex4(line + 1, &id) && line[5] == ' ' && line[6] == ' ')
+            {
+                *(FFPciIdsDevice*) ffListAdd(&devices) = (FFPciIdsDevice) {
+                    .nameOffset = (uint32_t) (line + 7 - pciIds.content),
+                    .id = id,
+                };
+                ++vendor->deviceCount;
+            }
+        }
+        else if (line[0] != '#')
+        {
+            vendor = NULL;
+            if (lineLength > 6 && parseHex4(line, &id) && line[4] == ' ' && line[5] == ' ')
+            {
+                vendor = ffListAdd(&vendors);
+                *vendor = (FFPciIdsVendor) {
+                    .nameOffset = (uint32_t) (line + 6 - pciIds.content),
+                    .firstDevice = devices.length,
+                    .id = id,
+                };
+            }
+        }
+
+        line = lineEnd + 1;
+    }
+
+    // pci.ids is sorted, but don't rely on it. Ties are broken by file offset, so that the first match wins like before
+    FF_LIST_FOR_EACH(FFPciIdsVendor, v, vendors)
+    {
+        if (v->deviceCount > 1)
+            qsort(ffListGet(&devices, v->firstDevice), v->deviceCount, sizeof(FFPciIdsDevice), compareDevice);
+    }
+    qsort(vendors.data, vendors.length, sizeof(FFPciIdsVendor), compareVendor);
+
+    ffCachePutData(entry, vendors.length * (uint32_t) sizeof(FFPciIdsVendor), vendors.data);
+    ffCachePutData(entry, devices.length * (uint32_t) sizeof(FFPciIdsDevice), devices.data);
+}
+
+bool ffGPULoadPciIds(const char* path)
+{
+    if (pciIds.content)
+        return true;
+
+    size_t size;
+    char* content = ffMapFile(path, &size);
+    if (!content)
+        return false;
+    if (size > UINT32_MAX)
     {
-        const char* subclassStr;
-        switch (subclass)
+        munmap(content, size);
+        return false;
+    }
+    pciIds.content = content;
+    pciIds.size = size;
+
+    FFCacheEntry* entry = &pciIds.index;
+    ffCacheEntryInit(entry, "pciids");
+    ffCacheKeyAddFile(entry, path);
+
+    if (!ffCacheLoadMapped(entry))
+    {
+        buildIndex(entry);
+        ffCacheStore(entry);
+        entry->offset = 0;
+    }
+
+    uint32_t vendorsSize, devicesSize;
+    if (
+        !ffCacheGetDataRef(entry, &vendorsSize, &pciIds.vendors) ||
+        !ffCacheGetDataRef(entry, &devicesSize, &pciIds.devices)
+    )
+    {
+        vendorsSize = devicesSize = 0;
+    }
+    pciIds.vendorCount = vendorsSize / (uint32_t) sizeof(FFPciIdsVendor);
+    pciIds.deviceCount = devicesSize / (uint32_t) sizeof(FFPciIdsDevice);
+
+    // Both mappings are kept for the lifetime of the process
+    return true;
+}
+
+static const char* getLineEnd(uint32_t offset)
+{
+    const char* end = memchr(pciIds.content + offset, '\n', pciIds.size - offset);
+    return end ? end : pciIds.content + pciIds.size;
+}
+
+void ffGPUFindPciIds(uint8_t subclass, uint16_t vendor, uint16_t device, FFGPUResult* gpu, FFstrbuf* coreName)
+{
+    // Lower bound of `vendor`
+    uint32_t low = 0, high = pciIds.vendorCount;
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2;
+        FFPciIdsVendor v;
+        memcpy(&v, (const FFPciIdsVendor*) pciIds.vendors + mid, sizeof(v));
+        if (v.id < vendor) low = mid + 1;
+        else high = mid;
+    }
+
+    FFPciIdsVendor v;
+    if (low < pciIds.vendorCount)
+        memcpy(&v, (const FFPciIdsVendor*) pciIds.vendors + low, sizeof(v));
+    if (
+        low < pciIds.vendorCount && v.id == vendor &&
+        v.nameOffset < pciIds.size &&
+        v.firstDevice <= pciIds.deviceCount && v.deviceCount <= pciIds.deviceCount - v.firstDevice
+    )
+    {
+        if (!gpu->vendor.length)
+        {
+            const char* start = pciIds.content + v.nameOffset;
+            ffStrbufSetNS(&gpu->vendor, (uint32_t) (getLineEnd(v.nameOffset) - start), start);
+        }
+
+        low = v.firstDevice;
+        high = v.firstDevice + v.deviceCount;
+        uint32_t last = high;
+        while (low < high)
         {
-        case 0 /*PCI_CLASS_DISPLAY_VGA*/: subclassStr = " (VGA compatible)"; break;
-        case 1 /*PCI_CLASS_DISPLAY_XGA*/: subclassStr = " (XGA compatible)"; break;
-        case 2 /*PCI_CLASS_DISPLAY_3D*/: subclassStr = " (3D)"; break;
-        default: subclassStr = ""; break;
+            uint32_t mid = low + (high - low) / 2;
+            FFPciIdsDevice d;
+            memcpy(&d, (const FFPciIdsDevice*) pciIds.devices + mid, sizeof(d));
+            if (d.id < device) low = mid + 1;
+            else high = mid;
         }
 
-        ffStrbufSetF(&gpu->name, "%s Device %04X%s", gpu->vendor.length ? gpu->vendor.chars : "Unknown", device, subclassStr);
+        FFPciIdsDevice d;
+        if (low < last)
+            memcpy(&d, (const FFPciIdsDevice*) pciIds.devices + low, sizeof(d));
+        if (low < last && d.id == device && d.nameOffset < pciIds.size)
+        {
+            const char* start = pciIds.content + d.nameOffset;
+            setDeviceName(start, getLineEnd(d.nameOffset), gpu, coreName);
+        }
     }
+
+    if (!gpu->name.length)
+        setFallbackName(subclass, device, gpu);
 }
@@ -52,7 +52,7 @@ const char* ffDetectInitSystem(FFInitSystemResult* result)
             ffElfExtractStrings(result->exe.chars, elfExtractStringsCallBack, &result->version);
             if (result->version.length == 0)
             {
-                if (ffProcessAppendStdOut(&result->version, (char* const[]) {
+                if (ffProcessAppendStdOutCached(&result->version, (char* const[]) {
                     ffStrbufEndsWithS(&result->exe, "/systemd") ? result->exe.chars : "systemctl", // use exe path in case users have another systemd installed
                     "--version",
                     NULL,
@@ -71,7 +71,7 @@ const char* ffDetectInitSystem(FFInitSystemResult* result)
         #elif __APPLE__
         if (ffStrbufEqualS(&result->name, "launchd"))
         {
-            if (ffProcessAppendStdOut(&result->version, (char* const[]) {
+            if (ffProcessAppendStdOutCached(&result->version, (char* const[]) {
                 "/bin/launchctl",
                 "version",
                 NULL,
@@ -11,14 +11,14 @@
 
 static const char* getGdmVersion(FFstrbuf* version)
 {
-    const char* error = ffProcessAppendStdOut(version, (char* const[]) {
+    const char* error = ffProcessAppendStdOutCached(version, (char* const[]) {
         "gdm",
         "--version",
         NULL
     });
     if (error || version->length == 0)
     {
-        error = ffProcessAppendStdOut(version, (char* const[]) {
+        error = ffProcessAppendStdOutCached(version, (char* const[]) {
             "gdm3",
             "--version",
             NULL
@@ -33,7 +33,7 @@ static const char* getGdmVersion(FFstrbuf* version)
 
 static const char* getSshdVersion(FFstrbuf* version)
 {
-    const char* error = ffProcessAppendStdErr(version, (char* const[]) {
+    const char* error = ffProcessAppendStdErrCached(version, (char* const[]) {
         "sshd",
         "-V",
         NULL
@@ -101,7 +101,7 @@ static const char* getSddmVersion(FF_MAYBE_UNUSED FFstrbuf* version)
 
 static const char* getXfwmVersion(FFstrbuf* version)
 {
-    const char* error = ffProcessAppendStdOut(version, (char* const[]) {
+    const char* error = ffProcessAppendStdOutCached(version, (char* const[]) {
         "xfwm4",
         "--version",
         NULL
@@ -118,7 +118,7 @@ static const char* getXfwmVersion(FFstrbuf* version)
 
 static const char* getLightdmVersion(FFstrbuf* version)
 {
-    const char* error = ffProcessAppendStdErr(version, (char* const[]) {
+    const char* error = ffProcessAppendStdErrCached(version, (char* const[]) {
         "lightdm",
         "--version",
         NULL
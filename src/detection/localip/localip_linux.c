@@ -17,31 +17,28 @@
 #else
 #include <netpacket/packet.h>
 #endif
+#ifdef __linux__
+#include "common/netif/netlink_linux.h"
+#include <stdlib.h>
+#endif
 #ifdef __sun
 #include <sys/sockio.h>
 #endif
 
-static void addNewIp(FFlist* list, const char* name, const char* addr, int type, bool defaultRoute, bool firstOnly)
+static FFLocalIpResult* newResult(FFlist* list, const char* name, bool defaultRoute)
 {
-    FFLocalIpResult* ip = NULL;
-
-    FF_LIST_FOR_EACH(FFLocalIpResult, temp, *list)
-    {
-        if (!ffStrbufEqualS(&temp->name, name)) continue;
-        ip = temp;
-        break;
-    }
-    if (!ip)
-    {
-        ip = (FFLocalIpResult*) ffListAdd(list);
-        ffStrbufInitS(&ip->name, name);
-        ffStrbufInit(&ip->ipv4);
-        ffStrbufInit(&ip->ipv6);
-        ffStrbufInit(&ip->mac);
-        ip->defaultRoute = defaultRoute;
-        ip->mtu = -1;
-    }
+    FFLocalIpResult* ip = (FFLocalIpResult*) ffListAdd(list);
+    ffStrbufInitS(&ip->name, name);
+    ffStrbufInit(&ip->ipv4);
+    ffStrbufInit(&ip->ipv6);
+    ffStrbufInit(&ip->mac);
+    ip->defaultRoute = defaultRoute;
+    ip->mtu = -1;
+    return ip;
+}
 
+static void appendIp(FFLocalIpResult* ip, const char* addr, int type, bool firstOnly)
+{
     switch (type)
     {
         case AF_INET:
@@ -66,8 +63,264 @@ static void addNewIp(FFlist* list, const char* name, const char* addr, int type,
     }
 }
 
+static void addNewIp(FFlist* list, const char* name, const char* addr, int type, bool defaultRoute, bool firstOnly)
+{
+    FFLocalIpResult* ip = NULL;
+
+    FF_LIST_FOR_EACH(FFLocalIpResult, temp, *list)
+    {
+        if (!ffStrbufEqualS(&temp->name, name)) continue;
+        ip = temp;
+        break;
+    }
+    if (!ip)
+        ip = newResult(list, name, defaultRoute);
+
+    appendIp(ip, addr, type, firstOnly);
+}
+
+#ifdef __linux__
+typedef struct FFLocalIpLink
+{
+    uint32_t ifIndex;
+    uint32_t flags;
+    int32_t mtu;
+    int32_t result; // index in results, -1 if not added yet
+    bool shown;
+    uint8_t mac[8];
+    char name[IF_NAMESIZE + 1];
+} FFLocalIpLink;
+
+typedef struct FFLocalIpNetlinkData
+{
+    const FFLocalIpOptions* options;
+    FFlist* results;
+    FFlist links; // FFLocalIpLink
+    uint32_t* table; // open addressing, keyed by ifIndex. Stores index in links + 1
+    uint32_t tableMask;
+} FFLocalIpNetlinkData;
+
+static inline uint32_t hashIfIndex(uint32_t ifIndex)
+{
+    return ifIndex * 2654435761u; // Knuth's multiplicative hash
+}
+
+static void parseLink(const struct nlmsghdr* msg, void* data)
+{
+    if (msg->nlmsg_type != RTM_NEWLINK || msg->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+        return;
+
+    const struct ifinfomsg* ifi = NLMSG_DATA(msg);
+    const struct rtattr* attrs[IFLA_MAX + 1];
+    ffNetlinkParseAttrs(msg, sizeof(*ifi), attrs, IFLA_MAX);
+    if (!attrs[IFLA_IFNAME])
+        return;
+
+    FFLocalIpLink* link = ffListAdd(&((FFLocalIpNetlinkData*) data)->links);
+    *link = (FFLocalIpLink) {
+        .ifIndex = (uint32_t) ifi->ifi_index,
+        .flags = ifi->ifi_flags,
+        .mtu = -1,
+        .result = -1,
+    };
+    size_t nameLength = strnlen(RTA_DATA(attrs[IFLA_IFNAME]), RTA_PAYLOAD(attrs[IFLA_IFNAME]));
+    if (nameLength >= sizeof(link->name))
+        nameLength = sizeof(link->name) - 1;
+    memcpy(link->name, RTA_DATA(attrs[IFLA_IFNAME]), nameLength);
+    if (attrs[IFLA_MTU])
+        memcpy(&link->mtu, RTA_DATA(attrs[IFLA_MTU]), sizeof(link->mtu));
+    if (attrs[IFLA_ADDRESS]) // Like sll_addr of getifaddrs; zero filled if shorter
+    {
+        size_t length = RTA_PAYLOAD(attrs[IFLA_ADDRESS]);
+        memcpy(link->mac, RTA_DATA(attrs[IFLA_ADDRESS]), length < sizeof(link->mac) ? length : sizeof(link->mac));
+    }
+}
+
+static FFLocalIpLink* findLink(FFLocalIpNetlinkData* data, uint32_t ifIndex)
+{
+    for (uint32_t i = hashIfIndex(ifIndex) & data->tableMask; data->table[i]; i = (i + 1) & data->tableMask)
+    {
+        FFLocalIpLink* link = FF_LIST_GET(FFLocalIpLink, data->links, data->table[i] - 1);
+        if (link->ifIndex == ifIndex)
+            return link;
+    }
+    return NULL;
+}
+
+static FFLocalIpResult* getLinkResult(FFLocalIpNetlinkData* data, FFLocalIpLink* link)
+{
+    if (link->result < 0)
+    {
+        link->result = (int32_t) data->results->length;
+        FFLocalIpResult* ip = newResult(data->results, link->name, link->ifIndex == ffNetifGetDefaultRouteIfIndex());
+        ip->mtu = link->mtu;
+        return ip;
+    }
+    return FF_LIST_GET(FFLocalIpResult, *data->results, (uint32_t) link->result);
+}
+
+// IPv4 aliases (e.g. `eth0:1`) are separate entries of getifaddrs, named by their label and filtered by it
+static bool isAliasShown(const FFLocalIpOptions* options, const FFLocalIpLink* link, const char* label)
+{
+    return (link->flags & IFF_RUNNING) &&
+        !(options->showType & FF_LOCALIP_TYPE_DEFAULT_ROUTE_ONLY_BIT) && // The default route never names an alias
+        (!(link->flags & IFF_LOOPBACK) || (options->showType & FF_LOCALIP_TYPE_LOOP_BIT)) &&
+        (!options->namePrefix.length || strncmp(label, options->namePrefix.chars, options->namePrefix.length) == 0);
+}
+
+static FFLocalIpResult* getAliasResult(FFLocalIpNetlinkData* data, const FFLocalIpLink* link, const char* label)
+{
+    FF_LIST_FOR_EACH(FFLocalIpResult, ip, *data->results)
+    {
+        if (ffStrbufEqualS(&ip->name, label))
+            return ip;
+    }
+    FFLocalIpResult* ip = newResult(data->results, label, false);
+    ip->mtu = link->mtu;
+    return ip;
+}
+
+static void parseAddr(const struct nlmsghdr* msg, void* data)
+{
+    if (msg->nlmsg_type != RTM_NEWADDR || msg->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifaddrmsg)))
+        return;
+
+    FFLocalIpNetlinkData* netlinkData = data;
+    const FFLocalIpOptions* options = netlinkData->options;
+    const struct ifaddrmsg* ifa = NLMSG_DATA(msg);
+
+    if (ifa->ifa_family == AF_INET ? !(options->showType & FF_LOCALIP_TYPE_IPV4_BIT) :
+        ifa->ifa_family == AF_INET6 ? !(options->showType & FF_LOCALIP_TYPE_IPV6_BIT) :
+        true)
+        return;
+
+    FFLocalIpLink* link = findLink(netlinkData, ifa->ifa_index);
+    if (!link)
+        return;
+
+    const struct rtattr* attrs[IFA_MAX + 1];
+    ffNetlinkParseAttrs(msg, sizeof(*ifa), attrs, IFA_MAX);
+
+    char label[IF_NAMESIZE + 1] = "";
+    if (ifa->ifa_family == AF_INET && attrs[IFA_LABEL])
+    {
+        size_t labelLength = strnlen(RTA_DATA(attrs[IFA_LABEL]), RTA_PAYLOAD(attrs[IFA_LABEL]));
+        if (labelLength >= sizeof(label))
+            labelLength = sizeof(label) - 1;
+        memcpy(label, RTA_DATA(attrs[IFA_LABEL]), labelLength);
+        label[labelLength] = '\0';
+    }
+    bool alias = label[0] && !ffStrEquals(label, link->name);
+    if (alias ? !isAliasShown(options, link, label) : !link->shown)
+        return;
+
+    // For point-to-point links, IFA_ADDRESS is the address of the peer. getifaddrs prefers IFA_LOCAL too
+    const struct rtattr* addr = attrs[IFA_LOCAL] ? attrs[IFA_LOCAL] : attrs[IFA_ADDRESS];
+    if (!addr || RTA_PAYLOAD(addr) < (ifa->ifa_family == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr)))
+        return;
+
+    char addressBuffer[INET6_ADDRSTRLEN + 16];
+    inet_ntop(ifa->ifa_family, RTA_DATA(addr), addressBuffer, INET6_ADDRSTRLEN);
+    if ((options->showType & FF_LOCALIP_TYPE_PREFIX_LEN_BIT) && ifa->ifa_prefixlen != 0)
+    {
+        size_t len = strlen(addressBuffer);
+        snprintf(addressBuffer + len, 16, "/%u", (unsigned) ifa->ifa_prefixlen);
+    }
+
+    FFLocalIpResult* ip = alias ? getAliasResult(netlinkData, link, label) : getLinkResult(netlinkData, link);
+    appendIp(ip, addressBuffer, ifa->ifa_family, !(options->showType & FF_LOCALIP_TYPE_ALL_IPS_BIT));
+}
+
+// Two dumps instead of getifaddrs + an ioctl per interface
+static bool detectByNetlink(const FFLocalIpOptions* options, FFlist* results)
+{
+    FFLocalIpNetlinkData data = {
+        .options = options,
+        .results = results,
+        .links = ffListCreate(sizeof(FFLocalIpLink)),
+    };
+
+    struct
+    {
+        struct nlmsghdr header;
+        union
+        {
+            struct ifinfomsg ifi;
+            struct ifaddrmsg ifa;
+        };
+    } request = {
+        .header = {
+            .nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg)),
+            .nlmsg_type = RTM_GETLINK,
+        },
+    };
+
+    bool ok = ffNetlinkDump(&request.header, parseLink, &data);
+    if (ok)
+    {
+        uint32_t capacity = 16;
+        while (capacity < data.links.length * 2)
+            capacity *= 2;
+        data.table = calloc(capacity, sizeof(*data.table));
+        data.tableMask = capacity - 1;
+
+        uint32_t defaultRouteIfIndex = ffNetifGetDefaultRouteIfIndex();
+        for (uint32_t index = 0; index < data.links.length; ++index)
+        {
+            FFLocalIpLink* link = FF_LIST_GET(FFLocalIpLink, data.links, index);
+
+            uint32_t i = hashIfIndex(link->ifIndex) & data.tableMask;
+            while (data.table[i])
+                i = (i + 1) & data.tableMask;
+            data.table[i] = index + 1;
+
+            link->shown = (link->flags & IFF_RUNNING) &&
+                (!(options->showType & FF_LOCALIP_TYPE_DEFAULT_ROUTE_ONLY_BIT) || link->ifIndex == defaultRouteIfIndex) &&
+                (!(link->flags & IFF_LOOPBACK) || (options->showType & FF_LOCALIP_TYPE_LOOP_BIT)) &&
+                (!options->namePrefix.length || strncmp(link->name, options->namePrefix.chars, options->namePrefix.length) == 0);
+
+            // getifaddrs lists the AF_PACKET entries of all links before any address
+            if (link->shown && (options->showType & FF_LOCALIP_TYPE_MAC_BIT))
+            {
+                char addressBuffer[32];
+                const uint8_t* ptr = link->mac;
+                snprintf(addressBuffer, sizeof(addressBuffer), "%02x:%02x:%02x:%02x:%02x:%02x",
+                            ptr[0], ptr[1], ptr[2], ptr[3], ptr[4], ptr[5]);
+                appendIp(getLinkResult(&data, link), addressBuffer, -1, false);
+            }
+        }
+
+        request.header.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifaddrmsg));
+        request.header.nlmsg_type = RTM_GETADDR;
+        request.ifa = (struct ifaddrmsg) { .ifa_family = AF_UNSPEC };
+        ok = ffNetlinkDump(&request.header, parseAddr, &data);
+    }
+
+    free(data.table);
+    ffListDestroy(&data.links);
+    return ok;
+}
+#endif
+
 const char* ffDetectLocalIps(const FFLocalIpOptions* options, FFlist* results)
 {
+    #ifdef __linux__
+    uint32_t first = results->length;
+    if (detectByNetlink(options, results))
+        return NULL;
+
+    // Netlink may be blocked, e.g. by SELinux on Android. Drop partial results
+    for (uint32_t i = first; i < results->length; ++i)
+    {
+        FFLocalIpResult* ip = FF_LIST_GET(FFLocalIpResult, *results, i);
+        ffStrbufDestroy(&ip->name);
+        ffStrbufDestroy(&ip->ipv4);
+        ffStrbufDestroy(&ip->ipv6);
+        ffStrbufDestroy(&ip->mac);
+    }
+    results->length = first;
+    #endif
+
     struct ifaddrs* ifAddrStruct = NULL;
     if(getifaddrs(&ifAddrStruct) < 0)
         return "getifaddrs(&ifAddrStruct) failed";
@@ -19,30 +19,25 @@
 
 static bool getBusProperties(FFDBusData* data, const char* busName, FFMediaResult* result)
 {
-    DBusMessage* reply = ffDBusGetProperty(data, busName, "/org/mpris/MediaPlayer2", "org.mpris.MediaPlayer2.Player", "Metadata");
-    if(reply == NULL)
+    // Request the player properties (Metadata, PlaybackStatus) and the ones of the root interface (Identity, DesktopEntry) together
+    FF_DBUS_BATCH_AUTO_DESTROY batch;
+    ffDBusBatchInit(&batch, data);
+    uint32_t playerIndex = ffDBusBatchAddGetAllProperties(&batch, busName, "/org/mpris/MediaPlayer2", "org.mpris.MediaPlayer2.Player");
+    uint32_t rootIndex = ffDBusBatchAddGetAllProperties(&batch, busName, "/org/mpris/MediaPlayer2", "org.mpris.MediaPlayer2");
+    ffDBusBatchWait(&batch);
+
+    DBusMessage* playerReply = ffDBusBatchGetReply(&batch, playerIndex);
+    DBusMessageIter metadataIterator;
+    if(!ffDBusFindProperty(data, playerReply, "Metadata", &metadataIterator))
         return false;
 
-    DBusMessageIter rootIterator;
-    if(!data->lib->ffdbus_message_iter_init(reply, &rootIterator))
-    {
-        data->lib->ffdbus_message_unref(reply);
+    if(data->lib->ffdbus_message_iter_get_arg_type(&metadataIterator) != DBUS_TYPE_VARIANT)
         return false;
-    }
-
-    if(data->lib->ffdbus_message_iter_get_arg_type(&rootIterator) != DBUS_TYPE_VARIANT)
-    {
-        data->lib->ffdbus_message_unref(reply);
-        return false;
-    }
 
     DBusMessageIter variantIterator;
-    data->lib->ffdbus_message_iter_recurse(&rootIterator, &variantIterator);
+    data->lib->ffdbus_message_iter_recurse(&metadataIterator, &variantIterator);
     if(data->lib->ffdbus_message_iter_get_arg_type(&variantIterator) != DBUS_TYPE_ARRAY)
-    {
-        data->lib->ffdbus_message_unref(reply);
         return false;
-    }
 
     DBusMessageIter arrayIterator;
     data->lib->ffdbus_message_iter_recurse(&variantIterator, &arrayIterator);
@@ -81,8 +76,6 @@ static bool getBusProperties(FFDBusData* data, const char* busName, FFMediaResul
         FF_DBUS_ITER_CONTINUE(data, &arrayIterator)
     }
 
-    data->lib->ffdbus_message_unref(reply);
-
     if(result->song.length == 0)
     {
         ffStrbufClear(&result->artist);
@@ -91,15 +84,19 @@ static bool getBusProperties(FFDBusData* data, const char* busName, FFMediaResul
         return false;
     }
 
-    ffDBusGetPropertyString(data, busName, "/org/mpris/MediaPlayer2", "org.mpris.MediaPlayer2.Player", "PlaybackStatus", &result->status);
+    DBusMessageIter iter;
+    if(ffDBusFindProperty(data, playerReply, "PlaybackStatus", &iter))
+        ffDBusGetString(data, &iter, &result->status);
 
     //Set short bus name
     ffStrbufAppendS(&result->playerId, busName + sizeof(FF_DBUS_MPRIS_PREFIX) - 1);
 
     //We found a song, get the player name
-    ffDBusGetPropertyString(data, busName, "/org/mpris/MediaPlayer2", "org.mpris.MediaPlayer2", "Identity", &result->player);
-    if(result->player.length == 0)
-        ffDBusGetPropertyString(data, busName, "/org/mpris/MediaPlayer2", "org.mpris.MediaPlayer2", "DesktopEntry", &result->player);
+    DBusMessage* rootReply = ffDBusBatchGetReply(&batch, rootIndex);
+    if(ffDBusFindProperty(data, rootReply, "Identity", &iter))
+        ffDBusGetString(data, &iter, &result->player);
+    if(result->player.length == 0 && ffDBusFindProperty(data, rootReply, "DesktopEntry", &iter))
+        ffDBusGetString(data, &iter, &result->player);
     if(result->player.length == 0)
         ffStrbufAppend(&result->player, &result->playerId);
 
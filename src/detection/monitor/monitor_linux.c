@@ -186,7 +186,7 @@ FF_MAYBE_UNUSED static const char* detectByDrm(FFlist* results)
     uint32_t drmDirLength = drmDir.length;
 
     struct dirent* entry;
-    while((entry = readdir(dirp)) != NULL)
+    while((entry = ffReadDir(dirp)) != NULL)
     {
         if(ffStrEquals(entry->d_name, ".") || ffStrEquals(entry->d_name, ".."))
             continue;
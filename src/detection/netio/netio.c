@@ -1,21 +1,137 @@
 #include "netio.h"
 
+#include "common/cache.h"
 #include "common/time.h"
 
 const char* ffNetIOGetIoCounters(FFlist* result, FFNetIOOptions* options);
 
 static FFlist ioCounters1;
 static uint64_t time1;
+static FFlist ioCountersNext;
+static uint64_t timeNext;
+static FFNetIOOptions* sampleOptions;
+static bool baselinePersisted; // ioCounters1 was stored by the previous run
+
+static void clearCounters(FFlist* counters)
+{
+    FF_LIST_FOR_EACH(FFNetIOResult, counter, *counters)
+    {
+        ffStrbufDestroy(&counter->name);
+    }
+    ffListClear(counters);
+}
+
+static bool isSameDevices(const FFlist* counters1, const FFlist* counters2)
+{
+    if (counters1->length != counters2->length)
+        return false;
+    for (uint32_t i = 0; i < counters1->length; ++i)
+    {
+        const FFNetIOResult* counter1 = FF_LIST_GET(FFNetIOResult, *counters1, i);
+        const FFNetIOResult* counter2 = FF_LIST_GET(FFNetIOResult, *counters2, i);
+        if (!ffStrbufEqual(&counter1->name, &counter2->name))
+            return false;
+
+        // A device that was recreated under the same name restarts its counters
+        for (size_t off = offsetof(FFNetIOResult, txBytes); off < sizeof(FFNetIOResult); off += sizeof(uint64_t))
+        {
+            if (*(const uint64_t*) ((const uint8_t*) counter2 + off) < *(const uint64_t*) ((const uint8_t*) counter1 + off))
+                return false;
+        }
+    }
+    return true;
+}
+
+static void initBaselineEntry(FFCacheEntry* cache, FFNetIOOptions* options)
+{
+    ffCacheEntryInit(cache, "netio");
+    ffCacheKeyAddBootId(cache);
+    ffCacheKeyAddUInt(cache, options->defaultRouteOnly);
+    ffStrbufAppend(&cache->key, &options->namePrefix);
+    ffStrbufAppendC(&cache->key, ' ');
+}
+
+static bool loadBaseline(FFNetIOOptions* options)
+{
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    initBaselineEntry(&cache, options);
+
+    uint64_t age = ffCacheLoadBaseline(&cache);
+    uint32_t count;
+    if (age == UINT64_MAX || !ffCacheGetData(&cache, sizeof(count), &count) || count == 0)
+        return false;
+
+    ffListInitA(&ioCounters1, sizeof(FFNetIOResult), count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        FFNetIOResult* counter = (FFNetIOResult*) ffListAdd(&ioCounters1);
+        *counter = (FFNetIOResult) {};
+        ffStrbufInit(&counter->name);
+        if (!ffCacheGetStrbuf(&cache, &counter->name) ||
+            !ffCacheGetData(&cache, sizeof(FFNetIOResult) - offsetof(FFNetIOResult, txBytes), &counter->txBytes))
+        {
+            clearCounters(&ioCounters1);
+            ffListDestroy(&ioCounters1);
+            return false;
+        }
+    }
+
+    time1 = ffTimeGetNow() - age;
+    baselinePersisted = true;
+    return true;
+}
+
+static void storeBaseline(FFNetIOOptions* options)
+{
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    initBaselineEntry(&cache, options);
+    ffCacheStartBaseline(&cache);
+    ffCachePutData(&cache, sizeof(ioCounters1.length), &ioCounters1.length);
+    FF_LIST_FOR_EACH(FFNetIOResult, counter, ioCounters1)
+    {
+        ffCachePutStrbuf(&cache, &counter->name);
+        ffCachePutData(&cache, sizeof(FFNetIOResult) - offsetof(FFNetIOResult, txBytes), &counter->txBytes);
+    }
+    ffCacheStore(&cache);
+}
 
 void ffPrepareNetIO(FFNetIOOptions* options)
 {
-    if (options->detectTotal) return;
+    if (options->detectTotal || time1 != 0) return;
+
+    sampleOptions = options;
+
+    if (loadBaseline(options))
+        return;
 
     ffListInit(&ioCounters1, sizeof(FFNetIOResult));
     ffNetIOGetIoCounters(&ioCounters1, options);
     time1 = ffTimeGetNow();
 }
 
+// Called periodically by long running processes. The baseline is kept one sampling interval old
+// so that rates can be reported without waiting for a new sample
+void ffSampleNetIO(void)
+{
+    if (!sampleOptions || time1 == 0)
+        return;
+
+    if (timeNext == 0)
+        ffListInit(&ioCountersNext, sizeof(FFNetIOResult));
+    else
+    {
+        FFlist temp = ioCounters1;
+        ioCounters1 = ioCountersNext;
+        ioCountersNext = temp;
+        time1 = timeNext;
+        baselinePersisted = false;
+    }
+
+    clearCounters(&ioCountersNext);
+    ffNetIOGetIoCounters(&ioCountersNext, sampleOptions);
+    timeNext = ffTimeGetNow();
+}
+
 const char* ffDetectNetIO(FFlist* result, FFNetIOOptions* options)
 {
     const char* error = NULL;
@@ -28,7 +144,7 @@ const char* ffDetectNetIO(FFlist* result, FFNetIOOptions* options)
         return NULL;
     }
 
-    if (time1 == 0)
+    if (time1 == 0 && !loadBaseline(options))
     {
         ffListInit(&ioCounters1, sizeof(FFNetIOResult));
         error = ffNetIOGetIoCounters(&ioCounters1, options);
@@ -40,6 +156,7 @@ const char* ffDetectNetIO(FFlist* result, FFNetIOOptions* options)
     if (ioCounters1.length == 0)
         return "No network interfaces found";
 
+retry:;
     uint64_t time2 = ffTimeGetNow();
     while (time2 - time1 < 1000)
     {
@@ -51,6 +168,21 @@ const char* ffDetectNetIO(FFlist* result, FFNetIOOptions* options)
     if (error)
         return error;
 
+    if (baselinePersisted)
+    {
+        baselinePersisted = false;
+        if (!isSameDevices(&ioCounters1, result))
+        {
+            // Interfaces changed or restarted their counters since the previous run. Start over with the current sample
+            FFlist temp = ioCounters1;
+            ioCounters1 = *result;
+            *result = temp;
+            clearCounters(result);
+            time1 = time2;
+            goto retry;
+        }
+    }
+
     if (result->length != ioCounters1.length)
         return "Different number of network interfaces. Network change?";
 
@@ -68,11 +200,12 @@ const char* ffDetectNetIO(FFlist* result, FFNetIOOptions* options)
             uint64_t* currValue = (uint64_t*) ((uint8_t*) icCurr + off);
             uint64_t temp = *currValue;
             *currValue -= *prevValue;
-            *currValue /= (time2 - time1) / 1000 /* seconds */;
+            *currValue = *currValue * 1000 / (time2 - time1) /* per second */;
             *prevValue = temp;
         }
     }
     time1 = time2;
+    storeBaseline(options);
 
     return NULL;
 }
@@ -2,71 +2,87 @@
 
 #include "common/io/io.h"
 #include "common/netif/netif.h"
+#include "common/netif/netlink_linux.h"
+#include "util/mallocHelper.h"
 #include "util/stringUtils.h"
 
-#include <net/if.h>
+#include <linux/if.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/if_link.h>
 
-static void getData(FFstrbuf* buffer, const char* ifName, bool isDefaultRoute, FFstrbuf* path, FFlist* result)
+static const struct
 {
-    ffStrbufSetF(path, "/sys/class/net/%s/operstate", ifName);
-    if(!ffReadFileBuffer(path->chars, buffer) || !ffStrbufEqualS(buffer, "up\n"))
+    const char* name;
+    uint32_t offset;
+} statFiles[] = {
+    { "statistics/rx_bytes", offsetof(FFNetIOResult, rxBytes) },
+    { "statistics/tx_bytes", offsetof(FFNetIOResult, txBytes) },
+    { "statistics/rx_packets", offsetof(FFNetIOResult, rxPackets) },
+    { "statistics/tx_packets", offsetof(FFNetIOResult, txPackets) },
+    { "statistics/rx_errors", offsetof(FFNetIOResult, rxErrors) },
+    { "statistics/tx_errors", offsetof(FFNetIOResult, txErrors) },
+    { "statistics/rx_dropped", offsetof(FFNetIOResult, rxDrops) },
+    { "statistics/tx_dropped", offsetof(FFNetIOResult, txDrops) },
+};
+#define FF_NETIO_STAT_COUNT (sizeof(statFiles) / sizeof(statFiles[0]))
+
+// Adds the interface if it's up. Its counters are read by readCounters, all interfaces at once
+static void addInterface(int netFd, const char* ifName, bool isDefaultRoute, FFlist* result, FFlist* ifFds)
+{
+    int ifFd = ffOpenDirRelative(netFd, ifName);
+    if (ifFd < 0)
+        return;
+
+    char operstate[16];
+    if (ffReadFileStrRelative(ifFd, "operstate", sizeof(operstate), operstate) < 0 || !ffStrEquals(operstate, "up"))
+    {
+        close(ifFd);
         return;
+    }
 
     FFNetIOResult* counters = (FFNetIOResult*) ffListAdd(result);
+    *counters = (FFNetIOResult) { .defaultRoute = isDefaultRoute };
     ffStrbufInitS(&counters->name, ifName);
-    counters->defaultRoute = isDefaultRoute;
-
-    ffStrbufSetF(path, "/sys/class/net/%s/statistics/", ifName);
-    uint32_t statLen = path->length;
-
-    ffStrbufAppendS(path, "rx_bytes");
-    if (ffReadFileBuffer(path->chars, buffer))
-        counters->rxBytes = ffStrbufToUInt(buffer, 0);
-    ffStrbufSubstrBefore(path, statLen);
-
-    ffStrbufAppendS(path, "tx_bytes");
-    if (ffReadFileBuffer(path->chars, buffer))
-        counters->txBytes = ffStrbufToUInt(buffer, 0);
-    ffStrbufSubstrBefore(path, statLen);
-
-    ffStrbufAppendS(path, "rx_packets");
-    if (ffReadFileBuffer(path->chars, buffer))
-        counters->rxPackets = ffStrbufToUInt(buffer, 0);
-    ffStrbufSubstrBefore(path, statLen);
-
-    ffStrbufAppendS(path, "tx_packets");
-    if (ffReadFileBuffer(path->chars, buffer))
-        counters->txPackets = ffStrbufToUInt(buffer, 0);
-    ffStrbufSubstrBefore(path, statLen);
-
-    ffStrbufAppendS(path, "rx_errors");
-    if (ffReadFileBuffer(path->chars, buffer))
-        counters->rxErrors = ffStrbufToUInt(buffer, 0);
-    ffStrbufSubstrBefore(path, statLen);
-
-    ffStrbufAppendS(path, "tx_errors");
-    if (ffReadFileBuffer(path->chars, buffer))
-        counters->txErrors = ffStrbufToUInt(buffer, 0);
-    ffStrbufSubstrBefore(path, statLen);
-
-    ffStrbufAppendS(path, "rx_dropped");
-    if (ffReadFileBuffer(path->chars, buffer))
-        counters->rxDrops = ffStrbufToUInt(buffer, 0);
-    ffStrbufSubstrBefore(path, statLen);
-
-    ffStrbufAppendS(path, "tx_dropped");
-    if (ffReadFileBuffer(path->chars, buffer))
-        counters->txDrops = ffStrbufToUInt(buffer, 0);
-    ffStrbufSubstrBefore(path, statLen);
+    *(int*) ffListAdd(ifFds) = ifFd;
 }
 
-const char* ffNetIOGetIoCounters(FFlist* result, FFNetIOOptions* options)
+static void readCounters(FFlist* result, uint32_t first, FFlist* ifFds)
+{
+    uint32_t count = ifFds->length * (uint32_t) FF_NETIO_STAT_COUNT;
+    FF_AUTO_FREE FFReadFileRequest* requests = malloc(count * sizeof(*requests));
+    FF_AUTO_FREE char (*values)[24] = malloc(count * sizeof(*values));
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        requests[i] = (FFReadFileRequest) {
+            .dfd = *FF_LIST_GET(int, *ifFds, i / FF_NETIO_STAT_COUNT),
+            .path = statFiles[i % FF_NETIO_STAT_COUNT].name,
+            .size = sizeof(*values) - 1,
+            .buf = values[i],
+        };
+    }
+    ffReadFilesBatch(count, requests);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (requests[i].result <= 0)
+            continue;
+        values[i][requests[i].result] = '\0';
+        FFNetIOResult* counters = FF_LIST_GET(FFNetIOResult, *result, first + i / FF_NETIO_STAT_COUNT);
+        *(uint64_t*) ((uint8_t*) counters + statFiles[i % FF_NETIO_STAT_COUNT].offset) = strtoull(values[i], NULL, 10);
+    }
+}
+
+static const char* getIoCountersSysfs(FFlist* result, FFNetIOOptions* options)
 {
     FF_AUTO_CLOSE_DIR DIR* dirp = opendir("/sys/class/net");
     if (!dirp) return "opendir(\"/sys/class/net\") == NULL";
 
-    FF_STRBUF_AUTO_DESTROY path = ffStrbufCreateA(64);
-    FF_STRBUF_AUTO_DESTROY buffer = ffStrbufCreate();
+    int netFd = dirfd(dirp);
+    uint32_t first = result->length;
+    FF_LIST_AUTO_DESTROY ifFds = ffListCreate(sizeof(int));
 
     const char* defaultRouteIfName = ffNetifGetDefaultRouteIfName();
 
@@ -75,12 +91,12 @@ const char* ffNetIOGetIoCounters(FFlist* result, FFNetIOOptions* options)
         if (options->namePrefix.length && strncmp(defaultRouteIfName, options->namePrefix.chars, options->namePrefix.length) != 0)
             return NULL;
 
-       getData(&buffer, defaultRouteIfName, true, &path, result);
+        addInterface(netFd, defaultRouteIfName, true, result, &ifFds);
     }
     else
     {
         struct dirent* entry;
-        while((entry = readdir(dirp)) != NULL)
+        while((entry = ffReadDir(dirp)) != NULL)
         {
             const char* ifName = entry->d_name;
             if(ifName[0] == '.')
@@ -89,9 +105,111 @@ const char* ffNetIOGetIoCounters(FFlist* result, FFNetIOOptions* options)
             if (options->namePrefix.length && strncmp(ifName, options->namePrefix.chars, options->namePrefix.length) != 0)
                 continue;
 
-            getData(&buffer, ifName, ffStrEquals(ifName, defaultRouteIfName), &path, result);
+            addInterface(netFd, ifName, ffStrEquals(ifName, defaultRouteIfName), result, &ifFds);
         }
     }
 
+    if (ifFds.length > 0)
+        readCounters(result, first, &ifFds);
+
+    FF_LIST_FOR_EACH(int, ifFd, ifFds)
+        close(*ifFd);
+
     return NULL;
 }
+
+typedef struct FFNetIOLinkData
+{
+    FFlist* result;
+    const FFNetIOOptions* options;
+    uint32_t defaultRouteIfIndex;
+} FFNetIOLinkData;
+
+static void parseLink(const struct nlmsghdr* msg, void* data)
+{
+    if (msg->nlmsg_type != RTM_NEWLINK || msg->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+        return;
+
+    const struct ifinfomsg* ifi = NLMSG_DATA(msg);
+    const struct rtattr* attrs[IFLA_MAX + 1];
+    ffNetlinkParseAttrs(msg, sizeof(*ifi), attrs, IFLA_MAX);
+
+    // Same as /sys/class/net/<if>/operstate == "up"
+    if (!attrs[IFLA_IFNAME] || !attrs[IFLA_OPERSTATE] || *(const uint8_t*) RTA_DATA(attrs[IFLA_OPERSTATE]) != IF_OPER_UP)
+        return;
+
+    const FFNetIOLinkData* link = data;
+    const char* ifName = RTA_DATA(attrs[IFLA_IFNAME]);
+    bool isDefaultRoute = (uint32_t) ifi->ifi_index == link->defaultRouteIfIndex;
+
+    if (link->options->defaultRouteOnly && !isDefaultRoute)
+        return;
+    if (link->options->namePrefix.length && strncmp(ifName, link->options->namePrefix.chars, link->options->namePrefix.length) != 0)
+        return;
+
+    FFNetIOResult* counters = (FFNetIOResult*) ffListAdd(link->result);
+    *counters = (FFNetIOResult) { .defaultRoute = isDefaultRoute };
+    ffStrbufInitS(&counters->name, ifName);
+
+    // Attributes are only 4 byte aligned
+    if (attrs[IFLA_STATS64] && RTA_PAYLOAD(attrs[IFLA_STATS64]) >= sizeof(struct rtnl_link_stats64))
+    {
+        struct rtnl_link_stats64 stats;
+        memcpy(&stats, RTA_DATA(attrs[IFLA_STATS64]), sizeof(stats));
+        counters->rxBytes = stats.rx_bytes;
+        counters->txBytes = stats.tx_bytes;
+        counters->rxPackets = stats.rx_packets;
+        counters->txPackets = stats.tx_packets;
+        counters->rxErrors = stats.rx_errors;
+        counters->txErrors = stats.tx_errors;
+        counters->rxDrops = stats.rx_dropped;
+        counters->txDrops = stats.tx_dropped;
+    }
+    else if (attrs[IFLA_STATS] && RTA_PAYLOAD(attrs[IFLA_STATS]) >= sizeof(struct rtnl_link_stats))
+    {
+        struct rtnl_link_stats stats;
+        memcpy(&stats, RTA_DATA(attrs[IFLA_STATS]), sizeof(stats));
+        counters->rxBytes = stats.rx_bytes;
+        counters->txBytes = stats.tx_bytes;
+        counters->rxPackets = stats.rx_packets;
+        counters->txPackets = stats.tx_packets;
+        counters->rxErrors = stats.rx_errors;
+        counters->txErrors = stats.tx_errors;
+        counters->rxDrops = stats.rx_dropped;
+        counters->txDrops = stats.tx_dropped;
+    }
+}
+
+const char* ffNetIOGetIoCounters(FFlist* result, FFNetIOOptions* options)
+{
+    // One RTM_GETLINK dump returns the state and counters of all interfaces,
+    // instead of 9 files per interface, which adds up with thousands of veth interfaces
+    struct
+    {
+        struct nlmsghdr header;
+        struct ifinfomsg ifi;
+    } request = {
+        .header = {
+            .nlmsg_len = sizeof(request),
+            .nlmsg_type = RTM_GETLINK,
+        },
+        .ifi = {
+            .ifi_family = AF_UNSPEC,
+        },
+    };
+
+    uint32_t first = result->length;
+    if (ffNetlinkDump(&request.header, parseLink, &(FFNetIOLinkData) {
+        .result = result,
+        .options = options,
+        .defaultRouteIfIndex = ffNetifGetDefaultRouteIfIndex(),
+    }))
+        return NULL;
+
+    // Netlink may be blocked, e.g. by SELinux on Android. Drop partial results
+    for (uint32_t i = first; i < result->length; ++i)
+        ffStrbufDestroy(&FF_LIST_GET(FFNetIOResult, *result, i)->name);
+    result->length = first;
+
+    return getIoCountersSysfs(result, options);
+}
@@ -1,12 +1,22 @@
 #include "os.h"
+#include "common/cache.h"
 
 void ffDetectOSImpl(FFOSResult* os);
 
+static FFOSResult result;
+
+static void resetOS(void)
+{
+    for (uint32_t i = 0; i < sizeof(result) / sizeof(FFstrbuf); ++i)
+        ffStrbufDestroy((FFstrbuf*) &result + i);
+    memset(&result, 0, sizeof(result));
+}
+
 const FFOSResult* ffDetectOS(void)
 {
-    static FFOSResult result;
     if (result.name.chars == NULL)
     {
+        ffCacheRegisterReset(resetOS);
         ffStrbufInit(&result.name);
         ffStrbufInit(&result.prettyName);
         ffStrbufInit(&result.id);
@@ -17,7 +27,21 @@ const FFOSResult* ffDetectOS(void)
         ffStrbufInit(&result.idLike);
         ffStrbufInit(&result.variant);
         ffStrbufInit(&result.variantID);
-        ffDetectOSImpl(&result);
+
+        FF_CACHE_ENTRY_AUTO_DESTROY cache;
+        ffCacheEntryInit(&cache, "os");
+        ffCacheKeyAddBootId(&cache);
+        #ifdef __linux__
+        ffCacheKeyAddFile(&cache, FASTFETCH_TARGET_DIR_ETC "/os-release");
+        ffCacheKeyAddFile(&cache, FASTFETCH_TARGET_DIR_USR "/lib/os-release");
+        ffCacheKeyAddFile(&cache, FASTFETCH_TARGET_DIR_ETC "/lsb-release");
+        ffCacheKeyAddUInt(&cache, instance.config.general.escapeBedrock);
+        #endif
+        if (!ffCacheLoadStrbufs(&cache, sizeof(result) / sizeof(FFstrbuf), (FFstrbuf*) &result))
+        {
+            ffDetectOSImpl(&result);
+            ffCacheStoreStrbufs(&cache, sizeof(result) / sizeof(FFstrbuf), (const FFstrbuf*) &result);
+        }
     }
     return &result;
 }
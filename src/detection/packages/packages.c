@@ -1,12 +1,45 @@
 #include "packages.h"
+#include "common/scheduler.h"
+#include "detection/os/os.h"
 
 #include <stddef.h>
 
 void ffDetectPackagesImpl(FFPackagesResult* result, FFPackagesOptions* options);
 
+static struct {
+    FFSchedulerTask task;
+    FFPackagesOptions options;
+    FFPackagesResult result;
+} prefetch;
+
+static void prefetchPackagesImpl(FF_MAYBE_UNUSED void* data)
+{
+    ffDetectPackagesImpl(&prefetch.result, &prefetch.options);
+}
+
+void ffPreparePackages(FFPackagesOptions* options)
+{
+    if (prefetch.task.func)
+        return;
+
+    // Used by package managers detection but not thread safe. Make sure it has been initialized
+    ffDetectOS();
+
+    prefetch.options = *options;
+    prefetch.result = (FFPackagesResult) {};
+    ffStrbufInit(&prefetch.result.pacmanBranch);
+    ffSchedulerSubmit(&prefetch.task, "Packages", prefetchPackagesImpl, NULL);
+}
+
 const char* ffDetectPackages(FFPackagesResult* result, FFPackagesOptions* options)
 {
-    ffDetectPackagesImpl(result, options);
+    if (ffSchedulerWait(&prefetch.task))
+    {
+        ffStrbufDestroy(&result->pacmanBranch);
+        *result = prefetch.result;
+    }
+    else
+        ffDetectPackagesImpl(result, options);
 
     for(uint32_t i = 0; i < offsetof(FFPackagesResult, all) / sizeof(uint32_t); ++i)
         result->all += ((uint32_t *)result)[i];
@@ -40,4 +40,5 @@ typedef struct FFPackagesResult
     FFstrbuf pacmanBranch;
 } FFPackagesResult;
 
+void ffPreparePackages(FFPackagesOptions* options);
 const char* ffDetectPackages(FFPackagesResult* result, FFPackagesOptions* options);
@@ -13,7 +13,7 @@ static uint32_t getNumElements(const char* dirname, unsigned char type)
     uint32_t num_elements = 0;
 
     struct dirent *entry;
-    while((entry = readdir(dirp)) != NULL) {
+    while((entry = ffReadDir(dirp)) != NULL) {
         if(entry->d_type == type)
             ++num_elements;
     }
@@ -1,13 +1,19 @@
 #include "packages.h"
+#include "common/cache.h"
 #include "common/io/io.h"
 #include "common/parsing.h"
 #include "common/processing.h"
 #include "common/properties.h"
+#include "common/scheduler.h"
 #include "common/settings.h"
 #include "detection/os/os.h"
+#include "util/mallocHelper.h"
 #include "util/stringUtils.h"
 
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
 
 static uint32_t getNumElementsImpl(const char* dirname, unsigned char type)
 {
@@ -18,7 +24,7 @@ static uint32_t getNumElementsImpl(const char* dirname, unsigned char type)
     uint32_t num_elements = 0;
 
     struct dirent *entry;
-    while((entry = readdir(dirp)) != NULL) {
+    while((entry = ffReadDir(dirp)) != NULL) {
         if(entry->d_type == type)
             ++num_elements;
     }
@@ -38,24 +44,81 @@ static uint32_t getNumElements(FFstrbuf* baseDir, const char* dirname, unsigned
     return num_elements;
 }
 
-static uint32_t getNumStringsImpl(const char* filename, const char* needle)
+static uint32_t getNumDirs(FFstrbuf* baseDir, const char* dirname, FF_MAYBE_UNUSED const char* arg)
+{
+    return getNumElements(baseDir, dirname, DT_DIR);
+}
+
+static uint32_t getNumRegularFiles(FFstrbuf* baseDir, const char* dirname, FF_MAYBE_UNUSED const char* arg)
+{
+    return getNumElements(baseDir, dirname, DT_REG);
+}
+
+enum { FF_SCAN_BUFSIZ = 65536 };
+
+// Streams `filename` through a fixed buffer and counts the non-overlapping occurrences of `needle`, without reading the whole file into memory.
+// If `callback` is set, it gets the `trailing` bytes following every match (fewer only at the end of the file).
+// The search is done by memmem, which libc implements with SIMD
+static uint32_t scanFile(const char* filename, const char* needle, uint32_t trailing, void (*callback)(const char* tail, uint32_t tailLength, void* data), void* data)
 {
-    FF_STRBUF_AUTO_DESTROY content = ffStrbufCreate();
-    if (!ffReadFileBuffer(filename, &content))
+    int FF_AUTO_CLOSE_FD fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
         return 0;
+    ++ffStatCounters.filesOpened;
+
+    const uint32_t needleLength = (uint32_t) strlen(needle);
+    assert(needleLength > 0 && needleLength + trailing < FF_SCAN_BUFSIZ / 2);
 
+    // Too large for the stack of worker threads (e.g. 128 KiB by default on musl)
+    FF_AUTO_FREE char* buffer = malloc(FF_SCAN_BUFSIZ);
+    uint32_t length = 0; // including the bytes kept from the previous chunk
     uint32_t count = 0;
-    char *iter = content.chars;
-    size_t needleLength = strlen(needle);
-    while ((iter = memmem(iter, content.length - (size_t)(iter - content.chars), needle, needleLength)) != NULL)
+    bool eof = false;
+    while (!eof)
     {
-        ++count;
-        iter += needleLength;
+        ssize_t nRead = read(fd, buffer + length, FF_SCAN_BUFSIZ - length);
+        if (nRead > 0)
+        {
+            length += (uint32_t) nRead;
+            ffStatCounters.bytesRead += (uint64_t) nRead;
+        }
+        else if (nRead < 0 && errno == EINTR)
+            continue;
+        else
+            eof = true;
+
+        // A match must be followed by its trailing bytes, unless the file ends
+        uint32_t searchLength = eof ? length : length > trailing ? length - trailing : 0;
+        const char* end = buffer + searchLength;
+        const char* pos = buffer;
+        const char* match;
+        while ((match = memmem(pos, (size_t) (end - pos), needle, needleLength)) != NULL)
+        {
+            ++count;
+            pos = match + needleLength;
+            if (callback)
+            {
+                uint32_t available = (uint32_t) (buffer + length - pos);
+                callback(pos, available < trailing ? available : trailing, data);
+            }
+        }
+
+        // Keep the bytes that may begin a match which is completed by the next chunk
+        const char* keep = searchLength >= needleLength - 1 ? end - (needleLength - 1) : buffer;
+        if (keep < pos)
+            keep = pos;
+        length = (uint32_t) (buffer + length - keep);
+        memmove(buffer, keep, length);
     }
 
     return count;
 }
 
+static uint32_t getNumStringsImpl(const char* filename, const char* needle)
+{
+    return scanFile(filename, needle, 0, NULL, NULL);
+}
+
 static uint32_t getNumStrings(FFstrbuf* baseDir, const char* filename, const char* needle)
 {
     uint32_t baseDirLength = baseDir->length;
@@ -95,7 +158,7 @@ static uint32_t countFilesRecursiveImpl(FFstrbuf* baseDirPath, const char* filen
     uint32_t sum = 0;
 
     struct dirent *entry;
-    while((entry = readdir(dirp)) != NULL) {
+    while((entry = ffReadDir(dirp)) != NULL) {
         // According to the PMS, neither category nor package name can begin with '.', so no need to check for . or .. specifically
         if(entry->d_type != DT_DIR || entry->d_name[0] == '.')
             continue;
@@ -166,50 +229,19 @@ static bool isValidNixPkg(FFstrbuf* pkg)
     return state == MATCH;
 }
 
-static bool checkNixCache(FFstrbuf* cacheDir, FFstrbuf* hash, uint32_t* count)
-{
-    if (!ffPathExists(cacheDir->chars, FF_PATHTYPE_FILE))
-        return false;
-
-    FF_STRBUF_AUTO_DESTROY cacheContent = ffStrbufCreate();
-    if (!ffReadFileBuffer(cacheDir->chars, &cacheContent))
-        return false;
-
-    // Format: <hash>\n<count>
-    uint32_t split = ffStrbufFirstIndexC(&cacheContent, '\n');
-    if (split == cacheContent.length)
-        return false;
-
-    ffStrbufSetNS(hash, split, cacheContent.chars);
-    *count = (uint32_t)atoi(cacheContent.chars + split + 1);
-
-    return true;
-}
-
-static bool writeNixCache(FFstrbuf* cacheDir, FFstrbuf* hash, uint32_t count)
-{
-    FF_STRBUF_AUTO_DESTROY cacheContent = ffStrbufCreateCopy(hash);
-    ffStrbufAppendF(&cacheContent, "\n%u", count);
-    return ffWriteFileBuffer(cacheDir->chars, &cacheContent);
-}
-
 static uint32_t getNixPackagesImpl(char* path)
 {
     //Nix detection is kinda slow, so we only do it if the dir exists
     if(!ffPathExists(path, FF_PATHTYPE_DIRECTORY))
         return 0;
 
-    FF_STRBUF_AUTO_DESTROY cacheDir = ffStrbufCreateCopy(&instance.state.platform.cacheDir);
-    ffStrbufEnsureEndsWithC(&cacheDir, '/');
-    ffStrbufAppendS(&cacheDir, "fastfetch/packages/nix");
-    ffStrbufAppendS(&cacheDir, path);
+    FF_STRBUF_AUTO_DESTROY cacheName = ffStrbufCreateS("packages/nix");
+    ffStrbufAppendS(&cacheName, path);
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    ffCacheEntryInit(&cache, cacheName.chars);
 
     //Check the hash first to determine if we need to recompute the count
-    FF_STRBUF_AUTO_DESTROY hash = ffStrbufCreateA(64);
-    FF_STRBUF_AUTO_DESTROY cacheHash = ffStrbufCreateA(64);
-    uint32_t count = 0;
-
-    ffProcessAppendStdOut(&hash, (char* const[]) {
+    ffProcessAppendStdOut(&cache.key, (char* const[]) {
         "nix-store",
         "--query",
         "--hash",
@@ -217,7 +249,8 @@ static uint32_t getNixPackagesImpl(char* path)
         NULL
     });
 
-    if (checkNixCache(&cacheDir, &cacheHash, &count) && ffStrbufEqual(&hash, &cacheHash))
+    uint32_t count = 0;
+    if (ffCacheLoad(&cache) && ffCacheGetData(&cache, sizeof(count), &count))
         return count;
 
     //Cache is invalid, recompute the count
@@ -256,11 +289,13 @@ static uint32_t getNixPackagesImpl(char* path)
         lineLength = 0;
     }
 
-    writeNixCache(&cacheDir, &hash, count);
+    ffStrbufClear(&cache.data);
+    ffCachePutData(&cache, sizeof(count), &count);
+    ffCacheStore(&cache);
     return count;
 }
 
-static uint32_t getNixPackages(FFstrbuf* baseDir, const char* dirname)
+static uint32_t getNixPackages(FFstrbuf* baseDir, const char* dirname, FF_MAYBE_UNUSED const char* arg)
 {
     uint32_t baseDirLength = baseDir->length;
     ffStrbufAppendS(baseDir, dirname);
@@ -278,7 +313,7 @@ static uint32_t getXBPSImpl(FFstrbuf* baseDir)
     uint32_t result = 0;
 
     struct dirent *entry;
-    while((entry = readdir(dir)) != NULL)
+    while((entry = ffReadDir(dir)) != NULL)
     {
         if(entry->d_type != DT_REG || !ffStrStartsWithIgnCase(entry->d_name, "pkgdb-"))
             continue;
@@ -293,7 +328,7 @@ static uint32_t getXBPSImpl(FFstrbuf* baseDir)
     return result;
 }
 
-static uint32_t getXBPS(FFstrbuf* baseDir, const char* dirname)
+static uint32_t getXBPS(FFstrbuf* baseDir, const char* dirname, FF_MAYBE_UNUSED const char* arg)
 {
     uint32_t baseDirLength = baseDir->length;
     ffStrbufAppendS(baseDir, dirname);
@@ -302,7 +337,7 @@ static uint32_t getXBPS(FFstrbuf* baseDir, const char* dirname)
     return result;
 }
 
-static uint32_t getSnap(FFstrbuf* baseDir)
+static uint32_t getSnap(FFstrbuf* baseDir, FF_MAYBE_UNUSED const char* dirname, FF_MAYBE_UNUSED const char* arg)
 {
     uint32_t result = getNumElements(baseDir, "/snap", DT_DIR);
 
@@ -358,7 +393,22 @@ static uint32_t getRpmFromLibrpm(void)
 
 #endif //FF_HAVE_RPM
 
-static uint32_t getAM(FFstrbuf* baseDir)
+static uint32_t getRpm(FFstrbuf* baseDir, const char* dbPath, const char* query)
+{
+    uint32_t count = getSQLite3Int(baseDir, dbPath, query);
+
+    // If SQL failed, we can still try with librpm.
+    // This is needed on openSUSE, which seems to use a proprietary database file
+    // This method doesn't work on bedrock strata. It is done after all of them there
+    #ifdef FF_HAVE_RPM
+        if(count == 0 && ffStrbufEqualS(baseDir, FASTFETCH_TARGET_DIR_ROOT))
+            count = getRpmFromLibrpm();
+    #endif
+
+    return count;
+}
+
+static uint32_t getAM(FFstrbuf* baseDir, FF_MAYBE_UNUSED const char* dirname, FF_MAYBE_UNUSED const char* arg)
 {
     // #771
     uint32_t baseDirLength = baseDir->length;
@@ -377,7 +427,7 @@ static uint32_t getAM(FFstrbuf* baseDir)
         if(dirp)
         {
             struct dirent *entry;
-            while ((entry = readdir(dirp)) != NULL)
+            while ((entry = ffReadDir(dirp)) != NULL)
             {
                 if (entry->d_name[0] == '.') continue;
                 if (entry->d_type == DT_DIR)
@@ -400,36 +450,33 @@ static int compareHash(const void* a, const void* b)
     return memcmp(a, b, 32);
 }
 
-static uint32_t getGuixPackagesImpl(char* filename)
+static void appendGuixHash(const char* tail, uint32_t tailLength, void* data)
 {
-    FF_STRBUF_AUTO_DESTROY content = ffStrbufCreate();
-    if (!ffAppendFileBuffer(filename, &content))
-        return 0;
+    if (tailLength == 32)
+        ffStrbufAppendNS((FFstrbuf*) data, 32, tail);
+}
 
+static uint32_t getGuixPackagesImpl(char* filename)
+{
     // Count number of unique /gnu/store/ paths in PROFILE/manifest based on their hash value.
     // Contains packages explicitly installed and their propagated inputs.
-    char* pend = content.chars;
+    FF_STRBUF_AUTO_DESTROY hashes = ffStrbufCreate();
+    scanFile(filename, "/gnu/store/", 32, appendGuixHash, &hashes);
 
-    for (const char* pattern = content.chars; (pattern = strstr(pattern, "/gnu/store/")); pattern += 32)
-    {
-        pattern += strlen("/gnu/store/");
-        memmove(pend, pattern, 32);
-        pend += 32;
-    }
-
-    if (pend == content.chars)
+    if (hashes.length == 0)
         return 0;
 
-    qsort(content.chars, (size_t) (pend - content.chars) / 32, 32, compareHash);
+    const char* pend = hashes.chars + hashes.length;
+    qsort(hashes.chars, hashes.length / 32, 32, compareHash);
 
     uint32_t count = 1;
-    for (const char* p = content.chars + 32; p < pend; p += 32)
+    for (const char* p = hashes.chars + 32; p < pend; p += 32)
         count += compareHash(p - 32, p) != 0;
 
     return count;
 }
 
-static uint32_t getGuixPackages(FFstrbuf* baseDir, const char* dirname)
+static uint32_t getGuixPackages(FFstrbuf* baseDir, const char* dirname, FF_MAYBE_UNUSED const char* arg)
 {
     uint32_t baseDirLength = baseDir->length;
     ffStrbufAppendS(baseDir, dirname);
@@ -439,55 +486,140 @@ static uint32_t getGuixPackages(FFstrbuf* baseDir, const char* dirname)
     return num_elements;
 }
 
-static void getPackageCounts(FFstrbuf* baseDir, FFPackagesResult* packageCounts, FFPackagesOptions* options)
+typedef struct FFPackagesProbe
 {
-    if (!(options->disabled & FF_PACKAGES_FLAG_APK_BIT)) packageCounts->apk += getNumStrings(baseDir, "/lib/apk/db/installed", "C:Q");
-    if (!(options->disabled & FF_PACKAGES_FLAG_DPKG_BIT)) packageCounts->dpkg += getNumStrings(baseDir, "/var/lib/dpkg/status", "Status: install ok installed");
-    if (!(options->disabled & FF_PACKAGES_FLAG_LPKG_BIT)) packageCounts->lpkg += getNumStrings(baseDir, "/opt/Loc-OS-LPKG/installed-lpkg/Listinstalled-lpkg.list", "\n");
-    if (!(options->disabled & FF_PACKAGES_FLAG_EMERGE_BIT)) packageCounts->emerge += countFilesRecursive(baseDir, "/var/db/pkg", "SIZE");
-    if (!(options->disabled & FF_PACKAGES_FLAG_EOPKG_BIT)) packageCounts->eopkg += getNumElements(baseDir, "/var/lib/eopkg/package", DT_DIR);
-    if (!(options->disabled & FF_PACKAGES_FLAG_FLATPAK_BIT)) packageCounts->flatpakSystem += getNumElements(baseDir, "/var/lib/flatpak/app", DT_DIR);
-    if (!(options->disabled & FF_PACKAGES_FLAG_NIX_BIT))
-    {
-        packageCounts->nixDefault += getNixPackages(baseDir, "/nix/var/nix/profiles/default");
-        packageCounts->nixSystem += getNixPackages(baseDir, "/run/current-system");
-    }
-    if (!(options->disabled & FF_PACKAGES_FLAG_PACMAN_BIT)) packageCounts->pacman += getNumElements(baseDir, "/var/lib/pacman/local", DT_DIR);
-    if (!(options->disabled & FF_PACKAGES_FLAG_LPKGBUILD_BIT)) packageCounts->lpkgbuild += getNumElements(baseDir, "/opt/Loc-OS-LPKG/lpkgbuild/remove", DT_REG);
-    if (!(options->disabled & FF_PACKAGES_FLAG_PKGTOOL_BIT)) packageCounts->pkgtool += getNumElements(baseDir, "/var/log/packages", DT_REG);
-    if (!(options->disabled & FF_PACKAGES_FLAG_RPM_BIT)) packageCounts->rpm += getSQLite3Int(baseDir, "/var/lib/rpm/rpmdb.sqlite", "SELECT count(*) FROM Packages");
-    if (!(options->disabled & FF_PACKAGES_FLAG_SNAP_BIT)) packageCounts->snap += getSnap(baseDir);
-    if (!(options->disabled & FF_PACKAGES_FLAG_XBPS_BIT)) packageCounts->xbps += getXBPS(baseDir, "/var/db/xbps");
-    if (!(options->disabled & FF_PACKAGES_FLAG_BREW_BIT))
-    {
-        packageCounts->brewCask += getNumElements(baseDir, "/home/linuxbrew/.linuxbrew/Caskroom", DT_DIR);
-        packageCounts->brew += getNumElements(baseDir, "/home/linuxbrew/.linuxbrew/Cellar", DT_DIR);
-    }
-    if (!(options->disabled & FF_PACKAGES_FLAG_PALUDIS_BIT)) packageCounts->paludis += countFilesRecursive(baseDir, "/var/db/paludis/repositories", "environment.bz2");
-    if (!(options->disabled & FF_PACKAGES_FLAG_OPKG_BIT)) packageCounts->opkg += getNumStrings(baseDir, "/usr/lib/opkg/status", "Package:"); // openwrt
-    if (!(options->disabled & FF_PACKAGES_FLAG_AM_BIT)) packageCounts->am = getAM(baseDir);
-    if (!(options->disabled & FF_PACKAGES_FLAG_SORCERY_BIT)) packageCounts->sorcery += getNumStrings(baseDir, "/var/state/sorcery/packages", ":installed:");
-    if (!(options->disabled & FF_PACKAGES_FLAG_GUIX_BIT))
+    FFPackagesFlags flag;
+    const char* name; // cache file name
+    uint32_t offset; // of the counter in FFPackagesResult
+    uint32_t (*count)(FFstrbuf* baseDir, const char* path, const char* arg);
+    const char* path;
+    const char* arg;
+    const char* keys[3]; // files or directories updated when packages are installed or removed
+    bool ttl; // records installed packages in nested directories; don't trust the cache for too long
+} FFPackagesProbe;
+
+// Paths are relative to the root of a system, or of a bedrock stratum
+static const FFPackagesProbe rootProbes[] = {
+    { FF_PACKAGES_FLAG_APK_BIT, "apk", offsetof(FFPackagesResult, apk), getNumStrings, "/lib/apk/db/installed", "C:Q", { "/lib/apk/db/installed" }, false },
+    { FF_PACKAGES_FLAG_DPKG_BIT, "dpkg", offsetof(FFPackagesResult, dpkg), getNumStrings, "/var/lib/dpkg/status", "Status: install ok installed", { "/var/lib/dpkg/status" }, false },
+    { FF_PACKAGES_FLAG_LPKG_BIT, "lpkg", offsetof(FFPackagesResult, lpkg), getNumStrings, "/opt/Loc-OS-LPKG/installed-lpkg/Listinstalled-lpkg.list", "\n", { "/opt/Loc-OS-LPKG/installed-lpkg/Listinstalled-lpkg.list" }, false },
+    { FF_PACKAGES_FLAG_EMERGE_BIT, "emerge", offsetof(FFPackagesResult, emerge), countFilesRecursive, "/var/db/pkg", "SIZE", { "/var/lib/portage/world", "/var/db/pkg" }, true },
+    { FF_PACKAGES_FLAG_EOPKG_BIT, "eopkg", offsetof(FFPackagesResult, eopkg), getNumDirs, "/var/lib/eopkg/package", NULL, { "/var/lib/eopkg/package" }, false },
+    { FF_PACKAGES_FLAG_FLATPAK_BIT, "flatpak-system", offsetof(FFPackagesResult, flatpakSystem), getNumDirs, "/var/lib/flatpak/app", NULL, { "/var/lib/flatpak/app" }, false },
+    { FF_PACKAGES_FLAG_NIX_BIT, "nix-default", offsetof(FFPackagesResult, nixDefault), getNixPackages, "/nix/var/nix/profiles/default", NULL, { "/nix/var/nix/profiles/default" }, false },
+    { FF_PACKAGES_FLAG_NIX_BIT, "nix-system", offsetof(FFPackagesResult, nixSystem), getNixPackages, "/run/current-system", NULL, { "/run/current-system" }, false },
+    { FF_PACKAGES_FLAG_PACMAN_BIT, "pacman", offsetof(FFPackagesResult, pacman), getNumDirs, "/var/lib/pacman/local", NULL, { "/var/lib/pacman/local" }, false },
+    { FF_PACKAGES_FLAG_LPKGBUILD_BIT, "lpkgbuild", offsetof(FFPackagesResult, lpkgbuild), getNumRegularFiles, "/opt/Loc-OS-LPKG/lpkgbuild/remove", NULL, { "/opt/Loc-OS-LPKG/lpkgbuild/remove" }, false },
+    { FF_PACKAGES_FLAG_PKGTOOL_BIT, "pkgtool", offsetof(FFPackagesResult, pkgtool), getNumRegularFiles, "/var/log/packages", NULL, { "/var/log/packages" }, false },
+    { FF_PACKAGES_FLAG_RPM_BIT, "rpm", offsetof(FFPackagesResult, rpm), getRpm, "/var/lib/rpm/rpmdb.sqlite", "SELECT count(*) FROM Packages", { "/var/lib/rpm/rpmdb.sqlite", "/var/lib/rpm", FASTFETCH_TARGET_DIR_USR "/lib/sysimage/rpm" }, false },
+    { FF_PACKAGES_FLAG_SNAP_BIT, "snap", offsetof(FFPackagesResult, snap), getSnap, NULL, NULL, { "/snap", "/var/lib/snapd/snap" }, false },
+    { FF_PACKAGES_FLAG_XBPS_BIT, "xbps", offsetof(FFPackagesResult, xbps), getXBPS, "/var/db/xbps", NULL, { "/var/db/xbps" }, false },
+    { FF_PACKAGES_FLAG_BREW_BIT, "brew-cask", offsetof(FFPackagesResult, brewCask), getNumDirs, "/home/linuxbrew/.linuxbrew/Caskroom", NULL, { "/home/linuxbrew/.linuxbrew/Caskroom" }, false },
+    { FF_PACKAGES_FLAG_BREW_BIT, "brew", offsetof(FFPackagesResult, brew), getNumDirs, "/home/linuxbrew/.linuxbrew/Cellar", NULL, { "/home/linuxbrew/.linuxbrew/Cellar" }, false },
+    { FF_PACKAGES_FLAG_PALUDIS_BIT, "paludis", offsetof(FFPackagesResult, paludis), countFilesRecursive, "/var/db/paludis/repositories", "environment.bz2", { "/var/db/paludis/repositories" }, true },
+    { FF_PACKAGES_FLAG_OPKG_BIT, "opkg", offsetof(FFPackagesResult, opkg), getNumStrings, "/usr/lib/opkg/status", "Package:", { "/usr/lib/opkg/status" }, false }, // openwrt
+    { FF_PACKAGES_FLAG_AM_BIT, "am", offsetof(FFPackagesResult, am), getAM, NULL, NULL, { "/opt/am/APP-MANAGER", "/opt" }, false },
+    { FF_PACKAGES_FLAG_SORCERY_BIT, "sorcery", offsetof(FFPackagesResult, sorcery), getNumStrings, "/var/state/sorcery/packages", ":installed:", { "/var/state/sorcery/packages" }, false },
+    { FF_PACKAGES_FLAG_GUIX_BIT, "guix-system", offsetof(FFPackagesResult, guixSystem), getGuixPackages, "/run/current-system/profile", NULL, { "/run/current-system/profile/manifest" }, false },
+};
+
+// Paths are relative to the home directory
+static const FFPackagesProbe homeProbes[] = {
+    { FF_PACKAGES_FLAG_NIX_BIT, "nix-user", offsetof(FFPackagesResult, nixUser), getNixPackages, ".nix-profile", NULL, { ".nix-profile" }, false },
+    { FF_PACKAGES_FLAG_GUIX_BIT, "guix-user", offsetof(FFPackagesResult, guixUser), getGuixPackages, ".guix-profile", NULL, { ".guix-profile/manifest" }, false },
+    { FF_PACKAGES_FLAG_GUIX_BIT, "guix-home", offsetof(FFPackagesResult, guixHome), getGuixPackages, ".guix-home/profile", NULL, { ".guix-home/profile/manifest" }, false },
+    { FF_PACKAGES_FLAG_FLATPAK_BIT, "flatpak-user", offsetof(FFPackagesResult, flatpakUser), getNumDirs, ".local/share/flatpak/app", NULL, { ".local/share/flatpak/app" }, false },
+};
+
+// Paths are relative to $XDG_STATE_HOME
+static const FFPackagesProbe stateProbes[] = {
+    { FF_PACKAGES_FLAG_NIX_BIT, "nix-user-state", offsetof(FFPackagesResult, nixUser), getNixPackages, "nix/profile", NULL, { "nix/profile" }, false },
+};
+
+typedef struct FFPackagesJob
+{
+    FFSchedulerTask task;
+    const FFPackagesProbe* probe;
+    FFstrbuf baseDir;
+    FFstrbuf cacheName;
+    FFCacheEntry cache;
+    uint32_t count;
+} FFPackagesJob;
+
+static void addJobs(FFlist* jobs, const FFstrbuf* baseDir, const char* cacheDir, uint32_t probeCount, const FFPackagesProbe* probes, FFPackagesOptions* options)
+{
+    FF_STRBUF_AUTO_DESTROY path = ffStrbufCreate();
+    for (uint32_t i = 0; i < probeCount; ++i)
     {
-      packageCounts->guixSystem += getGuixPackages(baseDir, "/run/current-system/profile");
+        const FFPackagesProbe* probe = &probes[i];
+        if (options->disabled & probe->flag)
+            continue;
+
+        FFCacheEntry cache;
+        ffCacheEntryInit(&cache, NULL);
+        ffStrbufAppend(&cache.key, baseDir);
+        ffStrbufAppendC(&cache.key, ' ');
+
+        bool exists = false;
+        for (uint32_t j = 0; j < sizeof(probe->keys) / sizeof(probe->keys[0]) && probe->keys[j]; ++j)
+        {
+            ffStrbufSet(&path, baseDir);
+            ffStrbufAppendS(&path, probe->keys[j]);
+            exists |= ffCacheKeyAddFile(&cache, path.chars);
+        }
+        if (!exists)
+        {
+            // The package manager isn't installed. Neither counting nor caching is needed
+            ffCacheEntryDestroy(&cache);
+            continue;
+        }
+
+        if (probe->ttl)
+            ffCacheKeyAddTtl(&cache, 3600);
+
+        FFPackagesJob* job = ffListAdd(jobs);
+        *job = (FFPackagesJob) { .probe = probe, .cache = cache };
+        ffStrbufInitCopy(&job->baseDir, baseDir);
+        ffStrbufInitF(&job->cacheName, "packages/%s%s", cacheDir, probe->name);
+        job->cache.name = job->cacheName.chars;
     }
 }
 
-static void getPackageCountsRegular(FFstrbuf* baseDir, FFPackagesResult* packageCounts, FFPackagesOptions* options)
+static void runJob(void* data)
 {
-    getPackageCounts(baseDir, packageCounts, options);
+    FFPackagesJob* job = data;
+    if (ffCacheLoad(&job->cache) && ffCacheGetData(&job->cache, sizeof(job->count), &job->count))
+        return;
+
+    job->count = job->probe->count(&job->baseDir, job->probe->path, job->probe->arg);
 
-    if (!(options->disabled & FF_PACKAGES_FLAG_PACMAN_BIT))
+    ffStrbufClear(&job->cache.data);
+    ffCachePutData(&job->cache, sizeof(job->count), &job->count);
+    ffCacheStore(&job->cache);
+}
+
+static void runJobs(FFlist* jobs, FFPackagesResult* result)
+{
+    // Probes are independent of each other. Each one reads its own database, or spawns nix-store
+    if (instance.config.general.multithreading)
     {
-        uint32_t baseDirLength = baseDir->length;
-        ffStrbufAppendS(baseDir, FASTFETCH_TARGET_DIR_ETC "/pacman-mirrors.conf");
-        if(ffParsePropFile(baseDir->chars, "Branch =", &packageCounts->pacmanBranch) && packageCounts->pacmanBranch.length == 0)
-            ffStrbufAppendS(&packageCounts->pacmanBranch, "stable");
-        ffStrbufSubstrBefore(baseDir, baseDirLength);
+        FF_LIST_FOR_EACH(FFPackagesJob, job, *jobs)
+            ffSchedulerSubmit(&job->task, job->probe->name, runJob, job);
+    }
+
+    FF_LIST_FOR_EACH(FFPackagesJob, job, *jobs)
+    {
+        if (!ffSchedulerWait(&job->task))
+            runJob(job);
+        *(uint32_t*) ((uint8_t*) result + job->probe->offset) += job->count;
+
+        ffCacheEntryDestroy(&job->cache);
+        ffStrbufDestroy(&job->cacheName);
+        ffStrbufDestroy(&job->baseDir);
     }
 }
 
-static void getPackageCountsBedrock(FFstrbuf* baseDir, FFPackagesResult* packageCounts, FFPackagesOptions* options)
+static void addJobsBedrock(FFlist* jobs, FFstrbuf* baseDir, FFPackagesOptions* options)
 {
     uint32_t baseDirLength = baseDir->length;
 
@@ -503,8 +635,9 @@ static void getPackageCountsBedrock(FFstrbuf* baseDir, FFPackagesResult* package
     ffStrbufAppendC(baseDir, '/');
     uint32_t baseDirLength2 = baseDir->length;
 
+    FF_STRBUF_AUTO_DESTROY cacheDir = ffStrbufCreate();
     struct dirent* entry;
-    while((entry = readdir(dir)) != NULL)
+    while((entry = ffReadDir(dir)) != NULL)
     {
         if(entry->d_type != DT_DIR)
             continue;
@@ -512,7 +645,8 @@ static void getPackageCountsBedrock(FFstrbuf* baseDir, FFPackagesResult* package
             continue;
 
         ffStrbufAppendS(baseDir, entry->d_name);
-        getPackageCounts(baseDir, packageCounts, options);
+        ffStrbufSetF(&cacheDir, "bedrock/%s/", entry->d_name);
+        addJobs(jobs, baseDir, cacheDir.chars, sizeof(rootProbes) / sizeof(rootProbes[0]), rootProbes, options);
         ffStrbufSubstrBefore(baseDir, baseDirLength2);
     }
 
@@ -521,58 +655,48 @@ static void getPackageCountsBedrock(FFstrbuf* baseDir, FFPackagesResult* package
 
 void ffDetectPackagesImpl(FFPackagesResult* result, FFPackagesOptions* options)
 {
+    *result = (FFPackagesResult) { .pacmanBranch = result->pacmanBranch };
+    ffStrbufClear(&result->pacmanBranch);
+
+    FF_LIST_AUTO_DESTROY jobs = ffListCreate(sizeof(FFPackagesJob));
+
     FF_STRBUF_AUTO_DESTROY baseDir = ffStrbufCreateA(512);
     ffStrbufAppendS(&baseDir, FASTFETCH_TARGET_DIR_ROOT);
 
-    if(ffStrbufIgnCaseEqualS(&ffDetectOS()->id, "bedrock"))
-        getPackageCountsBedrock(&baseDir, result, options);
+    // Package databases of all strata have to be checked
+    bool bedrock = ffStrbufIgnCaseEqualS(&ffDetectOS()->id, "bedrock");
+    if(bedrock)
+        addJobsBedrock(&jobs, &baseDir, options);
     else
-        getPackageCountsRegular(&baseDir, result, options);
-
-    // If SQL failed, we can still try with librpm.
-    // This is needed on openSUSE, which seems to use a proprietary database file
-    // This method doesn't work on bedrock, so we do it here.
-    #ifdef FF_HAVE_RPM
-        if(!(options->disabled & FF_PACKAGES_FLAG_RPM_BIT) && result->rpm == 0)
-            result->rpm = getRpmFromLibrpm();
-    #endif
+        addJobs(&jobs, &baseDir, "", sizeof(rootProbes) / sizeof(rootProbes[0]), rootProbes, options);
 
     ffStrbufSet(&baseDir, &instance.state.platform.homeDir);
-    if (!(options->disabled & FF_PACKAGES_FLAG_NIX_BIT))
+    addJobs(&jobs, &baseDir, "", sizeof(homeProbes) / sizeof(homeProbes[0]), homeProbes, options);
+
+    const char* stateHome = getenv("XDG_STATE_HOME");
+    if(ffStrSet(stateHome))
     {
-        // check if ~/.nix-profile exists
-        FF_STRBUF_AUTO_DESTROY profilePath = ffStrbufCreateCopy(&baseDir);
-        ffStrbufAppendS(&profilePath, ".nix-profile");
-        if (ffPathExists(profilePath.chars, FF_PATHTYPE_DIRECTORY))
-        {
-            result->nixUser += getNixPackages(&baseDir, ".nix-profile");
-        }
+        ffStrbufSetS(&baseDir, stateHome);
+        ffStrbufEnsureEndsWithC(&baseDir, '/');
+    }
+    else
+    {
+        ffStrbufSet(&baseDir, &instance.state.platform.homeDir);
+        ffStrbufAppendS(&baseDir, ".local/state/");
+    }
+    addJobs(&jobs, &baseDir, "", sizeof(stateProbes) / sizeof(stateProbes[0]), stateProbes, options);
 
-        // check if $XDG_STATE_HOME/nix/profile exists
-        FF_STRBUF_AUTO_DESTROY stateDir = ffStrbufCreate();
-        const char* stateHome = getenv("XDG_STATE_HOME");
-        if(ffStrSet(stateHome))
-        {
-            ffStrbufSetS(&stateDir, stateHome);
-            ffStrbufEnsureEndsWithC(&stateDir, '/');
-        }
-        else
-        {
-            ffStrbufSet(&stateDir, &instance.state.platform.homeDir);
-            ffStrbufAppendS(&stateDir, ".local/state/");
-        }
+    runJobs(&jobs, result);
 
-        ffStrbufSet(&profilePath, &stateDir);
-        ffStrbufAppendS(&profilePath, "nix/profile");
-        result->nixUser += getNixPackages(&stateDir, "nix/profile");
-    }
+    #ifdef FF_HAVE_RPM
+        if(bedrock && !(options->disabled & FF_PACKAGES_FLAG_RPM_BIT) && result->rpm == 0)
+            result->rpm = getRpmFromLibrpm();
+    #endif
 
-    if (!(options->disabled & FF_PACKAGES_FLAG_GUIX_BIT))
+    if (!bedrock && !(options->disabled & FF_PACKAGES_FLAG_PACMAN_BIT))
     {
-       result->guixUser += getGuixPackages(&baseDir, ".guix-profile");
-       result->guixHome += getGuixPackages(&baseDir, ".guix-home/profile");
+        ffStrbufSetS(&baseDir, FASTFETCH_TARGET_DIR_ROOT FASTFETCH_TARGET_DIR_ETC "/pacman-mirrors.conf");
+        if(ffParsePropFile(baseDir.chars, "Branch =", &result->pacmanBranch) && result->pacmanBranch.length == 0)
+            ffStrbufAppendS(&result->pacmanBranch, "stable");
     }
-
-    if (!(options->disabled & FF_PACKAGES_FLAG_FLATPAK_BIT))
-        result->flatpakUser = getNumElements(&baseDir, "/.local/share/flatpak/app", DT_DIR);
 }
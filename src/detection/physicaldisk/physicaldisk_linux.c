@@ -12,29 +12,29 @@ const char* ffDetectPhysicalDisk(FFlist* result, FFPhysicalDiskOptions* options)
     FF_AUTO_CLOSE_DIR DIR* sysBlockDirp = opendir("/sys/block/");
     if(sysBlockDirp == NULL)
         return "opendir(\"/sys/block/\") == NULL";
+    int sysBlockFd = dirfd(sysBlockDirp);
 
     struct dirent* sysBlockEntry;
-    while ((sysBlockEntry = readdir(sysBlockDirp)) != NULL)
+    while ((sysBlockEntry = ffReadDir(sysBlockDirp)) != NULL)
     {
         const char* const devName = sysBlockEntry->d_name;
 
         if (devName[0] == '.')
             continue;
 
-        char pathSysBlock[PATH_MAX];
-        snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s", devName);
-
         char pathSysDeviceReal[PATH_MAX];
-        ssize_t pathLength = readlink(pathSysBlock, pathSysDeviceReal, sizeof(pathSysDeviceReal) - 1);
-        if (pathLength < 0)
+        if (ffReadLinkRelative(sysBlockFd, devName, sizeof(pathSysDeviceReal), pathSysDeviceReal) < 0)
             continue;
-        pathSysDeviceReal[pathLength] = '\0';
 
         if (strstr(pathSysDeviceReal, "/virtual/")) // virtual device
             continue;
 
-        snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device", devName);
-        if (!ffPathExists(pathSysBlock, FF_PATHTYPE_DIRECTORY))
+        // Attributes are read relative to these, instead of resolving /sys/block/<devName>/... every time
+        int FF_AUTO_CLOSE_FD blockFd = ffOpenDirRelative(sysBlockFd, devName);
+        if (blockFd < 0)
+            continue;
+        int FF_AUTO_CLOSE_FD deviceFd = ffOpenDirRelative(blockFd, "device");
+        if (deviceFd < 0)
             continue;
 
         FFPhysicalDiskResult* device = (FFPhysicalDiskResult*) ffListAdd(result);
@@ -42,16 +42,14 @@ const char* ffDetectPhysicalDisk(FFlist* result, FFPhysicalDiskOptions* options)
         ffStrbufInit(&device->name);
 
         {
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device/vendor", devName);
-            if (ffAppendFileBuffer(pathSysBlock, &device->name))
+            if (ffAppendFileBufferRelative(deviceFd, "vendor", &device->name))
             {
                 ffStrbufTrimRightSpace(&device->name);
                 if (device->name.length > 0)
                     ffStrbufAppendC(&device->name, ' ');
             }
 
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device/model", devName);
-            ffAppendFileBuffer(pathSysBlock, &device->name);
+            ffAppendFileBufferRelative(deviceFd, "model", &device->name);
             ffStrbufTrimRightSpace(&device->name);
 
             if (device->name.length == 0)
@@ -64,8 +62,10 @@ const char* ffDetectPhysicalDisk(FFlist* result, FFPhysicalDiskOptions* options)
                     bool multiNs = nsid > 1;
                     if (!multiNs)
                     {
-                        snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device/nvme%dn2", devName, devid);
-                        multiNs = ffPathExists(pathSysBlock, FF_PATHTYPE_DIRECTORY);
+                        char nsName[32];
+                        snprintf(nsName, sizeof(nsName), "nvme%dn2", devid);
+                        struct stat nsStat;
+                        multiNs = fstatat(deviceFd, nsName, &nsStat, 0) == 0 && S_ISDIR(nsStat.st_mode);
                     }
                     if (multiNs)
                     {
@@ -97,64 +97,45 @@ const char* ffDetectPhysicalDisk(FFlist* result, FFPhysicalDiskOptions* options)
                 ffStrbufSetS(&device->interconnect, "SCSI");
             else
             {
-                snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device/transport", devName);
-                if (ffAppendFileBuffer(pathSysBlock, &device->interconnect))
+                if (ffAppendFileBufferRelative(deviceFd, "transport", &device->interconnect))
                     ffStrbufTrimRightSpace(&device->interconnect);
             }
         }
 
         {
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/queue/rotational", devName);
             char isRotationalChar = '1';
-            if (ffReadFileData(pathSysBlock, 1, &isRotationalChar) > 0)
+            if (ffReadFileDataRelative(blockFd, "queue/rotational", 1, &isRotationalChar) > 0)
                 device->type |= isRotationalChar == '1' ? FF_PHYSICALDISK_TYPE_HDD : FF_PHYSICALDISK_TYPE_SSD;
         }
 
         {
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/size", devName);
-            char blkSize[32];
-            ssize_t fileSize = ffReadFileData(pathSysBlock, sizeof(blkSize) - 1, blkSize);
-            if (fileSize > 0)
-            {
-                blkSize[fileSize] = 0;
-                device->size = (uint64_t) strtoul(blkSize, NULL, 10) * 512;
-            }
-            else
-                device->size = 0;
+            uint64_t blkSize;
+            device->size = ffReadFileUInt64Relative(blockFd, "size", &blkSize) ? blkSize * 512 : 0;
         }
 
         {
             char removableChar = '0';
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/removable", devName);
-            if (ffReadFileData(pathSysBlock, 1, &removableChar) > 0)
+            if (ffReadFileDataRelative(blockFd, "removable", 1, &removableChar) > 0)
                 device->type |= removableChar == '1' ? FF_PHYSICALDISK_TYPE_REMOVABLE : FF_PHYSICALDISK_TYPE_FIXED;
         }
 
         {
             char roChar = '0';
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/ro", devName);
-            if (ffReadFileData(pathSysBlock, 1, &roChar) > 0)
+            if (ffReadFileDataRelative(blockFd, "ro", 1, &roChar) > 0)
                 device->type |= roChar == '1' ? FF_PHYSICALDISK_TYPE_READONLY : FF_PHYSICALDISK_TYPE_READWRITE;
         }
 
         {
             ffStrbufInit(&device->serial);
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device/serial", devName);
-            if (ffReadFileBuffer(pathSysBlock, &device->serial))
+            if (ffReadFileBufferRelative(deviceFd, "serial", &device->serial))
                 ffStrbufTrimRightSpace(&device->serial);
         }
 
         {
             ffStrbufInit(&device->revision);
-            snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device/firmware_rev", devName);
-            if (ffReadFileBuffer(pathSysBlock, &device->revision))
+            if (ffReadFileBufferRelative(deviceFd, "firmware_rev", &device->revision) ||
+                ffReadFileBufferRelative(deviceFd, "rev", &device->revision))
                 ffStrbufTrimRightSpace(&device->revision);
-            else
-            {
-                snprintf(pathSysBlock, PATH_MAX, "/sys/block/%s/device/rev", devName);
-                if (ffReadFileBuffer(pathSysBlock, &device->revision))
-                    ffStrbufTrimRightSpace(&device->revision);
-            }
         }
 
         device->temperature = FF_PHYSICALDISK_TEMP_UNSET;
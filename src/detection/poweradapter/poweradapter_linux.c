@@ -81,7 +81,7 @@ const char* ffDetectPowerAdapter(FFlist* results)
         return "opendir(\"/sys/class/power_supply/\") == NULL";
 
     struct dirent* entry;
-    while((entry = readdir(dirp)) != NULL)
+    while((entry = ffReadDir(dirp)) != NULL)
     {
         if(ffStrEquals(entry->d_name, ".") || ffStrEquals(entry->d_name, ".."))
             continue;
@@ -3,6 +3,19 @@
 #include "common/io/io.h"
 #include "util/stringUtils.h"
 
+#ifdef __linux__
+#include "common/procsnapshot.h"
+
+const char* ffDetectProcesses(uint32_t* result)
+{
+    const FFlist* snapshot = ffProcSnapshotGet();
+    if(snapshot == NULL)
+        return "open(\"/proc\") failed";
+
+    *result = snapshot->length;
+    return NULL;
+}
+#else
 const char* ffDetectProcesses(uint32_t* result)
 {
     FF_AUTO_CLOSE_DIR DIR* dir = opendir("/proc");
@@ -12,7 +25,7 @@ const char* ffDetectProcesses(uint32_t* result)
     uint32_t num = 0;
 
     struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL)
+    while ((entry = ffReadDir(dir)) != NULL)
     {
         if (
         #ifdef _DIRENT_HAVE_D_TYPE
@@ -26,3 +39,4 @@ const char* ffDetectProcesses(uint32_t* result)
 
     return NULL;
 }
+#endif
@@ -1,4 +1,5 @@
 #include "fastfetch.h"
+#include "common/cache.h"
 #include "common/io/io.h"
 #include "common/thread.h"
 #include "temps_linux.h"
@@ -6,51 +7,28 @@
 #include <string.h>
 #include <dirent.h>
 
-static bool parseHwmonDir(FFstrbuf* dir, FFTempValue* value)
+static bool parseHwmonDir(int dfd, FFTempValue* value)
 {
     //https://www.kernel.org/doc/Documentation/hwmon/sysfs-interface
-    uint32_t dirLength = dir->length;
-
-    FF_STRBUF_AUTO_DESTROY valueBuffer = ffStrbufCreate();
-
-    ffStrbufAppendS(dir, "temp1_input");
-    if(!ffReadFileBuffer(dir->chars, &valueBuffer))
+    int64_t milliCelsius;
+    if(!ffReadFileInt64Relative(dfd, "temp1_input", &milliCelsius))
         return false;
 
-    ffStrbufSubstrBefore(dir, dirLength);
+    value->value = (double) milliCelsius / 1000;
 
-    value->value = ffStrbufToDouble(&valueBuffer) / 1000; // valueBuffer is millidegree Celsius
+    if(ffReadFileBufferRelative(dfd, "name", &value->name))
+        ffStrbufTrimRightSpace(&value->name);
 
-    if(value->value != value->value)
-        return false;
+    char buffer[64];
+    if(ffReadFileStrRelative(dfd, "device/class", sizeof(buffer), buffer) > 0 ||
+        ffReadFileStrRelative(dfd, "device/device/class", sizeof(buffer), buffer) > 0)
+        value->deviceClass = (uint32_t) strtoul(buffer, NULL, 16);
 
-    ffStrbufAppendS(dir, "name");
-    ffReadFileBuffer(dir->chars, &value->name);
-    ffStrbufTrimRightSpace(&value->name);
-    ffStrbufSubstrBefore(dir, dirLength);
-
-    ffStrbufAppendS(dir, "device/class");
-    if(!ffReadFileBuffer(dir->chars, &valueBuffer))
+    char link[256];
+    if (ffReadLinkRelative(dfd, "device", sizeof(link), link) > 0)
     {
-        ffStrbufSubstrBefore(dir, dirLength);
-        ffStrbufAppendS(dir, "device/device/class");
-        ffReadFileBuffer(dir->chars, &valueBuffer);
-    }
-    ffStrbufTrimRightSpace(&valueBuffer);
-    ffStrbufSubstrBefore(dir, dirLength);
-    if(valueBuffer.length)
-        value->deviceClass = (uint32_t) strtoul(valueBuffer.chars, NULL, 16);
-
-    ffStrbufClear(&valueBuffer);
-    ffStrbufEnsureFree(&valueBuffer, 64);
-    ffStrbufAppendS(dir, "device");
-    ssize_t linkLen = readlink(dir->chars, valueBuffer.chars, valueBuffer.allocated - 1);
-    if (linkLen > 0)
-    {
-        valueBuffer.length = (uint32_t) linkLen;
-        valueBuffer.chars[linkLen] = 0;
-        ffStrbufSubstrAfterLastC(&valueBuffer, '/');
-        ffStrbufInitMove(&value->deviceName, &valueBuffer);
+        const char* slash = strrchr(link, '/');
+        ffStrbufInitS(&value->deviceName, slash ? slash + 1 : link);
     }
     else
         ffStrbufInit(&value->deviceName);
@@ -58,43 +36,49 @@ static bool parseHwmonDir(FFstrbuf* dir, FFTempValue* value)
     return value->name.length > 0 || value->deviceClass > 0;
 }
 
-const FFlist* ffDetectTemps(void)
+static FFlist result;
+
+static void resetTemps(void)
 {
-    static FFlist result;
+    FF_LIST_FOR_EACH(FFTempValue, value, result)
+    {
+        ffStrbufDestroy(&value->name);
+        ffStrbufDestroy(&value->deviceName);
+    }
+    ffListDestroy(&result);
+    result.elementSize = 0;
+}
 
+const FFlist* ffDetectTemps(void)
+{
     if(result.elementSize > 0)
         return &result;
 
     ffListInitA(&result, sizeof(FFTempValue), 16);
+    ffCacheRegisterReset(resetTemps);
 
-    FF_STRBUF_AUTO_DESTROY baseDir = ffStrbufCreateA(64);
-    ffStrbufAppendS(&baseDir, "/sys/class/hwmon/");
-
-    uint32_t baseDirLength = baseDir.length;
-
-    FF_AUTO_CLOSE_DIR DIR* dirp = opendir(baseDir.chars);
+    FF_AUTO_CLOSE_DIR DIR* dirp = opendir("/sys/class/hwmon/");
     if(dirp == NULL)
         return &result;
 
     struct dirent* entry;
-    while((entry = readdir(dirp)) != NULL)
+    while((entry = ffReadDir(dirp)) != NULL)
     {
         if(entry->d_name[0] == '.')
             continue;
 
-        ffStrbufAppendS(&baseDir, entry->d_name);
-        ffStrbufAppendC(&baseDir, '/');
+        int FF_AUTO_CLOSE_FD hwmonFd = ffOpenDirRelative(dirfd(dirp), entry->d_name);
+        if(hwmonFd < 0)
+            continue;
 
         FFTempValue* temp = ffListAdd(&result);
         ffStrbufInit(&temp->name);
         temp->deviceClass = 0;
-        if(!parseHwmonDir(&baseDir, temp))
+        if(!parseHwmonDir(hwmonFd, temp))
         {
             ffStrbufDestroy(&temp->name);
             --result.length;
         }
-
-        ffStrbufSubstrBefore(&baseDir, baseDirLength);
     }
 
     return &result;
@@ -2,6 +2,8 @@
 #include "common/io/io.h"
 #include "common/processing.h"
 #include "common/properties.h"
+#include "common/scheduler.h"
+#include "detection/terminalshell/terminalshell.h"
 #include "util/stringUtils.h"
 
 #include <ctype.h>
@@ -46,7 +48,7 @@ static bool getFileVersion(const char* exePath, FFstrbuf* version)
 
 static bool getExeVersionRaw(FFstrbuf* exe, FFstrbuf* version)
 {
-    return ffProcessAppendStdOut(version, (char* const[]) {
+    return ffProcessAppendStdOutCached(version, (char* const[]) {
         exe->chars,
         "--version",
         NULL
@@ -105,7 +107,7 @@ static bool getShellVersionPwsh(FFstrbuf* exe, FFstrbuf* version)
 
 static bool getShellVersionKsh(FFstrbuf* exe, FFstrbuf* version)
 {
-    if(ffProcessAppendStdErr(version, (char* const[]) {
+    if(ffProcessAppendStdErrCached(version, (char* const[]) {
         exe->chars,
         "--version",
         NULL
@@ -120,7 +122,7 @@ static bool getShellVersionKsh(FFstrbuf* exe, FFstrbuf* version)
 
 static bool getShellVersionOksh(FFstrbuf* exe, FFstrbuf* version)
 {
-    if(ffProcessAppendStdOut(version, (char* const[]) {
+    if(ffProcessAppendStdOutCached(version, (char* const[]) {
         exe->chars,
         "-c",
         "echo $OKSH_VERSION",
@@ -135,7 +137,7 @@ static bool getShellVersionOksh(FFstrbuf* exe, FFstrbuf* version)
 
 static bool getShellVersionOils(FFstrbuf* exe, FFstrbuf* version)
 {
-    if(ffProcessAppendStdOut(version, (char* const[]) {
+    if(ffProcessAppendStdOutCached(version, (char* const[]) {
         exe->chars,
         "--version",
         NULL
@@ -157,7 +159,7 @@ static bool getShellVersionNushell(FFstrbuf* exe, FFstrbuf* version)
 
 static bool getShellVersionAsh(FFstrbuf* exe, FFstrbuf* version)
 {
-    if(ffProcessAppendStdErr(version, (char* const[]) {
+    if(ffProcessAppendStdErrCached(version, (char* const[]) {
         exe->chars,
         "--help",
         NULL
@@ -176,7 +178,7 @@ static bool getShellVersionXonsh(FFstrbuf* exe, FFstrbuf* version)
     ffStrbufSetS(version, getenv("XONSH_VERSION"));
     if (version->length) return true;
 
-    if(ffProcessAppendStdErr(version, (char* const[]) {
+    if(ffProcessAppendStdErrCached(version, (char* const[]) {
         exe->chars,
         "--version",
         NULL
@@ -191,7 +193,7 @@ static bool getShellVersionXonsh(FFstrbuf* exe, FFstrbuf* version)
 #ifdef _WIN32
 static bool getShellVersionWinPowerShell(FFstrbuf* exe, FFstrbuf* version)
 {
-    return ffProcessAppendStdOut(version, (char* const[]) {
+    return ffProcessAppendStdOutCached(version, (char* const[]) {
         exe->chars,
         "-NoLogo",
         "-NoProfile",
@@ -252,7 +254,7 @@ FF_MAYBE_UNUSED static bool getTerminalVersionTermux(FFstrbuf* version)
 
 FF_MAYBE_UNUSED static bool getTerminalVersionGnome(FFstrbuf* version)
 {
-    if(ffProcessAppendStdOut(version, (char* const[]){
+    if(ffProcessAppendStdOutCached(version, (char* const[]){
         "gnome-terminal",
         "--version",
         NULL
@@ -266,7 +268,7 @@ FF_MAYBE_UNUSED static bool getTerminalVersionGnome(FFstrbuf* version)
 
 FF_MAYBE_UNUSED static bool getTerminalVersionKgx(FFstrbuf* version)
 {
-    if(ffProcessAppendStdOut(version, (char* const[]){
+    if(ffProcessAppendStdOutCached(version, (char* const[]){
         "kgx",
         "--version",
         NULL
@@ -333,7 +335,7 @@ FF_MAYBE_UNUSED static bool getTerminalVersionXterm(FFstrbuf* exe, FFstrbuf* ver
     ffStrbufSetS(version, getenv("XTERM_VERSION"));
     if (!version->length)
     {
-        if(ffProcessAppendStdOut(version, (char* const[]){
+        if(ffProcessAppendStdOutCached(version, (char* const[]){
             exe->chars,
             "-v",
             NULL
@@ -348,7 +350,7 @@ FF_MAYBE_UNUSED static bool getTerminalVersionXterm(FFstrbuf* exe, FFstrbuf* ver
 
 FF_MAYBE_UNUSED static bool getTerminalVersionBlackbox(FFstrbuf* exe, FFstrbuf* version)
 {
-    if(ffProcessAppendStdOut(version, (char* const[]){
+    if(ffProcessAppendStdOutCached(version, (char* const[]){
         exe->chars,
         "--version",
         NULL
@@ -362,7 +364,7 @@ FF_MAYBE_UNUSED static bool getTerminalVersionBlackbox(FFstrbuf* exe, FFstrbuf*
 
 FF_MAYBE_UNUSED static bool getTerminalVersionUrxvt(FF_MAYBE_UNUSED FFstrbuf* exe, FFstrbuf* version)
 {
-    if(ffProcessAppendStdErr(version, (char* const[]){
+    if(ffProcessAppendStdErrCached(version, (char* const[]){
         "urxvt", // Don't use exe because of urxvtd
         "-invalid",
         NULL
@@ -378,7 +380,7 @@ FF_MAYBE_UNUSED static bool getTerminalVersionUrxvt(FF_MAYBE_UNUSED FFstrbuf* ex
 
 FF_MAYBE_UNUSED static bool getTerminalVersionSt(FF_MAYBE_UNUSED FFstrbuf* exe, FFstrbuf* version)
 {
-    if(ffProcessAppendStdErr(version, (char* const[]){
+    if(ffProcessAppendStdErrCached(version, (char* const[]){
         exe->chars,
         "-v",
         NULL
@@ -401,7 +403,7 @@ FF_MAYBE_UNUSED static bool getTerminalVersionLxterminal(FFstrbuf* exe, FFstrbuf
 FF_MAYBE_UNUSED static bool getTerminalVersionWeston(FF_MAYBE_UNUSED FFstrbuf* exe, FFstrbuf* version)
 {
     // weston-terminal doesn't report a version, use weston version instead
-    if(ffProcessAppendStdOut(version, (char* const[]){
+    if(ffProcessAppendStdOutCached(version, (char* const[]){
         "weston",
         "--version",
         NULL
@@ -438,7 +440,7 @@ static bool getTerminalVersionScreen(FFstrbuf* exe, FFstrbuf* version)
 
 static bool getTerminalVersionTmux(FFstrbuf* exe, FFstrbuf* version)
 {
-    if (ffProcessAppendStdOut(version, (char* const[]) {
+    if (ffProcessAppendStdOutCached(version, (char* const[]) {
         exe->chars,
         "-V",
         NULL
@@ -469,7 +471,7 @@ static bool getTerminalVersionZed(FFstrbuf* exe, FFstrbuf* version)
         #endif
     );
 
-    if(ffProcessAppendStdOut(version, (char* const[]) {
+    if(ffProcessAppendStdOutCached(version, (char* const[]) {
         cli.chars,
         "--version",
         NULL
@@ -534,7 +536,7 @@ static bool getTerminalVersionKitty(FFstrbuf* exe, FFstrbuf* version)
 
 FF_MAYBE_UNUSED static bool getTerminalVersionPtyxis(FF_MAYBE_UNUSED FFstrbuf* exe, FFstrbuf* version)
 {
-    if(ffProcessAppendStdOut(version, (char* const[]) {
+    if(ffProcessAppendStdOutCached(version, (char* const[]) {
         "ptyxis",
         "--version",
         NULL
@@ -732,3 +734,15 @@ bool fftsGetTerminalVersion(FFstrbuf* processName, FF_MAYBE_UNUSED FFstrbuf* exe
 
     #endif
 }
+
+static void prefetchTerminalShell(FF_MAYBE_UNUSED void* data)
+{
+    ffDetectTerminal(); // Detects shell too
+}
+
+void ffPrepareTerminalShell(void)
+{
+    static FFSchedulerTask task;
+    if (!task.func)
+        ffSchedulerSubmit(&task, "TerminalShell", prefetchTerminalShell, NULL);
+}
@@ -28,5 +28,6 @@ typedef struct FFTerminalResult
     uint32_t ppid;
 } FFTerminalResult;
 
+void ffPrepareTerminalShell(void);
 const FFShellResult* ffDetectShell();
 const FFTerminalResult* ffDetectTerminal();
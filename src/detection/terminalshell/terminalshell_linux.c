@@ -366,7 +366,7 @@ static void setTerminalInfoDetails(FFTerminalResult* result)
 #define FF_EXE_PATH_LEN 260
 #endif
 
-const FFShellResult* ffDetectShell()
+static const FFShellResult* detectShell(void)
 {
     static FFShellResult result;
     static bool init = false;
@@ -383,7 +383,7 @@ const FFShellResult* ffDetectShell()
     result.ppid = 0;
     result.tty = -1;
 
-    pid_t ppid = getppid();
+    pid_t ppid = instance.state.parentPid ? (pid_t) instance.state.parentPid : getppid();
     ppid = getShellInfo(&result, ppid);
     getUserShellFromEnv(&result);
     setShellInfoDetails(&result);
@@ -391,7 +391,17 @@ const FFShellResult* ffDetectShell()
     return &result;
 }
 
-const FFTerminalResult* ffDetectTerminal()
+// Detection runs on worker threads too; the first caller detects, others wait for it
+const FFShellResult* ffDetectShell(void)
+{
+    static FFThreadMutex mutex = FF_THREAD_MUTEX_INITIALIZER;
+    ffThreadMutexLock(&mutex);
+    const FFShellResult* result = detectShell();
+    ffThreadMutexUnlock(&mutex);
+    return result;
+}
+
+static const FFTerminalResult* detectTerminal(void)
 {
     static FFTerminalResult result;
     static bool init = false;
@@ -417,3 +427,12 @@ const FFTerminalResult* ffDetectTerminal()
 
     return &result;
 }
+
+const FFTerminalResult* ffDetectTerminal(void)
+{
+    static FFThreadMutex mutex = FF_THREAD_MUTEX_INITIALIZER;
+    ffThreadMutexLock(&mutex);
+    const FFTerminalResult* result = detectTerminal();
+    ffThreadMutexUnlock(&mutex);
+    return result;
+}
@@ -323,7 +323,7 @@ static void setTerminalInfoDetails(FFTerminalResult* result)
 
 bool fftsGetTerminalVersion(FFstrbuf* processName, FFstrbuf* exe, FFstrbuf* version);
 
-const FFShellResult* ffDetectShell(void)
+static const FFShellResult* detectShell(void)
 {
     static FFShellResult result;
     static bool init = false;
@@ -360,7 +360,17 @@ const FFShellResult* ffDetectShell(void)
     return &result;
 }
 
-const FFTerminalResult* ffDetectTerminal(void)
+// Detection runs on worker threads too; the first caller detects, others wait for it
+const FFShellResult* ffDetectShell(void)
+{
+    static FFThreadMutex mutex = FF_THREAD_MUTEX_INITIALIZER;
+    ffThreadMutexLock(&mutex);
+    const FFShellResult* result = detectShell();
+    ffThreadMutexUnlock(&mutex);
+    return result;
+}
+
+static const FFTerminalResult* detectTerminal(void)
 {
     static FFTerminalResult result;
     static bool init = false;
@@ -395,3 +405,12 @@ const FFTerminalResult* ffDetectTerminal(void)
 
     return &result;
 }
+
+const FFTerminalResult* ffDetectTerminal(void)
+{
+    static FFThreadMutex mutex = FF_THREAD_MUTEX_INITIALIZER;
+    ffThreadMutexLock(&mutex);
+    const FFTerminalResult* result = detectTerminal();
+    ffThreadMutexUnlock(&mutex);
+    return result;
+}
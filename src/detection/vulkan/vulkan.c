@@ -1,6 +1,8 @@
 #include "fastfetch.h"
 #include "detection/gpu/gpu.h"
 #include "detection/vulkan/vulkan.h"
+#include "common/scheduler.h"
+#include "common/thread.h"
 
 #ifdef FF_HAVE_VULKAN
 #include "common/library.h"
@@ -255,8 +257,10 @@ static const char* detectVulkan(FFVulkanResult* result)
 
 FFVulkanResult* ffDetectVulkan(void)
 {
+    static FFThreadMutex mutex = FF_THREAD_MUTEX_INITIALIZER;
     static FFVulkanResult result;
 
+    ffThreadMutexLock(&mutex);
     if (result.gpus.elementSize == 0)
     {
         ffStrbufInit(&result.driver);
@@ -271,6 +275,19 @@ FFVulkanResult* ffDetectVulkan(void)
             result.error = "fastfetch was compiled without vulkan support";
         #endif
     }
+    ffThreadMutexUnlock(&mutex);
 
     return &result;
 }
+
+static void prefetchVulkan(FF_MAYBE_UNUSED void* data)
+{
+    ffDetectVulkan();
+}
+
+void ffPrepareVulkan(void)
+{
+    static FFSchedulerTask task;
+    if (!task.func)
+        ffSchedulerSubmit(&task, "Vulkan", prefetchVulkan, NULL);
+}
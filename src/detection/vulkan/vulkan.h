@@ -12,4 +12,5 @@ typedef struct FFVulkanResult
     const char* error;
 } FFVulkanResult;
 
+void ffPrepareVulkan(void);
 FFVulkanResult* ffDetectVulkan();
@@ -58,38 +58,53 @@ static const char* detectWifiWithNm(FFWifiResult* item, FFstrbuf* buffer)
         dbus.lib->ffdbus_message_unref(device);
     }
 
+    // One GetAll per object instead of one Get per property
+    DBusMessage* device = ffDBusGetAllProperties(&dbus, "org.freedesktop.NetworkManager", buffer->chars, "org.freedesktop.NetworkManager.Device.Wireless");
+    DBusMessageIter iter;
+
     if (item->conn.txRate != item->conn.txRate)
     {
         uint32_t bitrate;
-        if (ffDBusGetPropertyUint(&dbus, "org.freedesktop.NetworkManager", buffer->chars, "org.freedesktop.NetworkManager.Device.Wireless", "Bitrate", &bitrate))
+        if (ffDBusFindProperty(&dbus, device, "Bitrate", &iter) && ffDBusGetUint(&dbus, &iter, &bitrate))
             item->conn.txRate = bitrate / 1000.;
     }
 
     FF_STRBUF_AUTO_DESTROY apPath = ffStrbufCreate();
-    if (!ffDBusGetPropertyString(&dbus, "org.freedesktop.NetworkManager", buffer->chars, "org.freedesktop.NetworkManager.Device.Wireless", "ActiveAccessPoint", &apPath))
+    bool hasApPath = ffDBusFindProperty(&dbus, device, "ActiveAccessPoint", &iter) && ffDBusGetString(&dbus, &iter, &apPath);
+    if (device)
+        dbus.lib->ffdbus_message_unref(device);
+    if (!hasApPath)
         return "Failed to get active access point path";
 
     if (!item->conn.status.length)
         ffStrbufSetStatic(&item->conn.status, "connected");
 
-    if (!item->conn.ssid.length)
-        ffDBusGetPropertyString(&dbus, "org.freedesktop.NetworkManager", apPath.chars, "org.freedesktop.NetworkManager.AccessPoint", "Ssid", &item->conn.ssid);
+    DBusMessage* ap = ffDBusGetAllProperties(&dbus, "org.freedesktop.NetworkManager", apPath.chars, "org.freedesktop.NetworkManager.AccessPoint");
+    if (!ap)
+        return NULL;
 
-    if (!item->conn.bssid.length)
-        ffDBusGetPropertyString(&dbus, "org.freedesktop.NetworkManager", apPath.chars, "org.freedesktop.NetworkManager.AccessPoint", "HwAddress", &item->conn.bssid);
+    if (!item->conn.ssid.length && ffDBusFindProperty(&dbus, ap, "Ssid", &iter))
+        ffDBusGetString(&dbus, &iter, &item->conn.ssid);
+
+    if (!item->conn.bssid.length && ffDBusFindProperty(&dbus, ap, "HwAddress", &iter))
+        ffDBusGetString(&dbus, &iter, &item->conn.bssid);
 
     if (item->conn.signalQuality != item->conn.signalQuality)
     {
         uint32_t strengthPercent;
-        if (ffDBusGetPropertyUint(&dbus, "org.freedesktop.NetworkManager", apPath.chars, "org.freedesktop.NetworkManager.AccessPoint", "Strength", &strengthPercent))
+        if (ffDBusFindProperty(&dbus, ap, "Strength", &iter) && ffDBusGetUint(&dbus, &iter, &strengthPercent))
             item->conn.signalQuality = strengthPercent;
     }
 
     NM80211ApFlags flags;
     NM80211ApSecurityFlags wpaFlags, rsnFlags;
-    if (ffDBusGetPropertyUint(&dbus, "org.freedesktop.NetworkManager", apPath.chars, "org.freedesktop.NetworkManager.AccessPoint", "Flags", &flags) &&
-        ffDBusGetPropertyUint(&dbus, "org.freedesktop.NetworkManager", apPath.chars, "org.freedesktop.NetworkManager.AccessPoint", "WpaFlags", &wpaFlags) &&
-        ffDBusGetPropertyUint(&dbus, "org.freedesktop.NetworkManager", apPath.chars , "org.freedesktop.NetworkManager.AccessPoint", "RsnFlags", &rsnFlags))
+    bool hasFlags =
+        ffDBusFindProperty(&dbus, ap, "Flags", &iter) && ffDBusGetUint(&dbus, &iter, &flags) &&
+        ffDBusFindProperty(&dbus, ap, "WpaFlags", &iter) && ffDBusGetUint(&dbus, &iter, &wpaFlags) &&
+        ffDBusFindProperty(&dbus, ap, "RsnFlags", &iter) && ffDBusGetUint(&dbus, &iter, &rsnFlags);
+    dbus.lib->ffdbus_message_unref(ap);
+
+    if (hasFlags)
     {
         if ((flags & NM_802_11_AP_FLAGS_PRIVACY) && (wpaFlags == NM_802_11_AP_SEC_NONE)
             && (rsnFlags == NM_802_11_AP_SEC_NONE))
@@ -1,7 +1,11 @@
 #include "fastfetch.h"
 #include "common/commandoption.h"
+#include "common/configsnapshot.h"
+#include "common/daemon.h"
 #include "common/io/io.h"
 #include "common/jsonconfig.h"
+#include "common/trace.h"
+#include "common/watch.h"
 #include "detection/version/version.h"
 #include "util/stringUtils.h"
 #include "util/mallocHelper.h"
@@ -319,29 +323,41 @@ static void listModules(bool pretty)
     }
 }
 
-static bool parseJsoncFile(const char* path)
+static bool readJsoncFile(const char* path)
 {
     assert(!instance.state.configDoc);
 
+    yyjson_read_err error;
+    instance.state.configDoc = yyjson_read_file(path, YYJSON_READ_ALLOW_COMMENTS | YYJSON_READ_ALLOW_TRAILING_COMMAS, NULL, &error);
+    if (!instance.state.configDoc)
     {
-        yyjson_read_err error;
-        instance.state.configDoc = yyjson_read_file(path, YYJSON_READ_ALLOW_COMMENTS | YYJSON_READ_ALLOW_TRAILING_COMMAS, NULL, &error);
-        if (!instance.state.configDoc)
+        if (error.code != YYJSON_READ_ERROR_FILE_OPEN)
         {
-            if (error.code != YYJSON_READ_ERROR_FILE_OPEN)
-            {
-                size_t row = 0, col = error.pos;
-                FF_STRBUF_AUTO_DESTROY content = ffStrbufCreate();
-                if (ffAppendFileBuffer(path, &content))
-                    yyjson_locate_pos(content.chars, content.length, error.pos, &row, &col, NULL);
-                fprintf(stderr, "Error: failed to parse JSON config file `%s` at (%zu, %zu): %s\n", path, row, col, error.msg);
-                exit(477);
-            }
-            return false;
+            size_t row = 0, col = error.pos;
+            FF_STRBUF_AUTO_DESTROY content = ffStrbufCreate();
+            if (ffAppendFileBuffer(path, &content))
+                yyjson_locate_pos(content.chars, content.length, error.pos, &row, &col, NULL);
+            fprintf(stderr, "Error: failed to parse JSON config file `%s` at (%zu, %zu): %s\n", path, row, col, error.msg);
+            exit(477);
         }
+        return false;
     }
+    return true;
+}
+
+static bool parseJsoncFile(const char* path)
+{
+    if (ffConfigSnapshotLoad(path))
+        return true;
+
+    if (!readJsoncFile(path))
+        return false;
+
+    // Before the options of the file are applied, so that its `cacheMode` doesn't apply to the snapshot
+    ffConfigSnapshotStore(path, instance.state.configDoc);
 
     {
+        FF_TRACE_SPAN(span, "config", "ffOptionsParseJsonConfig", path);
         const char* error = NULL;
 
         yyjson_val* const root = yyjson_doc_get_root(instance.state.configDoc);
@@ -554,6 +570,18 @@ static void parseCommand(FFdata* data, char* key, char* value)
         generateConfigFile(true, value);
     else if(ffStrEqualsIgnCase(key, "-c") || ffStrEqualsIgnCase(key, "--load-config") || ffStrEqualsIgnCase(key, "--config"))
         optionParseConfigFile(data, key, value);
+    else if(ffStrEqualsIgnCase(key, "--daemon"))
+        data->daemon = true;
+    else if(ffStrEqualsIgnCase(key, "--watch"))
+        data->watch = ffOptionParseUInt32(key, value);
+    else if(ffStrEqualsIgnCase(key, "--trace"))
+    {
+        if (!value)
+        {
+            fprintf(stderr, "Error: usage: %s <file>\n", key);
+            exit(477);
+        }
+    }
     else if(ffStrEqualsIgnCase(key, "--format"))
     {
         switch (ffOptionParseEnum(key, value, (FFKeyValuePair[]) {
@@ -596,10 +624,12 @@ static void parseOption(FFdata* data, const char* key, const char* value)
         ffOptionsParseGeneralCommandLine(&instance.config.general, key, value) ||
         ffOptionsParseLogoCommandLine(&instance.config.logo, key, value) ||
         ffOptionsParseDisplayCommandLine(&instance.config.display, key, value) ||
-        ffOptionsParseLibraryCommandLine(&instance.config.library, key, value) ||
-        ffParseModuleOptions(key, value)
+        ffOptionsParseLibraryCommandLine(&instance.config.library, key, value)
     ) {}
 
+    else if(ffParseModuleOptions(key, value))
+        data->moduleOptions = true;
+
     else
     {
         fprintf(stderr, "Error: unknown option: %s\n", key);
@@ -609,6 +639,8 @@ static void parseOption(FFdata* data, const char* key, const char* value)
 
 static void parseConfigFiles(void)
 {
+    FF_TRACE_SPAN(span, "config", "parseConfigFiles", NULL);
+
     if (__builtin_expect(instance.state.genConfigPath.length == 0, true))
     {
         FF_LIST_FOR_EACH(FFstrbuf, dir, instance.state.platform.configDirs)
@@ -654,7 +686,7 @@ static void parseArguments(FFdata* data, int argc, char** argv, void (*parser)(F
 
 static void run(FFdata* data)
 {
-    const bool useJsonConfig = data->structure.length == 0 && instance.state.configDoc;
+    const bool useJsonConfig = data->structure.length == 0 && (instance.state.configDoc || ffConfigSnapshotGetModules());
 
     if (useJsonConfig)
         ffPrintJsonConfig(true /* prepare */, instance.state.resultDoc);
@@ -703,7 +735,17 @@ static void writeConfigFile(FFdata* data, const FFstrbuf* filename)
             exit(1);
         }
         if (ffWriteFileData(filename->chars, len, str))
+        {
             printf("The generated config file has been written in `%s`\n", filename->chars);
+
+            // Loading the new config won't need to parse it
+            yyjson_doc* imut = yyjson_mut_doc_imut_copy(doc, NULL);
+            if (imut)
+            {
+                ffConfigSnapshotStore(filename->chars, imut);
+                yyjson_doc_free(imut);
+            }
+        }
         else
         {
             printf("Error: failed to write file in `%s`\n", filename->chars);
@@ -716,13 +758,33 @@ static void writeConfigFile(FFdata* data, const FFstrbuf* filename)
 
 int main(int argc, char** argv)
 {
+    if (ffDaemonRunClient(argc, argv))
+        return 0;
+
+    // Started before anything else so that initialization is recorded too. Parsed again in parseCommand
+    for (int i = 1; i < argc - 1; ++i)
+    {
+        if (ffStrEqualsIgnCase(argv[i], "--trace"))
+            ffTraceStart(argv[i + 1]);
+    }
+
     ffInitInstance();
     atexit(ffDestroyInstance);
 
+    // Config files are loaded by parseCommand, but may come from a snapshot in the cache. Parsed again in parseOption
+    for (int i = 1; i < argc - 1; ++i)
+    {
+        if (ffStrEqualsIgnCase(argv[i], "--cache-mode"))
+            ffOptionsParseGeneralCommandLine(&instance.config.general, argv[i], argv[i + 1]);
+    }
+
     //Data stores things only needed for the configuration of fastfetch
     FFdata data = {
         .structure = ffStrbufCreate(),
         .configLoaded = false,
+        .daemon = false,
+        .watch = 0,
+        .moduleOptions = false,
     };
 
     parseArguments(&data, argc, argv, parseCommand);
@@ -730,8 +792,23 @@ int main(int argc, char** argv)
         parseConfigFiles();
     parseArguments(&data, argc, argv, (void*) parseOption);
 
+    // Module options of the command line apply before those of the config file, and --watch and --daemon keep the module objects.
+    // The snapshot has neither, so parse the file in these cases
+    if (ffConfigSnapshotGetModules() && (data.moduleOptions || data.daemon || data.watch > 0))
+    {
+        readJsoncFile(ffConfigSnapshotGetPath());
+        ffConfigSnapshotDestroy();
+    }
+
     if (__builtin_expect(instance.state.genConfigPath.length == 0, true))
-        run(&data);
+    {
+        if (data.daemon)
+            ffDaemonServe(&data, run);
+        else if (data.watch > 0)
+            ffWatchRun(&data, run);
+        else
+            run(&data);
+    }
     else
         writeConfigFile(&data, &instance.state.genConfigPath);
 
@@ -49,6 +49,9 @@ typedef struct FFstate
     yyjson_doc* configDoc;
     yyjson_mut_doc* resultDoc;
     FFstrbuf genConfigPath;
+
+    bool daemonMode; // Serving the daemon socket. Only baseline samplers are prepared in this process
+    uint32_t parentPid; // Parent of the requesting client when forked by the daemon; 0 to use getppid()
 } FFstate;
 
 typedef struct FFinstance
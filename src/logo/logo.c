@@ -1,6 +1,7 @@
 #include "logo/logo.h"
 #include "common/io/io.h"
 #include "common/printing.h"
+#include "common/trace.h"
 #include "detection/os/os.h"
 #include "detection/terminalshell/terminalshell.h"
 #include "util/textModifier.h"
@@ -103,6 +104,15 @@ static bool ffLogoPrintCharsRaw(const char* data, size_t length, bool printError
     return true;
 }
 
+static void logoAppendPadding(FFstrbuf* result)
+{
+    FFOptionsLogo* options = &instance.config.logo;
+    if (options->position != FF_LOGO_POSITION_RIGHT)
+        ffStrbufAppendNC(result, options->paddingLeft, ' ');
+    else
+        ffStrbufAppendF(result, "\e[9999999C\e[%dD", options->paddingRight + instance.state.logoWidth);
+}
+
 // If result is NULL, calculate logo width
 // Returns logo height
 static uint32_t logoAppendChars(const char* data, bool doColorReplacement, FFstrbuf* result)
@@ -112,12 +122,7 @@ static uint32_t logoAppendChars(const char* data, bool doColorReplacement, FFstr
     uint32_t logoHeight = 0;
 
     if (result)
-    {
-        if (options->position != FF_LOGO_POSITION_RIGHT)
-            ffStrbufAppendNC(result, options->paddingLeft, ' ');
-        else
-            ffStrbufAppendF(result, "\e[9999999C\e[%dD", options->paddingRight + instance.state.logoWidth);
-    }
+        logoAppendPadding(result);
 
     while(*data != '\0')
     {
@@ -132,12 +137,7 @@ static uint32_t logoAppendChars(const char* data, bool doColorReplacement, FFstr
             ++data;
 
             if (result)
-            {
-                if (options->position != FF_LOGO_POSITION_RIGHT)
-                    ffStrbufAppendNC(result, options->paddingLeft, ' ');
-                else
-                    ffStrbufAppendF(result, "\e[9999999C\e[%dD", options->paddingRight + instance.state.logoWidth);
-            }
+                logoAppendPadding(result);
 
             if(currentlineLength > instance.state.logoWidth)
                 instance.state.logoWidth = currentlineLength;
@@ -188,67 +188,47 @@ static uint32_t logoAppendChars(const char* data, bool doColorReplacement, FFstr
         {
             ++data;
 
-            //If we have $$, or $\0, print it as single $
-            if(*data == '$' || *data == '\0')
+            //Map the number to an array index, so that '1' -> 0, '2' -> 1, etc.
+            int index = *data - '1';
+
+            //If we have $$, or a $ that isn't followed by a valid index, print it as single $.
+            //The char after it is handled as usual, even if it's a line break. Builtin logos are split the same way at build time
+            if(index < 0 || index >= FASTFETCH_LOGO_MAX_COLORS)
             {
                 if(result) ffStrbufAppendC(result, '$');
                 ++currentlineLength;
-                ++data;
+                if(*data == '$') ++data;
                 continue;
             }
 
-            if(!instance.config.display.pipe)
-            {
-                //Map the number to an array index, so that '1' -> 0, '2' -> 1, etc.
-                int index = *data - '1';
-
-                //If the index is valid, print the color. Otherwise continue as normal
-                if(index < 0 || index >= FASTFETCH_LOGO_MAX_COLORS)
-                {
-                    if(result) ffStrbufAppendC(result, '$');
-                    ++currentlineLength;
-                    //Don't continue here, we want to print the current char as unicode
-                }
-                else
-                {
-                    if(result) ffStrbufAppendF(result, "\e[%sm", options->colors[index].chars);
-                    ++data;
-                    continue;
-                }
-            }
-            else
-            {
-                ++data;
-                continue;
-            }
+            if(result && !instance.config.display.pipe)
+                ffStrbufAppendF(result, "\e[%sm", options->colors[index].chars);
+            ++data;
+            continue;
         }
 
-        //Do the printing, respecting unicode
-
-        ++currentlineLength;
-
-        int codepoint = (unsigned char) *data;
-        uint8_t bytes;
+        //Do the printing, respecting unicode.
+        //The current char is always printed (it may be a special char that didn't match above), followed by all chars up to the next special one
+        size_t length = 1 + strcspn(data + 1, doColorReplacement ? "\n\r\t\e$" : "\n\r\t\e");
 
-        if(codepoint <= 127)
-            bytes = 1;
-        else if((codepoint & 0xE0) == 0xC0)
-            bytes = 2;
-        else if((codepoint & 0xF0) == 0xE0)
-            bytes = 3;
-        else if((codepoint & 0xF8) == 0xF0)
-            bytes = 4;
-        else
-            bytes = 1; //Invalid utf8, print it as is, byte by byte
-
-        for(uint8_t i = 0; i < bytes; ++i)
+        for(size_t i = 0; i < length; ++currentlineLength)
         {
-            if(*data == '\0')
-                break;
-
-            if(result) ffStrbufAppendC(result, *data);
-            ++data;
+            uint8_t codepoint = (uint8_t) data[i];
+
+            if(codepoint <= 127)
+                i += 1;
+            else if((codepoint & 0xE0) == 0xC0)
+                i += 2;
+            else if((codepoint & 0xF0) == 0xE0)
+                i += 3;
+            else if((codepoint & 0xF8) == 0xF0)
+                i += 4;
+            else
+                i += 1; //Invalid utf8, print it as is, byte by byte
         }
+
+        if(result) ffStrbufAppendNS(result, (uint32_t) length, data);
+        data += length;
     }
     //Happens if the last line is the longest
     if(currentlineLength > instance.state.logoWidth)
@@ -257,11 +237,37 @@ static uint32_t logoAppendChars(const char* data, bool doColorReplacement, FFstr
     return logoHeight;
 }
 
-void ffLogoPrintChars(const char* data, bool doColorReplacement)
+// Returns logo height
+static uint32_t logoAppendSegments(const FFLogoLines* lines, FFstrbuf* result)
 {
     FFOptionsLogo* options = &instance.config.logo;
 
-    if (options->position == FF_LOGO_POSITION_RIGHT)
+    if (lines->width > instance.state.logoWidth)
+        instance.state.logoWidth = lines->width;
+
+    logoAppendPadding(result);
+    for (uint32_t i = 0; i < lines->segmentCount; ++i)
+    {
+        const FFLogoSegment* segment = &lines->segments[i];
+        if (segment->newLine)
+        {
+            ffStrbufAppendC(result, '\n');
+            logoAppendPadding(result);
+        }
+        if (segment->color && !instance.config.display.pipe)
+            ffStrbufAppendF(result, "\e[%sm", options->colors[segment->color - 1].chars);
+        ffStrbufAppendNS(result, segment->length, segment->text);
+    }
+
+    return lines->height;
+}
+
+// Either `data` or the segments of a builtin logo `lines` are printed
+static void logoPrint(const char* data, const FFLogoLines* lines, bool doColorReplacement)
+{
+    FFOptionsLogo* options = &instance.config.logo;
+
+    if (options->position == FF_LOGO_POSITION_RIGHT && !lines)
         logoAppendChars(data, doColorReplacement, NULL);
 
     FF_STRBUF_AUTO_DESTROY result = ffStrbufCreateA(2048);
@@ -275,7 +281,7 @@ void ffLogoPrintChars(const char* data, bool doColorReplacement)
     if(doColorReplacement && !instance.config.display.pipe)
         ffStrbufAppendF(&result, "\e[%sm", options->colors[0].chars);
 
-    instance.state.logoHeight = options->paddingTop + logoAppendChars(data, doColorReplacement, &result);
+    instance.state.logoHeight = options->paddingTop + (lines ? logoAppendSegments(lines, &result) : logoAppendChars(data, doColorReplacement, &result));
 
     if(!instance.config.display.pipe)
         ffStrbufAppendS(&result, FASTFETCH_TEXT_MODIFIER_RESET);
@@ -303,6 +309,11 @@ void ffLogoPrintChars(const char* data, bool doColorReplacement)
     ffWriteFDBuffer(FFUnixFD2NativeFD(STDOUT_FILENO), &result);
 }
 
+void ffLogoPrintChars(const char* data, bool doColorReplacement)
+{
+    logoPrint(data, NULL, doColorReplacement);
+}
+
 static void logoApplyColors(const FFlogo* logo, bool replacement)
 {
     if(instance.config.display.colorTitle.length == 0)
@@ -324,23 +335,87 @@ static void logoApplyColors(const FFlogo* logo, bool replacement)
     }
 }
 
-static bool logoHasName(const FFlogo* logo, const FFstrbuf* name, bool small)
+typedef struct FFLogoIndexEntry
+{
+    const FFlogo* logo;
+    const char* name;
+    uint32_t hash;
+    uint16_t nameLength; // 0 marks an empty slot
+    uint8_t letter; // Only logos listed under the first letter of the name are considered
+    bool smallAlias; // Name of a small logo with `_small` stripped, only used for FF_LOGO_SIZE_SMALL
+} FFLogoIndexEntry;
+
+// Open addressing hash table over all builtin logo names, built on first lookup
+static struct
+{
+    FFLogoIndexEntry* entries;
+    uint32_t mask;
+} logoIndex;
+
+static uint32_t logoNameHash(const char* name, uint32_t length)
+{
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (uint32_t i = 0; i < length; ++i)
+        hash = (hash ^ (uint8_t) tolower((uint8_t) name[i])) * 16777619u;
+    return hash;
+}
+
+static void logoIndexInsert(const FFlogo* logo, uint8_t letter, const char* name, uint32_t nameLength, bool smallAlias)
+{
+    uint32_t hash = logoNameHash(name, nameLength);
+    uint32_t i = hash & logoIndex.mask;
+    // Linear probing without deletion keeps entries of the same name in insertion order
+    while (logoIndex.entries[i].nameLength)
+        i = (i + 1) & logoIndex.mask;
+
+    logoIndex.entries[i] = (FFLogoIndexEntry) {
+        .logo = logo,
+        .name = name,
+        .hash = hash,
+        .nameLength = (uint16_t) nameLength,
+        .letter = letter,
+        .smallAlias = smallAlias,
+    };
+}
+
+#define FF_LOGO_FOR_EACH_NAME(logo, logoName) \
+    for( \
+        const char* const* logoName = (logo)->names; \
+        logoName < &(logo)->names[FASTFETCH_LOGO_MAX_NAMES] && *logoName != NULL; \
+        ++logoName \
+    )
+
+static void logoIndexBuild(void)
 {
-    for(
-        const char* const* logoName = logo->names;
-        *logoName != NULL && logoName <= &logo->names[FASTFETCH_LOGO_MAX_NAMES];
-        ++logoName
-    ) {
-        if(small)
+    uint32_t count = 0;
+    for(uint8_t ch = 0; ch < 26; ++ch)
+    {
+        for(const FFlogo* logo = ffLogoBuiltins[ch]; *logo->names; ++logo)
         {
-            uint32_t logoNameLength = (uint32_t) (strlen(*logoName) - strlen("_small"));
-            if(name->length == logoNameLength && strncasecmp(*logoName, name->chars, logoNameLength) == 0) return true;
+            FF_LOGO_FOR_EACH_NAME(logo, logoName)
+                count += logo->type == FF_LOGO_LINE_TYPE_SMALL_BIT ? 2 : 1;
         }
-        if(ffStrbufIgnCaseEqualS(name, *logoName))
-            return true;
     }
 
-    return false;
+    uint32_t capacity = 64;
+    while (capacity < count * 2)
+        capacity <<= 1;
+    logoIndex.entries = calloc(capacity, sizeof(*logoIndex.entries));
+    logoIndex.mask = capacity - 1;
+
+    for(uint8_t ch = 0; ch < 26; ++ch)
+    {
+        for(const FFlogo* logo = ffLogoBuiltins[ch]; *logo->names; ++logo)
+        {
+            FF_LOGO_FOR_EACH_NAME(logo, logoName)
+            {
+                uint32_t nameLength = (uint32_t) strlen(*logoName);
+                logoIndexInsert(logo, ch, *logoName, nameLength, false);
+                if (logo->type == FF_LOGO_LINE_TYPE_SMALL_BIT && nameLength > strlen("_small"))
+                    logoIndexInsert(logo, ch, *logoName, nameLength - (uint32_t) strlen("_small"), true);
+            }
+        }
+    }
 }
 
 static const FFlogo* logoGetBuiltin(const FFstrbuf* name, FFLogoSize size)
@@ -348,23 +423,38 @@ static const FFlogo* logoGetBuiltin(const FFstrbuf* name, FFLogoSize size)
     if (name->length == 0 || !isalpha(name->chars[0]))
         return NULL;
 
-    for(const FFlogo* logo = ffLogoBuiltins[toupper(name->chars[0]) - 'A']; *logo->names; ++logo)
+    if (!logoIndex.entries)
+        logoIndexBuild();
+
+    uint8_t letter = (uint8_t) (toupper(name->chars[0]) - 'A');
+    uint32_t hash = logoNameHash(name->chars, name->length);
+
+    // Entries are visited in the order of ffLogoBuiltins, so the first accepted one is the same logo a linear scan would find
+    for (uint32_t i = hash & logoIndex.mask; logoIndex.entries[i].nameLength; i = (i + 1) & logoIndex.mask)
     {
+        const FFLogoIndexEntry* entry = &logoIndex.entries[i];
+        if (
+            entry->hash != hash ||
+            entry->letter != letter ||
+            entry->nameLength != name->length ||
+            strncasecmp(entry->name, name->chars, name->length) != 0
+        ) continue;
+
         switch (size)
         {
             // Never use alternate logos
             case FF_LOGO_SIZE_NORMAL:
-                if(logo->type != FF_LOGO_LINE_TYPE_NORMAL) continue;
+                if(entry->logo->type != FF_LOGO_LINE_TYPE_NORMAL) continue;
                 break;
             case FF_LOGO_SIZE_SMALL:
-                if(logo->type != FF_LOGO_LINE_TYPE_SMALL_BIT) continue;
+                if(entry->logo->type != FF_LOGO_LINE_TYPE_SMALL_BIT) continue;
                 break;
             default:
+                if(entry->smallAlias) continue;
                 break;
         }
 
-        if(logoHasName(logo, name, size == FF_LOGO_SIZE_SMALL))
-            return logo;
+        return entry->logo;
     }
 
     return NULL;
@@ -401,7 +491,7 @@ static void logoPrintStruct(const FFlogo* logo)
 {
     logoApplyColors(logo, true);
 
-    ffLogoPrintChars(logo->lines, true);
+    logoPrint(NULL, &logo->lines, true);
 }
 
 static void logoPrintNone(void)
@@ -554,6 +644,7 @@ void ffLogoPrint(void)
         return;
     }
 
+    FF_TRACE_SPAN(span, "logo", "ffLogoPrint", NULL);
     const FFOptionsLogo* options = &instance.config.logo;
 
     if (options->type == FF_LOGO_TYPE_NONE)
@@ -624,8 +715,10 @@ void ffLogoPrintLine(void)
 void ffLogoPrintRemaining(void)
 {
     if (instance.state.keysHeight <= instance.state.logoHeight)
+    {
         ffPrintCharTimes('\n', instance.state.logoHeight - instance.state.keysHeight + 1);
-    instance.state.keysHeight = instance.state.logoHeight + 1;
+        instance.state.keysHeight = instance.state.logoHeight + 1;
+    }
 }
 
 void ffLogoBuiltinPrint(void)
@@ -661,12 +754,8 @@ void ffLogoBuiltinList(void)
             ++counter;
             printf("%u)%s ", counter, counter < 10 ? " " : "");
 
-            for(
-                const char* const* names = logo->names;
-                *names != NULL && names <= &logo->names[FASTFETCH_LOGO_MAX_NAMES];
-                ++names
-            )
-                printf("\"%s\" ", *names);
+            FF_LOGO_FOR_EACH_NAME(logo, logoName)
+                printf("\"%s\" ", *logoName);
 
             putchar('\n');
         }
@@ -12,9 +12,27 @@ typedef enum FFLogoLineType
     FF_LOGO_LINE_TYPE_ALTER_BIT = 1 << 1,
 } FFLogoLineType;
 
+// Builtin logos are split at their color placeholders (`$1` to `$9`) and measured at build time.
+// See `fastfetch_logo_segments` in CMakeLists.txt
+typedef struct FFLogoSegment
+{
+    uint8_t color; // 1 based index of the logo color to switch to, 0 to keep the current one
+    bool newLine; // preceded by a line break
+    uint16_t length;
+    const char* text;
+} FFLogoSegment;
+
+typedef struct FFLogoLines
+{
+    uint32_t width; // display width of the widest line
+    uint32_t height; // number of line breaks
+    uint32_t segmentCount;
+    const FFLogoSegment* segments;
+} FFLogoLines;
+
 typedef struct FFlogo
 {
-    const char* lines;
+    FFLogoLines lines;
     const char* names[FASTFETCH_LOGO_MAX_NAMES];
     const char* colors[FASTFETCH_LOGO_MAX_COLORS];
     const char* colorKeys;
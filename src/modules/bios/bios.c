@@ -1,3 +1,4 @@
+#include "common/cache.h"
 #include "common/printing.h"
 #include "common/jsonconfig.h"
 #include "detection/bios/bios.h"
@@ -6,6 +7,21 @@
 
 #define FF_BIOS_NUM_FORMAT_ARGS 5
 
+// Doesn't change until next reboot
+static const char* detectBios(FFBiosResult* bios)
+{
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    ffCacheEntryInit(&cache, "bios");
+    ffCacheKeyAddBootId(&cache);
+    if (ffCacheLoadStrbufs(&cache, sizeof(*bios) / sizeof(FFstrbuf), (FFstrbuf*) bios))
+        return NULL;
+
+    const char* error = ffDetectBios(bios);
+    if (!error)
+        ffCacheStoreStrbufs(&cache, sizeof(*bios) / sizeof(FFstrbuf), (const FFstrbuf*) bios);
+    return error;
+}
+
 void ffPrintBios(FFBiosOptions* options)
 {
     FFBiosResult bios;
@@ -15,7 +31,7 @@ void ffPrintBios(FFBiosOptions* options)
     ffStrbufInit(&bios.version);
     ffStrbufInit(&bios.type);
 
-    const char* error = ffDetectBios(&bios);
+    const char* error = detectBios(&bios);
 
     FF_STRBUF_AUTO_DESTROY key = ffStrbufCreate();
 
@@ -121,7 +137,7 @@ void ffGenerateBiosJsonResult(FF_MAYBE_UNUSED FFBiosOptions* options, yyjson_mut
     ffStrbufInit(&bios.version);
     ffStrbufInit(&bios.type);
 
-    const char* error = ffDetectBios(&bios);
+    const char* error = detectBios(&bios);
 
     if (error)
     {
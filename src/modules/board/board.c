@@ -1,3 +1,4 @@
+#include "common/cache.h"
 #include "common/printing.h"
 #include "common/jsonconfig.h"
 #include "detection/board/board.h"
@@ -6,6 +7,21 @@
 
 #define FF_BOARD_NUM_FORMAT_ARGS 4
 
+// Doesn't change until next reboot
+static const char* detectBoard(FFBoardResult* board)
+{
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    ffCacheEntryInit(&cache, "board");
+    ffCacheKeyAddBootId(&cache);
+    if (ffCacheLoadStrbufs(&cache, sizeof(*board) / sizeof(FFstrbuf), (FFstrbuf*) board))
+        return NULL;
+
+    const char* error = ffDetectBoard(board);
+    if (!error)
+        ffCacheStoreStrbufs(&cache, sizeof(*board) / sizeof(FFstrbuf), (const FFstrbuf*) board);
+    return error;
+}
+
 void ffPrintBoard(FFBoardOptions* options)
 {
     FFBoardResult result;
@@ -14,7 +30,7 @@ void ffPrintBoard(FFBoardOptions* options)
     ffStrbufInit(&result.version);
     ffStrbufInit(&result.serial);
 
-    const char* error = ffDetectBoard(&result);
+    const char* error = detectBoard(&result);
     if(error)
     {
         ffPrintError(FF_BOARD_MODULE_NAME, 0, &options->moduleArgs, FF_PRINT_TYPE_DEFAULT, "%s", error);
@@ -95,7 +111,7 @@ void ffGenerateBoardJsonResult(FF_MAYBE_UNUSED FFBoardOptions* options, yyjson_m
     ffStrbufInit(&board.version);
     ffStrbufInit(&board.serial);
 
-    const char* error = ffDetectBoard(&board);
+    const char* error = detectBoard(&board);
 
     if (error)
     {
@@ -2,14 +2,118 @@
 #include "common/jsonconfig.h"
 #include "common/processing.h"
 #include "modules/command/command.h"
+#include "util/mallocHelper.h"
 #include "util/stringUtils.h"
 
 #define FF_COMMAND_NUM_FORMAT_ARGS 1
 
-void ffPrintCommand(FFCommandOptions* options)
+#ifndef _WIN32
+typedef struct FFCommandPrepared
 {
-    FF_STRBUF_AUTO_DESTROY result = ffStrbufCreate();
-    const char* error = ffProcessAppendStdOut(&result, (char* const[]){
+    FFstrbuf shell;
+    FFstrbuf text;
+    FFstrbuf output;
+    const char* error;
+    FFProcessHandle handle;
+    bool consumed;
+} FFCommandPrepared;
+
+static FFlist prepared; // FFCommandPrepared, in the order of the modules
+
+static bool takePrepared(const FFCommandOptions* options, FFstrbuf* result, const char** error)
+{
+    FFCommandPrepared* found = NULL;
+    uint32_t running = 0;
+    FF_LIST_FOR_EACH(FFCommandPrepared, item, prepared)
+    {
+        if (item->consumed) continue;
+        if (!found && ffStrbufEqual(&item->shell, &options->shell) && ffStrbufEqual(&item->text, &options->text))
+            found = item;
+        if (item->handle.pipeRead >= 0)
+            ++running;
+    }
+    if (!found) return false;
+
+    if (found->handle.pipeRead >= 0)
+    {
+        // Read all commands that are still running at once, so that none of them blocks on a full pipe
+        FF_AUTO_FREE FFCommandPrepared** items = malloc(sizeof(*items) * running);
+        FF_AUTO_FREE FFProcessHandle** handles = malloc(sizeof(*handles) * running);
+        FF_AUTO_FREE FFstrbuf** buffers = malloc(sizeof(*buffers) * running);
+        FF_AUTO_FREE const char** errors = malloc(sizeof(*errors) * running);
+
+        uint32_t index = 0;
+        FF_LIST_FOR_EACH(FFCommandPrepared, item, prepared)
+        {
+            if (item->consumed || item->handle.pipeRead < 0) continue;
+            items[index] = item;
+            handles[index] = &item->handle;
+            buffers[index] = &item->output;
+            ++index;
+        }
+
+        ffProcessReadOutputs(running, handles, buffers, errors);
+        for (uint32_t i = 0; i < running; ++i)
+            items[i]->error = errors[i];
+    }
+
+    found->consumed = true;
+    *error = found->error;
+    ffStrbufDestroy(result);
+    ffStrbufInitMove(result, &found->output);
+    if (!*error)
+        ffStrbufTrimRightSpace(result);
+    return true;
+}
+#endif
+
+void ffDestroyPreparedCommands(void)
+{
+    #ifndef _WIN32
+    if (prepared.elementSize == 0) return;
+
+    FF_LIST_FOR_EACH(FFCommandPrepared, item, prepared)
+    {
+        if (!item->consumed && item->handle.pipeRead >= 0)
+            ffProcessKill(&item->handle);
+        ffStrbufDestroy(&item->shell);
+        ffStrbufDestroy(&item->text);
+        ffStrbufDestroy(&item->output);
+    }
+    ffListDestroy(&prepared);
+    #endif
+}
+
+void ffPrepareCommand(FF_MAYBE_UNUSED const FFCommandOptions* options)
+{
+    #ifndef _WIN32
+    if (prepared.elementSize == 0)
+        ffListInit(&prepared, sizeof(FFCommandPrepared));
+
+    FFCommandPrepared* item = ffListAdd(&prepared);
+    ffStrbufInitCopy(&item->shell, &options->shell);
+    ffStrbufInitCopy(&item->text, &options->text);
+    ffStrbufInit(&item->output);
+    item->consumed = false;
+    item->handle.pipeRead = -1;
+    item->error = ffProcessSpawn((char* const[]){
+        item->shell.chars,
+        "-c",
+        item->text.chars,
+        NULL
+    }, false, &item->handle);
+    #endif
+}
+
+static const char* runCommand(FFCommandOptions* options, FFstrbuf* result)
+{
+    #ifndef _WIN32
+    const char* error;
+    if (takePrepared(options, result, &error))
+        return error;
+    #endif
+
+    return ffProcessAppendStdOut(result, (char* const[]){
         options->shell.chars,
         #ifdef _WIN32
         "/c",
@@ -19,6 +123,12 @@ void ffPrintCommand(FFCommandOptions* options)
         options->text.chars,
         NULL
     });
+}
+
+void ffPrintCommand(FFCommandOptions* options)
+{
+    FF_STRBUF_AUTO_DESTROY result = ffStrbufCreate();
+    const char* error = runCommand(options, &result);
 
     if(error)
     {
@@ -113,16 +223,7 @@ void ffGenerateCommandJsonConfig(FFCommandOptions* options, yyjson_mut_doc* doc,
 void ffGenerateCommandJsonResult(FF_MAYBE_UNUSED FFCommandOptions* options, yyjson_mut_doc* doc, yyjson_mut_val* module)
 {
     FF_STRBUF_AUTO_DESTROY result = ffStrbufCreate();
-    const char* error = ffProcessAppendStdOut(&result, (char* const[]){
-        options->shell.chars,
-        #ifdef _WIN32
-        "/c",
-        #else
-        "-c",
-        #endif
-        options->text.chars,
-        NULL
-    });
+    const char* error = runCommand(options, &result);
 
     if(error)
     {
@@ -4,6 +4,11 @@
 
 #define FF_COMMAND_MODULE_NAME "Command"
 
+// Starts the command ahead of time. Several Command modules run concurrently this way
+void ffPrepareCommand(const FFCommandOptions* options);
+// Kills the commands of modules that weren't printed, e.g. because printing was interrupted. Called once when the instance is destroyed
+void ffDestroyPreparedCommands(void);
+
 void ffPrintCommand(FFCommandOptions* options);
 void ffInitCommandOptions(FFCommandOptions* options);
 void ffDestroyCommandOptions(FFCommandOptions* options);
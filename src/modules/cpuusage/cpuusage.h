@@ -5,6 +5,7 @@
 #define FF_CPUUSAGE_MODULE_NAME "CPUUsage"
 
 void ffPrepareCPUUsage();
+void ffSampleCPUUsage(void);
 
 void ffPrintCPUUsage(FFCPUUsageOptions* options);
 void ffInitCPUUsageOptions(FFCPUUsageOptions* options);
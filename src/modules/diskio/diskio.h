@@ -5,6 +5,7 @@
 #define FF_DISKIO_MODULE_NAME "DiskIO"
 
 void ffPrepareDiskIO(FFDiskIOOptions* options);
+void ffSampleDiskIO(void);
 
 void ffPrintDiskIO(FFDiskIOOptions* options);
 void ffInitDiskIOOptions(FFDiskIOOptions* options);
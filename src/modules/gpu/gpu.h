@@ -4,6 +4,8 @@
 
 #define FF_GPU_MODULE_NAME "GPU"
 
+void ffPrepareGPU(const FFGPUOptions* options);
+
 void ffPrintGPU(FFGPUOptions* options);
 void ffInitGPUOptions(FFGPUOptions* options);
 void ffDestroyGPUOptions(FFGPUOptions* options);
@@ -1,3 +1,4 @@
+#include "common/cache.h"
 #include "common/printing.h"
 #include "common/jsonconfig.h"
 #include "detection/host/host.h"
@@ -6,6 +7,21 @@
 
 #define FF_HOST_NUM_FORMAT_ARGS 7
 
+// Doesn't change until next reboot
+static const char* detectHost(FFHostResult* host)
+{
+    FF_CACHE_ENTRY_AUTO_DESTROY cache;
+    ffCacheEntryInit(&cache, "host");
+    ffCacheKeyAddBootId(&cache);
+    if (ffCacheLoadStrbufs(&cache, sizeof(*host) / sizeof(FFstrbuf), (FFstrbuf*) host))
+        return NULL;
+
+    const char* error = ffDetectHost(host);
+    if (!error)
+        ffCacheStoreStrbufs(&cache, sizeof(*host) / sizeof(FFstrbuf), (const FFstrbuf*) host);
+    return error;
+}
+
 void ffPrintHost(FFHostOptions* options)
 {
     FFHostResult host;
@@ -17,7 +33,7 @@ void ffPrintHost(FFHostOptions* options)
     ffStrbufInit(&host.uuid);
     ffStrbufInit(&host.vendor);
 
-    const char* error = ffDetectHost(&host);
+    const char* error = detectHost(&host);
     if(error)
     {
         ffPrintError(FF_HOST_MODULE_NAME, 0, &options->moduleArgs, FF_PRINT_TYPE_DEFAULT, "%s", error);
@@ -115,7 +131,7 @@ void ffGenerateHostJsonResult(FF_MAYBE_UNUSED FFHostOptions* options, yyjson_mut
     ffStrbufInit(&host.uuid);
     ffStrbufInit(&host.vendor);
 
-    const char* error = ffDetectHost(&host);
+    const char* error = detectHost(&host);
     if (error)
     {
         yyjson_mut_obj_add_str(doc, module, "error", error);
@@ -5,6 +5,7 @@
 #define FF_NETIO_MODULE_NAME "NetIO"
 
 void ffPrepareNetIO(FFNetIOOptions* options);
+void ffSampleNetIO(void);
 
 void ffPrintNetIO(FFNetIOOptions* options);
 void ffInitNetIOOptions(FFNetIOOptions* options);
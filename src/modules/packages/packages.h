@@ -4,6 +4,8 @@
 
 #define FF_PACKAGES_MODULE_NAME "Packages"
 
+void ffPreparePackages(FFPackagesOptions* options);
+
 void ffPrintPackages(FFPackagesOptions* options);
 void ffInitPackagesOptions(FFPackagesOptions* options);
 void ffDestroyPackagesOptions(FFPackagesOptions* options);
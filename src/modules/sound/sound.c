@@ -1,12 +1,43 @@
 #include "common/percent.h"
 #include "common/printing.h"
 #include "common/jsonconfig.h"
+#include "common/scheduler.h"
 #include "detection/sound/sound.h"
 #include "modules/sound/sound.h"
 #include "util/stringUtils.h"
 
 #define FF_SOUND_NUM_FORMAT_ARGS 5
 
+static struct {
+    FFSchedulerTask task;
+    FFlist devices;
+    const char* error;
+} prefetch;
+
+static void prefetchSound(FF_MAYBE_UNUSED void* data)
+{
+    prefetch.error = ffDetectSound(&prefetch.devices);
+}
+
+void ffPrepareSound(FF_MAYBE_UNUSED FFSoundOptions* options)
+{
+    if (prefetch.task.func)
+        return;
+
+    ffListInit(&prefetch.devices, sizeof(FFSoundDevice));
+    ffSchedulerSubmit(&prefetch.task, FF_SOUND_MODULE_NAME, prefetchSound, NULL);
+}
+
+static const char* detectSound(FFlist* result)
+{
+    if (!ffSchedulerWait(&prefetch.task))
+        return ffDetectSound(result);
+
+    ffListDestroy(result);
+    ffListInitMove(result, &prefetch.devices);
+    return prefetch.error;
+}
+
 static void printDevice(FFSoundOptions* options, const FFSoundDevice* device, uint8_t index)
 {
     if(options->moduleArgs.outputFormat.length == 0)
@@ -65,7 +96,7 @@ void ffPrintSound(FFSoundOptions* options)
 {
     FF_LIST_AUTO_DESTROY result = ffListCreate(sizeof(FFSoundDevice));
 
-    const char* error = ffDetectSound(&result);
+    const char* error = detectSound(&result);
 
     if(error)
     {
@@ -195,7 +226,7 @@ void ffGenerateSoundJsonConfig(FFSoundOptions* options, yyjson_mut_doc* doc, yyj
 void ffGenerateSoundJsonResult(FF_MAYBE_UNUSED FFSoundOptions* options, yyjson_mut_doc* doc, yyjson_mut_val* module)
 {
     FF_LIST_AUTO_DESTROY result = ffListCreate(sizeof(FFSoundDevice));
-    const char* error = ffDetectSound(&result);
+    const char* error = detectSound(&result);
 
     if(error)
     {
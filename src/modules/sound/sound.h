@@ -4,6 +4,8 @@
 
 #define FF_SOUND_MODULE_NAME "Sound"
 
+void ffPrepareSound(FFSoundOptions* options);
+
 void ffPrintSound(FFSoundOptions* options);
 void ffInitSoundOptions(FFSoundOptions* options);
 void ffDestroySoundOptions(FFSoundOptions* options);
@@ -38,6 +38,20 @@ const char* ffOptionsParseGeneralJsonConfig(FFOptionsGeneral* options, yyjson_va
         }
         else if (ffStrEqualsIgnCase(key, "detectVersion"))
             options->detectVersion = yyjson_get_bool(val);
+        else if (ffStrEqualsIgnCase(key, "cacheMode"))
+        {
+            int value;
+            const char* error = ffJsonConfigParseEnum(val, &value, (FFKeyValuePair[]) {
+                { "none", FF_CACHE_MODE_NONE },
+                { "read", FF_CACHE_MODE_READ },
+                { "readwrite", FF_CACHE_MODE_READWRITE },
+                { "refresh", FF_CACHE_MODE_REFRESH },
+                {},
+            });
+            if (error)
+                return "Invalid enum value of `cacheMode`";
+            options->cacheMode = (FFCacheMode) value;
+        }
 
         #if defined(__linux__) || defined(__FreeBSD__) || defined(__sun)
         else if (ffStrEqualsIgnCase(key, "escapeBedrock"))
@@ -83,6 +97,16 @@ bool ffOptionsParseGeneralCommandLine(FFOptionsGeneral* options, const char* key
         options->processingTimeout = ffOptionParseInt32(key, value);
     else if(ffStrEqualsIgnCase(key, "--detect-version"))
         options->detectVersion = ffOptionParseBoolean(value);
+    else if(ffStrEqualsIgnCase(key, "--cache-mode"))
+    {
+        options->cacheMode = (FFCacheMode) ffOptionParseEnum(key, value, (FFKeyValuePair[]) {
+            { "none", FF_CACHE_MODE_NONE },
+            { "read", FF_CACHE_MODE_READ },
+            { "readwrite", FF_CACHE_MODE_READWRITE },
+            { "refresh", FF_CACHE_MODE_REFRESH },
+            {},
+        });
+    }
 
     #if defined(__linux__) || defined(__FreeBSD__) || defined(__sun)
     else if(ffStrEqualsIgnCase(key, "--escape-bedrock"))
@@ -114,6 +138,7 @@ void ffOptionsInitGeneral(FFOptionsGeneral* options)
     options->processingTimeout = 1000;
     options->multithreading = true;
     options->detectVersion = true;
+    options->cacheMode = FF_CACHE_MODE_READWRITE;
 
     #if defined(__linux__) || defined(__FreeBSD__)
     options->escapeBedrock = true;
@@ -144,6 +169,25 @@ void ffOptionsGenerateGeneralJsonConfig(FFOptionsGeneral* options, yyjson_mut_do
     if (options->processingTimeout != defaultOptions.processingTimeout)
         yyjson_mut_obj_add_int(doc, obj, "processingTimeout", options->processingTimeout);
 
+    if (options->cacheMode != defaultOptions.cacheMode)
+    {
+        switch (options->cacheMode)
+        {
+            case FF_CACHE_MODE_NONE:
+                yyjson_mut_obj_add_str(doc, obj, "cacheMode", "none");
+                break;
+            case FF_CACHE_MODE_READ:
+                yyjson_mut_obj_add_str(doc, obj, "cacheMode", "read");
+                break;
+            case FF_CACHE_MODE_READWRITE:
+                yyjson_mut_obj_add_str(doc, obj, "cacheMode", "readwrite");
+                break;
+            case FF_CACHE_MODE_REFRESH:
+                yyjson_mut_obj_add_str(doc, obj, "cacheMode", "refresh");
+                break;
+        }
+    }
+
     #if defined(__linux__) || defined(__FreeBSD__)
 
     if (options->escapeBedrock != defaultOptions.escapeBedrock)
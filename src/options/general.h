@@ -9,11 +9,20 @@ typedef enum FFDsForceDrmType
     FF_DS_FORCE_DRM_TYPE_SYSFS_ONLY, // Use `/sys/class/drm` only
 } FFDsForceDrmType;
 
+typedef enum FFCacheMode
+{
+    FF_CACHE_MODE_NONE,      // Don't use the detection cache at all
+    FF_CACHE_MODE_READ,      // Use cached results but never update them
+    FF_CACHE_MODE_READWRITE, // Use cached results and update the stale ones
+    FF_CACHE_MODE_REFRESH,   // Ignore cached results and rewrite them
+} FFCacheMode;
+
 typedef struct FFOptionsGeneral
 {
     bool multithreading;
     int32_t processingTimeout;
     bool detectVersion;
+    FFCacheMode cacheMode;
 
     // Module options that cannot be put in module option structure
     #if defined(__linux__) || defined(__FreeBSD__) || defined(__sun)
@@ -1,4 +1,5 @@
 #include "smbiosHelper.h"
+#include "common/cache.h"
 #include "common/io/io.h"
 #include "util/unused.h"
 #include "util/mallocHelper.h"
@@ -126,11 +127,18 @@ typedef union FFSmbiosEntryPoint
     FFSmbios30EntryPoint Smbios30;
 } FFSmbiosEntryPoint;
 
-const FFSmbiosHeaderTable* ffGetSmbiosHeaderTable()
+static FFstrbuf buffer;
+static FFSmbiosHeaderTable table;
+
+static void resetSmbiosHeaderTable(void)
 {
-    static FFstrbuf buffer;
-    static FFSmbiosHeaderTable table;
+    ffStrbufDestroy(&buffer);
+    buffer = (FFstrbuf) {};
+    memset(table, 0, sizeof(table));
+}
 
+const FFSmbiosHeaderTable* ffGetSmbiosHeaderTable()
+{
     if (buffer.chars == NULL)
     {
         #ifdef __linux__
@@ -215,6 +223,8 @@ const FFSmbiosHeaderTable* ffGetSmbiosHeaderTable()
             }
         }
 
+        ffCacheRegisterReset(resetSmbiosHeaderTable);
+
         for (
             const FFSmbiosHeader* header = (const FFSmbiosHeader*) buffer.chars;
             (const uint8_t*) header < (const uint8_t*) buffer.chars + buffer.length;
@@ -248,11 +258,18 @@ typedef struct FFRawSmbiosData
     uint8_t SMBIOSTableData[];
 } FFRawSmbiosData;
 
-const FFSmbiosHeaderTable* ffGetSmbiosHeaderTable()
+static FFRawSmbiosData* buffer;
+static FFSmbiosHeaderTable table;
+
+static void resetSmbiosHeaderTable(void)
 {
-    static FFRawSmbiosData* buffer;
-    static FFSmbiosHeaderTable table;
+    free(buffer);
+    buffer = NULL;
+    memset(table, 0, sizeof(table));
+}
 
+const FFSmbiosHeaderTable* ffGetSmbiosHeaderTable()
+{
     if (!buffer)
     {
         const DWORD signature = 'RSMB';
@@ -264,6 +281,7 @@ const FFSmbiosHeaderTable* ffGetSmbiosHeaderTable()
         assert(buffer);
         FF_MAYBE_UNUSED uint32_t resultSize = GetSystemFirmwareTable(signature, 0, buffer, bufSize);
         assert(resultSize == bufSize);
+        ffCacheRegisterReset(resetSmbiosHeaderTable);
 
         for (
             const FFSmbiosHeader* header = (const FFSmbiosHeader*) buffer->SMBIOSTableData;
@@ -0,0 +1,268 @@
+#include "fastfetch.h"
+#include "common/cache.h"
+#include "common/time.h"
+#include "util/stringUtils.h"
+#include "util/mallocHelper.h"
+#include "modules/modules.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+// Measures the latency distribution of each module's detection.
+// The cold phase runs every sample in a new process and bypasses the persistent cache,
+// the warm phase runs the module once and then measures the memoized / cached path.
+
+typedef enum BenchPhase
+{
+    BENCH_PHASE_COLD = 1 << 0,
+    BENCH_PHASE_WARM = 1 << 1,
+} BenchPhase;
+
+typedef struct BenchStat
+{
+    double min, p50, p99, max;
+} BenchStat;
+
+// Modules that talk to remote servers or sleep to sample a rate
+static const char* defaultExcluded[] = {
+    FF_COMMAND_MODULE_NAME,
+    FF_CPUUSAGE_MODULE_NAME,
+    FF_DISKIO_MODULE_NAME,
+    FF_NETIO_MODULE_NAME,
+    FF_PUBLICIP_MODULE_NAME,
+    FF_WEATHER_MODULE_NAME,
+};
+
+__attribute__((__noreturn__))
+static void printUsage(const char* exe, int code)
+{
+    fprintf(code ? stderr : stdout,
+        "Usage: %s [-n <count>] [--cold | --warm] [--json] [<module>...]\n"
+        "  -n <count>  samples per module and phase (default: 10)\n"
+        "  --cold      only measure in new processes with the persistent cache bypassed\n"
+        "  --warm      only measure after the module has run once\n"
+        "  --json      print results as JSON\n",
+        exe);
+    exit(code);
+}
+
+static FFModuleBaseInfo* findModule(const char* name)
+{
+    if (!ffCharIsEnglishAlphabet(name[0])) return NULL;
+
+    for (FFModuleBaseInfo** modules = ffModuleInfos[toupper(name[0]) - 'A']; *modules; ++modules)
+    {
+        if (ffStrEqualsIgnCase(name, (*modules)->name))
+            return *modules;
+    }
+    return NULL;
+}
+
+static bool isDefaultExcluded(const FFModuleBaseInfo* baseInfo)
+{
+    for (uint32_t i = 0; i < sizeof(defaultExcluded) / sizeof(defaultExcluded[0]); ++i)
+    {
+        if (ffStrEquals(baseInfo->name, defaultExcluded[i]))
+            return true;
+    }
+    return false;
+}
+
+static double runModule(FFModuleBaseInfo* baseInfo)
+{
+    yyjson_mut_doc* doc = yyjson_mut_doc_new(NULL);
+    yyjson_mut_val* module = yyjson_mut_obj(doc);
+
+    double start = ffTimeGetTick();
+    baseInfo->generateJsonResult(baseInfo, doc, module);
+    double elapsed = ffTimeGetTick() - start;
+
+    yyjson_mut_doc_free(doc);
+    return elapsed;
+}
+
+// Not every detector registers a reset of what it memoizes (e.g. Terminal, Vulkan or DBus connections).
+// Modules only run after the cold phase, so a forked process starts as fresh as a new fastfetch process
+static double runModuleCold(FFModuleBaseInfo* baseInfo)
+{
+    #ifdef _WIN32
+    ffCacheResetMemoized();
+    return runModule(baseInfo);
+    #else
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        perror("pipe");
+        exit(1);
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        double elapsed = runModule(baseInfo);
+        _exit(write(fds[1], &elapsed, sizeof(elapsed)) == (ssize_t) sizeof(elapsed) ? 0 : 1);
+    }
+    close(fds[1]);
+
+    double elapsed;
+    bool ok = pid > 0 && read(fds[0], &elapsed, sizeof(elapsed)) == (ssize_t) sizeof(elapsed);
+    close(fds[0]);
+    if (pid > 0)
+        waitpid(pid, NULL, 0);
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to run %s in a new process\n", baseInfo->name);
+        exit(1);
+    }
+    return elapsed;
+    #endif
+}
+
+static int compareDouble(const void* a, const void* b)
+{
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static BenchStat computeStat(double* samples, uint32_t count)
+{
+    qsort(samples, count, sizeof(*samples), compareDouble);
+    return (BenchStat) {
+        .min = samples[0],
+        .p50 = samples[(count - 1) * 50 / 100],
+        .p99 = samples[(count - 1) * 99 / 100],
+        .max = samples[count - 1],
+    };
+}
+
+static void addStat(yyjson_mut_doc* doc, yyjson_mut_val* arr, const char* phase, const char* module, BenchStat stat)
+{
+    yyjson_mut_val* obj = yyjson_mut_arr_add_obj(doc, arr);
+    yyjson_mut_obj_add_str(doc, obj, "phase", phase);
+    yyjson_mut_obj_add_str(doc, obj, "module", module);
+    yyjson_mut_obj_add_real(doc, obj, "min", stat.min);
+    yyjson_mut_obj_add_real(doc, obj, "p50", stat.p50);
+    yyjson_mut_obj_add_real(doc, obj, "p99", stat.p99);
+    yyjson_mut_obj_add_real(doc, obj, "max", stat.max);
+}
+
+static void printStat(const char* phase, const char* module, BenchStat stat)
+{
+    printf("%-5s %-20s %10.3f %10.3f %10.3f %10.3f\n", phase, module, stat.min, stat.p50, stat.p99, stat.max);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = 10;
+    BenchPhase phases = BENCH_PHASE_COLD | BENCH_PHASE_WARM;
+    bool json = false;
+
+    ffInitInstance();
+
+    FF_LIST_AUTO_DESTROY modules = ffListCreate(sizeof(FFModuleBaseInfo*));
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (ffStrEquals(argv[i], "-n") && i + 1 < argc)
+        {
+            count = (uint32_t) strtoul(argv[++i], NULL, 10);
+            if (count == 0) printUsage(argv[0], 1);
+        }
+        else if (ffStrEquals(argv[i], "--cold"))
+            phases = BENCH_PHASE_COLD;
+        else if (ffStrEquals(argv[i], "--warm"))
+            phases = BENCH_PHASE_WARM;
+        else if (ffStrEquals(argv[i], "--json"))
+            json = true;
+        else if (ffStrEquals(argv[i], "-h") || ffStrEquals(argv[i], "--help"))
+            printUsage(argv[0], 0);
+        else
+        {
+            FFModuleBaseInfo* baseInfo = findModule(argv[i]);
+            if (!baseInfo || !baseInfo->generateJsonResult)
+            {
+                fprintf(stderr, "Unknown module or no JSON support: %s\n", argv[i]);
+                return 1;
+            }
+            *(FFModuleBaseInfo**) ffListAdd(&modules) = baseInfo;
+        }
+    }
+
+    if (modules.length == 0)
+    {
+        for (uint32_t i = 0; i <= 'Z' - 'A'; ++i)
+        {
+            for (FFModuleBaseInfo** baseInfo = ffModuleInfos[i]; *baseInfo; ++baseInfo)
+            {
+                if ((*baseInfo)->generateJsonResult && !isDefaultExcluded(*baseInfo))
+                    *(FFModuleBaseInfo**) ffListAdd(&modules) = *baseInfo;
+            }
+        }
+    }
+
+    FFCacheMode cacheMode = instance.config.general.cacheMode;
+    FF_AUTO_FREE double* samples = malloc(sizeof(*samples) * count * modules.length);
+    FF_AUTO_FREE double* totals = malloc(sizeof(*totals) * count);
+
+    yyjson_mut_doc* doc = json ? yyjson_mut_doc_new(NULL) : NULL;
+    yyjson_mut_val* root = doc ? yyjson_mut_arr(doc) : NULL;
+    if (doc) yyjson_mut_doc_set_root(doc, root);
+    else printf("%-5s %-20s %10s %10s %10s %10s\n", "Phase", "Module", "min (ms)", "p50 (ms)", "p99 (ms)", "max (ms)");
+
+    for (BenchPhase phase = BENCH_PHASE_COLD; phase <= BENCH_PHASE_WARM; phase <<= 1)
+    {
+        if (!(phases & phase)) continue;
+
+        const char* phaseName = phase == BENCH_PHASE_COLD ? "cold" : "warm";
+        instance.config.general.cacheMode = phase == BENCH_PHASE_COLD ? FF_CACHE_MODE_NONE : cacheMode;
+
+        if (phase == BENCH_PHASE_WARM)
+        {
+            FF_LIST_FOR_EACH(FFModuleBaseInfo*, baseInfo, modules)
+                runModule(*baseInfo);
+        }
+
+        // Interleave modules so that a slow run of the system affects all of them equally
+        for (uint32_t iter = 0; iter < count; ++iter)
+        {
+            totals[iter] = 0;
+            for (uint32_t i = 0; i < modules.length; ++i)
+            {
+                FFModuleBaseInfo* baseInfo = *(FFModuleBaseInfo**) ffListGet(&modules, i);
+                double elapsed = phase == BENCH_PHASE_COLD ? runModuleCold(baseInfo) : runModule(baseInfo);
+                samples[i * count + iter] = elapsed;
+                totals[iter] += elapsed;
+            }
+        }
+
+        for (uint32_t i = 0; i < modules.length; ++i)
+        {
+            const char* name = (*(FFModuleBaseInfo**) ffListGet(&modules, i))->name;
+            BenchStat stat = computeStat(samples + i * count, count);
+            if (doc) addStat(doc, root, phaseName, name, stat);
+            else printStat(phaseName, name, stat);
+        }
+
+        BenchStat stat = computeStat(totals, count);
+        if (doc) addStat(doc, root, phaseName, "Total", stat);
+        else printStat(phaseName, "Total", stat);
+    }
+
+    if (doc)
+    {
+        yyjson_mut_write_fp(stdout, doc, YYJSON_WRITE_INF_AND_NAN_AS_NULL | YYJSON_WRITE_PRETTY_TWO_SPACES | YYJSON_WRITE_NEWLINE_AT_END, NULL, NULL);
+        yyjson_mut_doc_free(doc);
+    }
+
+    instance.config.general.cacheMode = cacheMode;
+    ffDestroyInstance();
+    return 0;
+}